@@ -0,0 +1,115 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef batch_function_hpp
+#define batch_function_hpp
+
+#include "common/common.hpp"
+#include "fiber/function.hpp"
+#include "fiber/geometrical_data.hpp"
+
+#include <armadillo>
+#include <stdexcept>
+
+namespace Bempp
+{
+
+/** \brief Function evaluated by a functor acting on whole arrays of points.
+ *
+ *  Fiber::SurfaceNormalIndependentFunction and
+ *  Fiber::SurfaceNormalDependentFunction call their functors once per
+ *  point. projectOnVectorSpace() and interpolateOnVectorSpace(), however,
+ *  evaluate functions at all points of a batch of elements or DOFs at a
+ *  time; wrapping a functor in this class passes each batch to the functor
+ *  in a single call. This pays off for functors with a high cost per call,
+ *  such as PythonBatchFunctor, which is used by the Python wrappers of
+ *  these functions to call a Python callable once per batch.
+ *
+ *  The \p Functor class must provide the following interface:
+ *
+ *  \code
+ *  class Functor
+ *  {
+ *  public:
+ *      typedef ... ValueType;
+ *      typedef ... CoordinateType;
+ *
+ *      // Number of components of the points (usually 3)
+ *      int argumentDimension() const;
+ *      // Number of components of the function values
+ *      int resultDimension() const;
+ *      // Whether evaluate() uses the normals
+ *      bool dependsOnNormals() const;
+ *
+ *      // Store in the ith column of result the value of the function at
+ *      // the ith column of points; normals, if used, are stored in the
+ *      // columns of normals
+ *      void evaluate(const arma::Mat<CoordinateType>& points,
+ *                    const arma::Mat<CoordinateType>& normals,
+ *                    arma::Mat<ValueType>& result) const;
+ *  };
+ *  \endcode
+ *
+ *  evaluate() may be called from several threads at a time. */
+template <typename Functor>
+class BatchFunction : public Fiber::Function<typename Functor::ValueType>
+{
+    typedef Fiber::Function<typename Functor::ValueType> Base;
+public:
+    typedef typename Base::ValueType ValueType;
+    typedef typename Base::CoordinateType CoordinateType;
+
+    explicit BatchFunction(const Functor& functor) :
+        m_functor(functor)
+    {}
+
+    virtual int worldDimension() const {
+        return m_functor.argumentDimension();
+    }
+
+    virtual int codomainDimension() const {
+        return m_functor.resultDimension();
+    }
+
+    virtual void addGeometricalDependencies(size_t& geomDeps) const {
+        geomDeps |= Fiber::GLOBALS;
+        if (m_functor.dependsOnNormals())
+            geomDeps |= Fiber::NORMALS;
+    }
+
+    virtual void evaluate(const Fiber::GeometricalData<CoordinateType>& geomData,
+                          arma::Mat<ValueType>& result) const {
+        m_functor.evaluate(geomData.globals, geomData.normals, result);
+        if (result.n_rows != (size_t)codomainDimension() ||
+                result.n_cols != geomData.globals.n_cols)
+            throw std::runtime_error("BatchFunction::evaluate(): "
+                                     "functor returned an array of incorrect "
+                                     "size");
+    }
+
+private:
+    /** \cond PRIVATE */
+    const Functor m_functor;
+    /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,153 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Test of BatchFunction: projecting and interpolating a vector field given
+// by a functor acting on whole batches of points must give the same results
+// as the per-point Fiber::SurfaceNormalIndependentFunction wrapping a functor
+// that evaluates the same field.
+
+#include "batch_function.hpp"
+#include "piecewise_constant_vector_space.hpp"
+#include "piecewise_linear_continuous_vector_space.hpp"
+#include "vector_interpolation.hpp"
+#include "vector_projection.hpp"
+
+#include "fiber/surface_normal_independent_function.hpp"
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+#include "grid/grid_parameters.hpp"
+
+#include <algorithm>
+#include <armadillo>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+using namespace Bempp;
+
+// Component d of the field at the point (x, y, z)
+double fieldComponent(int d, double x, double y, double z)
+{
+    return std::sin(x + d) * std::cos(2. * y) + (d + 1) * z * x;
+}
+
+class PointFunctor
+{
+public:
+    typedef double ValueType;
+    typedef double CoordinateType;
+
+    int argumentDimension() const {
+        return 3;
+    }
+
+    int resultDimension() const {
+        return 3;
+    }
+
+    void evaluate(const arma::Col<CoordinateType>& point,
+                  arma::Col<ValueType>& result) const {
+        for (int d = 0; d < 3; ++d)
+            result(d) = fieldComponent(d, point(0), point(1), point(2));
+    }
+};
+
+class BatchFunctor
+{
+public:
+    typedef double ValueType;
+    typedef double CoordinateType;
+
+    int argumentDimension() const {
+        return 3;
+    }
+
+    int resultDimension() const {
+        return 3;
+    }
+
+    bool dependsOnNormals() const {
+        return false;
+    }
+
+    void evaluate(const arma::Mat<CoordinateType>& points,
+                  const arma::Mat<CoordinateType>& normals,
+                  arma::Mat<ValueType>& result) const {
+        result.set_size(3, points.n_cols);
+        for (size_t i = 0; i < points.n_cols; ++i)
+            for (int d = 0; d < 3; ++d)
+                result(d, i) = fieldComponent(d, points(0, i), points(1, i),
+                                              points(2, i));
+    }
+};
+
+bool compare(const char* name, const arma::Col<double>& expected,
+             const arma::Col<double>& actual)
+{
+    const double error = arma::norm(expected - actual, "inf");
+    const double scale = std::max(1., arma::norm(expected, "inf"));
+    if (expected.n_rows == 0 || expected.n_rows != actual.n_rows ||
+            error > 1e-12 * scale) {
+        std::cerr << name << ": batch and per-point results differ by "
+                  << error << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool testSpace(const char* name, const SimpleVectorSpaceBase<double>& space)
+{
+    const Fiber::SurfaceNormalIndependentFunction<PointFunctor>
+        pointFunction((PointFunctor()));
+    const BatchFunction<BatchFunctor> batchFunction((BatchFunctor()));
+
+    arma::Col<double> expected, actual;
+    projectOnVectorSpace(space, pointFunction, expected);
+    projectOnVectorSpace(space, batchFunction, actual);
+    bool ok = compare(name, expected, actual);
+    interpolateOnVectorSpace(space, pointFunction, expected);
+    interpolateOnVectorSpace(space, batchFunction, actual);
+    ok = compare(name, expected, actual) && ok;
+    return ok;
+}
+
+} // namespace
+
+int main()
+{
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    arma::Col<double> lowerLeft(2), upperRight(2);
+    lowerLeft.fill(0.);
+    upperRight.fill(1.);
+    arma::Col<unsigned int> elementCounts(2);
+    elementCounts.fill(8);
+    shared_ptr<Grid> grid = GridFactory::createStructuredGrid(
+        params, lowerLeft, upperRight, elementCounts);
+
+    const PiecewiseConstantVectorSpace<double, 3> constantSpace(grid);
+    const PiecewiseLinearContinuousVectorSpace<double, 3> linearSpace(grid);
+    bool ok = testSpace("PiecewiseConstantVectorSpace", constantSpace);
+    ok = testSpace("PiecewiseLinearContinuousVectorSpace", linearSpace) && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
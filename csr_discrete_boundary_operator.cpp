@@ -0,0 +1,265 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "csr_discrete_boundary_operator.hpp"
+
+#include "fiber/explicit_instantiation.hpp"
+
+#ifdef WITH_TRILINOS
+#include <Thyra_DefaultSpmdVectorSpace_decl.hpp>
+#endif
+
+#include <algorithm>
+#include <complex>
+#include <stdexcept>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+
+namespace Bempp
+{
+
+namespace
+{
+
+template <typename T>
+inline T conjugate(T x)
+{
+    return x;
+}
+
+template <typename T>
+inline std::complex<T> conjugate(const std::complex<T>& x)
+{
+    return std::conj(x);
+}
+
+// Computes y += alpha * A * x for vectorCount pairs of vectors x and y,
+// stored one after another in the arrays x and y. The entries of each row of
+// A are read from memory once and reused from cache for all vectors.
+template <typename ValueType>
+class CsrApplyLoopBody
+{
+public:
+    CsrApplyLoopBody(const std::vector<size_t>& rowOffsets,
+                     const std::vector<int>& columnIndices,
+                     const std::vector<ValueType>& values,
+                     const ValueType* x, size_t xSize,
+                     ValueType alpha,
+                     ValueType* y, size_t ySize,
+                     int vectorCount) :
+        m_rowOffsets(rowOffsets), m_columnIndices(columnIndices),
+        m_values(values), m_x(x), m_xSize(xSize), m_alpha(alpha),
+        m_y(y), m_ySize(ySize), m_vectorCount(vectorCount)
+    {}
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        for (size_t row = r.begin(); row < r.end(); ++row)
+            for (int v = 0; v < m_vectorCount; ++v) {
+                const ValueType* x = m_x + v * m_xSize;
+                ValueType sum = 0.;
+                for (size_t k = m_rowOffsets[row]; k < m_rowOffsets[row + 1]; ++k)
+                    sum += m_values[k] * x[m_columnIndices[k]];
+                m_y[v * m_ySize + row] += m_alpha * sum;
+            }
+    }
+
+private:
+    const std::vector<size_t>& m_rowOffsets;
+    const std::vector<int>& m_columnIndices;
+    const std::vector<ValueType>& m_values;
+    const ValueType* m_x;
+    size_t m_xSize;
+    ValueType m_alpha;
+    ValueType* m_y;
+    size_t m_ySize;
+    int m_vectorCount;
+};
+
+} // namespace
+
+template <typename ValueType>
+CsrDiscreteBoundaryOperator<ValueType>::CsrDiscreteBoundaryOperator(
+    unsigned int rowCount, unsigned int columnCount,
+    const std::vector<size_t>& rowOffsets,
+    const std::vector<int>& columnIndices,
+    const std::vector<ValueType>& values) :
+    m_rowCount(rowCount),
+    m_columnCount(columnCount),
+    m_rowOffsets(rowOffsets),
+    m_columnIndices(columnIndices),
+    m_values(values)
+{
+    if (rowOffsets.size() != rowCount + 1 || rowOffsets[0] != 0 ||
+            rowOffsets.back() != values.size() ||
+            columnIndices.size() != values.size())
+        throw std::invalid_argument(
+            "CsrDiscreteBoundaryOperator::CsrDiscreteBoundaryOperator(): "
+            "inconsistent array sizes");
+    for (size_t k = 0; k < columnIndices.size(); ++k)
+        if (columnIndices[k] < 0 || columnIndices[k] >= (int)columnCount)
+            throw std::invalid_argument(
+                "CsrDiscreteBoundaryOperator::CsrDiscreteBoundaryOperator(): "
+                "column index out of range");
+    // addBlock() relies on binary searches within rows
+    for (unsigned int row = 0; row < rowCount; ++row) {
+        if (rowOffsets[row + 1] < rowOffsets[row])
+            throw std::invalid_argument(
+                "CsrDiscreteBoundaryOperator::CsrDiscreteBoundaryOperator(): "
+                "row offsets must not decrease");
+        for (size_t k = rowOffsets[row] + 1; k < rowOffsets[row + 1]; ++k)
+            if (columnIndices[k] <= columnIndices[k - 1])
+                throw std::invalid_argument(
+                    "CsrDiscreteBoundaryOperator::CsrDiscreteBoundaryOperator(): "
+                    "column indices must be sorted in strictly increasing "
+                    "order within each row");
+    }
+#ifdef WITH_TRILINOS
+    m_domainSpace = Thyra::defaultSpmdVectorSpace<ValueType>(columnCount);
+    m_rangeSpace = Thyra::defaultSpmdVectorSpace<ValueType>(rowCount);
+#endif
+}
+
+template <typename ValueType>
+unsigned int CsrDiscreteBoundaryOperator<ValueType>::rowCount() const
+{
+    return m_rowCount;
+}
+
+template <typename ValueType>
+unsigned int CsrDiscreteBoundaryOperator<ValueType>::columnCount() const
+{
+    return m_columnCount;
+}
+
+template <typename ValueType>
+void CsrDiscreteBoundaryOperator<ValueType>::addBlock(
+    const std::vector<int>& rows,
+    const std::vector<int>& cols,
+    const ValueType alpha,
+    arma::Mat<ValueType>& block) const
+{
+    if (block.n_rows != rows.size() || block.n_cols != cols.size())
+        throw std::invalid_argument(
+            "CsrDiscreteBoundaryOperator::addBlock(): "
+            "incorrect block size");
+
+    for (size_t i = 0; i < rows.size(); ++i) {
+        const std::vector<int>::const_iterator rowBegin =
+            m_columnIndices.begin() + m_rowOffsets[rows[i]];
+        const std::vector<int>::const_iterator rowEnd =
+            m_columnIndices.begin() + m_rowOffsets[rows[i] + 1];
+        for (size_t j = 0; j < cols.size(); ++j) {
+            const std::vector<int>::const_iterator it =
+                std::lower_bound(rowBegin, rowEnd, cols[j]);
+            if (it != rowEnd && *it == cols[j])
+                block(i, j) += alpha * m_values[it - m_columnIndices.begin()];
+        }
+    }
+}
+
+#ifdef WITH_TRILINOS
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType> >
+CsrDiscreteBoundaryOperator<ValueType>::domain() const
+{
+    return m_domainSpace;
+}
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType> >
+CsrDiscreteBoundaryOperator<ValueType>::range() const
+{
+    return m_rangeSpace;
+}
+
+template <typename ValueType>
+bool CsrDiscreteBoundaryOperator<ValueType>::opSupportedImpl(
+    Thyra::EOpTransp M_trans) const
+{
+    return (M_trans == Thyra::NOTRANS || M_trans == Thyra::TRANS ||
+            M_trans == Thyra::CONJTRANS);
+}
+#endif // WITH_TRILINOS
+
+template <typename ValueType>
+void CsrDiscreteBoundaryOperator<ValueType>::applyBuiltInImpl(
+    const TranspositionMode trans,
+    const arma::Col<ValueType>& x_in,
+    arma::Col<ValueType>& y_inout,
+    const ValueType alpha,
+    const ValueType beta) const
+{
+    const bool transposed = (trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE);
+    if (x_in.n_rows != (transposed ? m_rowCount : m_columnCount))
+        throw std::invalid_argument(
+            "CsrDiscreteBoundaryOperator::apply(): "
+            "vector x_in has incorrect length");
+    if (y_inout.n_rows != (transposed ? m_columnCount : m_rowCount))
+        throw std::invalid_argument(
+            "CsrDiscreteBoundaryOperator::apply(): "
+            "vector y_inout has incorrect length");
+
+    applyToBlock(trans, x_in.memptr(), y_inout.memptr(), 1, alpha, beta);
+}
+
+template <typename ValueType>
+void CsrDiscreteBoundaryOperator<ValueType>::applyToBlock(
+    const TranspositionMode trans,
+    const ValueType* x_in,
+    ValueType* y_inout,
+    int vectorCount,
+    const ValueType alpha,
+    const ValueType beta) const
+{
+    const bool transposed = (trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE);
+    const size_t xSize = transposed ? m_rowCount : m_columnCount;
+    const size_t ySize = transposed ? m_columnCount : m_rowCount;
+    ValueType* const yEnd = y_inout + vectorCount * ySize;
+    if (beta == static_cast<ValueType>(0.))
+        std::fill(y_inout, yEnd, static_cast<ValueType>(0.));
+    else
+        for (ValueType* y = y_inout; y != yEnd; ++y)
+            *y *= beta;
+
+    // Each row of y_inout is written by a single thread. The transposed
+    // product scatters into y_inout and is computed serially.
+    if (!transposed)
+        tbb::parallel_for(tbb::blocked_range<size_t>(0, m_rowCount, GRAIN_SIZE),
+                          CsrApplyLoopBody<ValueType>(
+                              m_rowOffsets, m_columnIndices, m_values,
+                              x_in, xSize, alpha, y_inout, ySize,
+                              vectorCount));
+    else
+        for (unsigned int row = 0; row < m_rowCount; ++row)
+            for (int v = 0; v < vectorCount; ++v) {
+                const ValueType x = alpha * x_in[v * xSize + row];
+                ValueType* y = y_inout + v * ySize;
+                if (trans == CONJUGATE_TRANSPOSE)
+                    for (size_t k = m_rowOffsets[row]; k < m_rowOffsets[row + 1]; ++k)
+                        y[m_columnIndices[k]] += conjugate(m_values[k]) * x;
+                else
+                    for (size_t k = m_rowOffsets[row]; k < m_rowOffsets[row + 1]; ++k)
+                        y[m_columnIndices[k]] += m_values[k] * x;
+            }
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(CsrDiscreteBoundaryOperator);
+
+} // namespace Bempp
@@ -0,0 +1,144 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef csr_discrete_boundary_operator_hpp
+#define csr_discrete_boundary_operator_hpp
+
+#include "common/common.hpp"
+
+#include "assembly/discrete_boundary_operator.hpp"
+
+#ifdef WITH_TRILINOS
+#include <Teuchos_RCP.hpp>
+#include <Thyra_SpmdVectorSpaceBase_decl.hpp>
+#endif
+
+#include <vector>
+
+namespace Bempp
+{
+
+/** \brief Discrete operator stored as a sparse matrix in the compressed
+ *  sparse row (CSR) format.
+ *
+ *  The column indices and values of the non-zero entries of row \p i are
+ *  stored at positions <tt>rowOffsets[i]</tt>, ...,
+ *  <tt>rowOffsets[i + 1] - 1</tt> of \p columnIndices and \p values. Within
+ *  each row, the column indices must be sorted in strictly increasing order.
+ *  The product with a vector is computed in parallel over rows.
+ *
+ *  Unlike DiscreteSparseBoundaryOperator, this class does not depend on
+ *  Trilinos; it is used for the mass matrices of SimpleVectorSpaces and their
+ *  inverses (see vectorMassMatrix()). */
+template <typename ValueType>
+class CsrDiscreteBoundaryOperator :
+        public DiscreteBoundaryOperator<ValueType>
+{
+public:
+    typedef DiscreteBoundaryOperator<ValueType> Base;
+
+    /** \brief Constructor.
+     *
+     *  An exception is thrown if the arrays are inconsistent with each
+     *  other or with the matrix dimensions, or if the column indices of some
+     *  row are not sorted in strictly increasing order. */
+    CsrDiscreteBoundaryOperator(
+            unsigned int rowCount, unsigned int columnCount,
+            const std::vector<size_t>& rowOffsets,
+            const std::vector<int>& columnIndices,
+            const std::vector<ValueType>& values);
+
+    virtual unsigned int rowCount() const;
+    virtual unsigned int columnCount() const;
+
+    virtual void addBlock(const std::vector<int>& rows,
+                          const std::vector<int>& cols,
+                          const ValueType alpha,
+                          arma::Mat<ValueType>& block) const;
+
+    /** \brief Compute <tt>y_inout := alpha * trans(A) * x_in + beta *
+     *  y_inout</tt> for several vectors at once.
+     *
+     *  \p x_in and \p y_inout point to the column-major storage of matrices
+     *  with \p vectorCount columns, whose number of rows is the number of
+     *  columns and rows of <tt>trans(A)</tt>, respectively. The matrix is
+     *  traversed only once for all the vectors. */
+    void applyToBlock(const TranspositionMode trans,
+                      const ValueType* x_in,
+                      ValueType* y_inout,
+                      int vectorCount,
+                      const ValueType alpha,
+                      const ValueType beta) const;
+
+    /** \brief Number of stored entries. */
+    size_t nonzeroCount() const {
+        return m_values.size();
+    }
+
+    /** \brief Offsets of the rows in columnIndices() and values(). */
+    const std::vector<size_t>& rowOffsets() const {
+        return m_rowOffsets;
+    }
+
+    /** \brief Column indices of the stored entries. */
+    const std::vector<int>& columnIndices() const {
+        return m_columnIndices;
+    }
+
+    /** \brief Values of the stored entries. */
+    const std::vector<ValueType>& values() const {
+        return m_values;
+    }
+
+#ifdef WITH_TRILINOS
+public:
+    virtual Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType> > domain() const;
+    virtual Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType> > range() const;
+
+protected:
+    virtual bool opSupportedImpl(Thyra::EOpTransp M_trans) const;
+#endif
+
+private:
+    virtual void applyBuiltInImpl(const TranspositionMode trans,
+                                  const arma::Col<ValueType>& x_in,
+                                  arma::Col<ValueType>& y_inout,
+                                  const ValueType alpha,
+                                  const ValueType beta) const;
+
+private:
+    /** \cond PRIVATE */
+    enum { GRAIN_SIZE = 1024 };
+
+    unsigned int m_rowCount;
+    unsigned int m_columnCount;
+    std::vector<size_t> m_rowOffsets;
+    std::vector<int> m_columnIndices;
+    std::vector<ValueType> m_values;
+#ifdef WITH_TRILINOS
+    Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType> > m_domainSpace;
+    Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType> > m_rangeSpace;
+#endif
+    /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,144 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef dof_ordering_hpp
+#define dof_ordering_hpp
+
+#include "common/common.hpp"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace Bempp
+{
+
+/** \brief Numbering of the DOFs of a vector space built from a scalar space
+ *  with \p n DOFs, each copied to \p codomainDim components. */
+enum DofOrdering
+{
+    /** \brief The DOF with index \p i is the <tt>(i % codomainDim)</tt>th
+     *  component of the scalar DOF <tt>i / codomainDim</tt>. */
+    INTERLEAVED_DOFS,
+    /** \brief The DOF with index \p i is the <tt>(i / n)</tt>th component of
+     *  the scalar DOF <tt>i % n</tt>, i.e. the DOFs of each component form a
+     *  contiguous block. */
+    BLOCKED_DOFS
+};
+
+/** \brief Map between the DOFs of a vector space and pairs (scalar DOF,
+ *  component) for a given DofOrdering. */
+class VectorDofNumbering
+{
+public:
+    VectorDofNumbering(DofOrdering ordering, int componentCount,
+                       size_t scalarDofCount) :
+        m_ordering(ordering), m_componentCount(componentCount),
+        m_scalarDofCount(scalarDofCount)
+    {}
+
+    DofOrdering ordering() const {
+        return m_ordering;
+    }
+
+    int componentCount() const {
+        return m_componentCount;
+    }
+
+    size_t scalarDofCount() const {
+        return m_scalarDofCount;
+    }
+
+    /** \brief Index of the component \p component of the scalar DOF \p
+     *  scalarDof. */
+    size_t vectorDof(size_t scalarDof, int component) const {
+        return m_ordering == INTERLEAVED_DOFS ?
+            scalarDof * m_componentCount + component :
+            component * m_scalarDofCount + scalarDof;
+    }
+
+    /** \brief Scalar DOF corresponding to the vector DOF \p vectorDof. */
+    size_t scalarDof(size_t vectorDof) const {
+        return m_ordering == INTERLEAVED_DOFS ?
+            vectorDof / m_componentCount : vectorDof % m_scalarDofCount;
+    }
+
+    /** \brief Component corresponding to the vector DOF \p vectorDof. */
+    int component(size_t vectorDof) const {
+        return m_ordering == INTERLEAVED_DOFS ?
+            vectorDof % m_componentCount : vectorDof / m_scalarDofCount;
+    }
+
+private:
+    /** \cond PRIVATE */
+    DofOrdering m_ordering;
+    int m_componentCount;
+    size_t m_scalarDofCount;
+    /** \endcond */
+};
+
+/** \cond PRIVATE */
+// Number of scalar DOFs processed at a time by the permutation kernels;
+// chosen so that the data touched by a tile fits in the L1 cache.
+const size_t DOF_PERMUTATION_TILE_SIZE = 256;
+/** \endcond */
+
+/** \brief Convert the array \p in, containing the values of \p
+ *  componentCount components of \p scalarDofCount scalar DOFs in the
+ *  interleaved ordering, to the blocked ordering, storing the result in \p
+ *  out.
+ *
+ *  The arrays must not overlap. The conversion is done in tiles so that
+ *  both the strided reads and the contiguous writes stay in cache. */
+template <typename T>
+void interleavedToBlockedDofs(const T* in, T* out,
+                              size_t scalarDofCount, int componentCount)
+{
+    for (size_t begin = 0; begin < scalarDofCount;
+         begin += DOF_PERMUTATION_TILE_SIZE) {
+        const size_t end =
+            std::min(scalarDofCount, begin + DOF_PERMUTATION_TILE_SIZE);
+        for (int c = 0; c < componentCount; ++c) {
+            T* outComponent = out + c * scalarDofCount;
+            for (size_t i = begin; i < end; ++i)
+                outComponent[i] = in[i * componentCount + c];
+        }
+    }
+}
+
+/** \brief Inverse of interleavedToBlockedDofs(). */
+template <typename T>
+void blockedToInterleavedDofs(const T* in, T* out,
+                              size_t scalarDofCount, int componentCount)
+{
+    for (size_t begin = 0; begin < scalarDofCount;
+         begin += DOF_PERMUTATION_TILE_SIZE) {
+        const size_t end =
+            std::min(scalarDofCount, begin + DOF_PERMUTATION_TILE_SIZE);
+        for (int c = 0; c < componentCount; ++c) {
+            const T* inComponent = in + c * scalarDofCount;
+            for (size_t i = begin; i < end; ++i)
+                out[i * componentCount + c] = inComponent[i];
+        }
+    }
+}
+
+} // namespace Bempp
+
+#endif
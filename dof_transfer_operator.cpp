@@ -0,0 +1,389 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "dof_transfer_operator.hpp"
+
+#include "csr_discrete_boundary_operator.hpp"
+#include "simple_vector_space.hpp"
+
+#include "fiber/explicit_instantiation.hpp"
+#include "grid/grid.hpp"
+
+#include <algorithm>
+#include <boost/make_shared.hpp>
+#include <utility>
+
+namespace Bempp
+{
+
+namespace
+{
+
+template <typename BasisFunctionType>
+VectorDofNumbering numberingOf(const SimpleVectorSpaceBase<BasisFunctionType>& space)
+{
+    return VectorDofNumbering(space.dofOrdering(), space.codomainDimension(),
+                              space.scalarSpace()->globalDofCount());
+}
+
+// Expand an operator acting on scalar coefficients (given in the CSR format)
+// to the operator acting on each component of vector coefficients
+template <typename BasisFunctionType>
+shared_ptr<const DofTransferOperator<BasisFunctionType> >
+expandToComponents(const VectorDofNumbering& sourceNumbering,
+                   const VectorDofNumbering& targetNumbering,
+                   const std::vector<size_t>& scalarOffsets,
+                   const std::vector<GlobalDofIndex>& scalarSourceDofs,
+                   const std::vector<BasisFunctionType>& scalarWeights)
+{
+    const int componentCount = targetNumbering.componentCount();
+    const size_t targetDofCount =
+        targetNumbering.scalarDofCount() * componentCount;
+    std::vector<size_t> offsets(targetDofCount + 1);
+    std::vector<GlobalDofIndex> sourceDofs;
+    std::vector<BasisFunctionType> weights;
+    sourceDofs.reserve(scalarSourceDofs.size() * componentCount);
+    weights.reserve(scalarWeights.size() * componentCount);
+    offsets[0] = 0;
+    for (size_t dof = 0; dof < targetDofCount; ++dof) {
+        const size_t row = targetNumbering.scalarDof(dof);
+        const int component = targetNumbering.component(dof);
+        for (size_t k = scalarOffsets[row]; k < scalarOffsets[row + 1]; ++k) {
+            sourceDofs.push_back(
+                sourceNumbering.vectorDof(scalarSourceDofs[k], component));
+            weights.push_back(scalarWeights[k]);
+        }
+        offsets[dof + 1] = sourceDofs.size();
+    }
+    return boost::make_shared<DofTransferOperator<BasisFunctionType> >(
+        sourceNumbering.scalarDofCount() * componentCount,
+        offsets, sourceDofs, weights);
+}
+
+template <typename ResultType>
+bool columnLess(const std::pair<int, ResultType>& a,
+                const std::pair<int, ResultType>& b)
+{
+    return a.first < b.first;
+}
+
+template <typename BasisFunctionType>
+struct DofPair
+{
+    GlobalDofIndex continuousDof;
+    GlobalDofIndex discontinuousDof;
+    // Factor converting the coefficient of the continuous DOF to that of
+    // the discontinuous DOF
+    BasisFunctionType weight;
+};
+
+// Local DOF attached to a scalar DOF of a discontinuous space
+template <typename BasisFunctionType>
+struct AttachedLocalDof
+{
+    LocalDof localDof;
+    GlobalDofIndex scalarDof;
+    BasisFunctionType weight;
+};
+
+template <typename BasisFunctionType>
+bool localDofLess(const AttachedLocalDof<BasisFunctionType>& a,
+                  const AttachedLocalDof<BasisFunctionType>& b)
+{
+    return a.localDof.entityIndex < b.localDof.entityIndex ||
+        (a.localDof.entityIndex == b.localDof.entityIndex &&
+         a.localDof.dofIndex < b.localDof.dofIndex);
+}
+
+// Store in offsets, localDofs and weights the local DOFs of the component 0
+// of all scalar DOFs of space, in the format of
+// SimpleVectorSpaceBase::global2localDofs()
+template <typename BasisFunctionType>
+void getLocalDofsOfFirstComponent(
+    const SimpleVectorSpaceBase<BasisFunctionType>& space,
+    std::vector<size_t>& offsets,
+    std::vector<LocalDof>& localDofs,
+    std::vector<BasisFunctionType>& weights)
+{
+    const VectorDofNumbering numbering = numberingOf(space);
+    const size_t scalarDofCount = numbering.scalarDofCount();
+    std::vector<GlobalDofIndex> globalDofs(scalarDofCount);
+    for (size_t i = 0; i < scalarDofCount; ++i)
+        globalDofs[i] = numbering.vectorDof(i, 0);
+    space.global2localDofs(globalDofs.empty() ? 0 : &globalDofs[0],
+                           scalarDofCount, offsets, localDofs, weights);
+}
+
+// Collect the pairs of continuous and discontinuous scalar DOFs attached to
+// the same local DOFs. The local DOFs are looked up in the precomputed
+// global-to-local maps of the spaces, without traversing the grid.
+template <typename BasisFunctionType>
+void collectDofPairs(
+    const SimpleVectorSpaceBase<BasisFunctionType>& continuous,
+    const SimpleVectorSpaceBase<BasisFunctionType>& discontinuous,
+    std::vector<DofPair<BasisFunctionType> >& pairs)
+{
+    if (continuous.grid().get() != discontinuous.grid().get() ||
+            continuous.codomainDimension() != discontinuous.codomainDimension())
+        throw std::invalid_argument(
+            "continuousToDiscontinuousOperator(): spaces must be defined on "
+            "the same grid and have the same number of components");
+
+    std::vector<size_t> offsets;
+    std::vector<LocalDof> localDofs;
+    std::vector<BasisFunctionType> weights;
+
+    // Local DOFs of the discontinuous space, sorted for binary searches
+    getLocalDofsOfFirstComponent(discontinuous, offsets, localDofs, weights);
+    std::vector<AttachedLocalDof<BasisFunctionType> > attached(localDofs.size());
+    for (size_t i = 0; i + 1 < offsets.size(); ++i)
+        for (size_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+            attached[k].localDof = localDofs[k];
+            attached[k].scalarDof = i;
+            attached[k].weight = weights[k];
+        }
+    std::sort(attached.begin(), attached.end(),
+              localDofLess<BasisFunctionType>);
+
+    getLocalDofsOfFirstComponent(continuous, offsets, localDofs, weights);
+    AttachedLocalDof<BasisFunctionType> key;
+    DofPair<BasisFunctionType> pair;
+    pairs.clear();
+    pairs.reserve(attached.size());
+    for (size_t i = 0; i + 1 < offsets.size(); ++i)
+        for (size_t k = offsets[i]; k < offsets[i + 1]; ++k) {
+            key.localDof = localDofs[k];
+            typename std::vector<AttachedLocalDof<BasisFunctionType> >::
+                    const_iterator it = std::lower_bound(
+                        attached.begin(), attached.end(), key,
+                        localDofLess<BasisFunctionType>);
+            if (it == attached.end() ||
+                    it->localDof.entityIndex != key.localDof.entityIndex ||
+                    it->localDof.dofIndex != key.localDof.dofIndex)
+                continue;
+            pair.continuousDof = i;
+            pair.discontinuousDof = it->scalarDof;
+            pair.weight = weights[k] / it->weight;
+            pairs.push_back(pair);
+        }
+}
+
+} // namespace
+
+template <typename BasisFunctionType>
+DofTransferOperator<BasisFunctionType>::DofTransferOperator(
+    size_t sourceDofCount,
+    const std::vector<size_t>& rowOffsets,
+    const std::vector<GlobalDofIndex>& sourceDofs,
+    const std::vector<BasisFunctionType>& weights) :
+    m_sourceDofCount(sourceDofCount),
+    m_rowOffsets(rowOffsets),
+    m_sourceDofs(sourceDofs),
+    m_weights(weights)
+{
+    if (rowOffsets.empty() || rowOffsets[0] != 0 ||
+            rowOffsets.back() != weights.size() ||
+            sourceDofs.size() != weights.size())
+        throw std::invalid_argument(
+            "DofTransferOperator::DofTransferOperator(): "
+            "inconsistent array sizes");
+    for (size_t k = 0; k < sourceDofs.size(); ++k)
+        if (sourceDofs[k] < 0 || sourceDofs[k] >= (GlobalDofIndex)sourceDofCount)
+            throw std::invalid_argument(
+                "DofTransferOperator::DofTransferOperator(): "
+                "source DOF out of range");
+}
+
+template <typename BasisFunctionType>
+template <typename ResultType>
+shared_ptr<const CsrDiscreteBoundaryOperator<ResultType> >
+DofTransferOperator<BasisFunctionType>::asDiscreteOperator() const
+{
+    // The rows of a transfer operator need not be sorted by source DOF, but
+    // those of a CSR operator must be; duplicate source DOFs are merged
+    const size_t rowCount = targetDofCount();
+    std::vector<size_t> offsets(rowCount + 1);
+    std::vector<int> columns;
+    std::vector<ResultType> values;
+    columns.reserve(m_sourceDofs.size());
+    values.reserve(m_weights.size());
+    std::vector<std::pair<int, ResultType> > row;
+    offsets[0] = 0;
+    for (size_t i = 0; i < rowCount; ++i) {
+        row.clear();
+        for (size_t k = m_rowOffsets[i]; k < m_rowOffsets[i + 1]; ++k)
+            row.push_back(std::make_pair(static_cast<int>(m_sourceDofs[k]),
+                                         static_cast<ResultType>(m_weights[k])));
+        std::sort(row.begin(), row.end(), columnLess<ResultType>);
+        for (size_t k = 0; k < row.size(); ++k)
+            if (k > 0 && row[k].first == row[k - 1].first)
+                values.back() += row[k].second;
+            else {
+                columns.push_back(row[k].first);
+                values.push_back(row[k].second);
+            }
+        offsets[i + 1] = values.size();
+    }
+    return boost::make_shared<CsrDiscreteBoundaryOperator<ResultType> >(
+        rowCount, m_sourceDofCount, offsets, columns, values);
+}
+
+template <typename BasisFunctionType>
+shared_ptr<const DofTransferOperator<BasisFunctionType> >
+componentExtractionOperator(const SimpleVectorSpaceBase<BasisFunctionType>& space,
+                            int component)
+{
+    const VectorDofNumbering numbering = numberingOf(space);
+    if (component < 0 || component >= numbering.componentCount())
+        throw std::invalid_argument("componentExtractionOperator(): "
+                                    "invalid component");
+    const size_t scalarDofCount = numbering.scalarDofCount();
+    std::vector<size_t> offsets(scalarDofCount + 1);
+    std::vector<GlobalDofIndex> sourceDofs(scalarDofCount);
+    for (size_t i = 0; i < scalarDofCount; ++i) {
+        offsets[i] = i;
+        sourceDofs[i] = numbering.vectorDof(i, component);
+    }
+    offsets[scalarDofCount] = scalarDofCount;
+    return boost::make_shared<DofTransferOperator<BasisFunctionType> >(
+        space.globalDofCount(), offsets, sourceDofs,
+        std::vector<BasisFunctionType>(scalarDofCount, 1.));
+}
+
+template <typename BasisFunctionType>
+shared_ptr<const DofTransferOperator<BasisFunctionType> >
+componentInjectionOperator(const SimpleVectorSpaceBase<BasisFunctionType>& space,
+                           int component)
+{
+    const VectorDofNumbering numbering = numberingOf(space);
+    if (component < 0 || component >= numbering.componentCount())
+        throw std::invalid_argument("componentInjectionOperator(): "
+                                    "invalid component");
+    const size_t scalarDofCount = numbering.scalarDofCount();
+    const size_t dofCount = space.globalDofCount();
+    std::vector<size_t> offsets(dofCount + 1);
+    std::vector<GlobalDofIndex> sourceDofs;
+    sourceDofs.reserve(scalarDofCount);
+    offsets[0] = 0;
+    for (size_t dof = 0; dof < dofCount; ++dof) {
+        if (numbering.component(dof) == component)
+            sourceDofs.push_back(numbering.scalarDof(dof));
+        offsets[dof + 1] = sourceDofs.size();
+    }
+    return boost::make_shared<DofTransferOperator<BasisFunctionType> >(
+        scalarDofCount, offsets, sourceDofs,
+        std::vector<BasisFunctionType>(sourceDofs.size(), 1.));
+}
+
+template <typename BasisFunctionType>
+shared_ptr<const DofTransferOperator<BasisFunctionType> >
+continuousToDiscontinuousOperator(
+    const SimpleVectorSpaceBase<BasisFunctionType>& continuous,
+    const SimpleVectorSpaceBase<BasisFunctionType>& discontinuous)
+{
+    std::vector<DofPair<BasisFunctionType> > pairs;
+    collectDofPairs(continuous, discontinuous, pairs);
+
+    // Each discontinuous DOF is attached to a single element, so it has at
+    // most one source
+    const size_t scalarDofCount = discontinuous.scalarSpace()->globalDofCount();
+    std::vector<GlobalDofIndex> sources(scalarDofCount, -1);
+    std::vector<BasisFunctionType> pairWeights(scalarDofCount);
+    for (size_t p = 0; p < pairs.size(); ++p) {
+        sources[pairs[p].discontinuousDof] = pairs[p].continuousDof;
+        pairWeights[pairs[p].discontinuousDof] = pairs[p].weight;
+    }
+    std::vector<size_t> offsets(scalarDofCount + 1);
+    std::vector<GlobalDofIndex> sourceDofs;
+    std::vector<BasisFunctionType> weights;
+    offsets[0] = 0;
+    for (size_t i = 0; i < scalarDofCount; ++i) {
+        if (sources[i] >= 0) {
+            sourceDofs.push_back(sources[i]);
+            weights.push_back(pairWeights[i]);
+        }
+        offsets[i + 1] = sourceDofs.size();
+    }
+    return expandToComponents(numberingOf(continuous), numberingOf(discontinuous),
+                              offsets, sourceDofs, weights);
+}
+
+template <typename BasisFunctionType>
+shared_ptr<const DofTransferOperator<BasisFunctionType> >
+discontinuousToContinuousOperator(
+    const SimpleVectorSpaceBase<BasisFunctionType>& discontinuous,
+    const SimpleVectorSpaceBase<BasisFunctionType>& continuous)
+{
+    std::vector<DofPair<BasisFunctionType> > pairs;
+    collectDofPairs(continuous, discontinuous, pairs);
+
+    // Counting sort of the pairs by continuous DOF
+    const size_t scalarDofCount = continuous.scalarSpace()->globalDofCount();
+    std::vector<size_t> offsets(scalarDofCount + 1, 0);
+    for (size_t p = 0; p < pairs.size(); ++p)
+        ++offsets[pairs[p].continuousDof + 1];
+    for (size_t i = 0; i < scalarDofCount; ++i)
+        offsets[i + 1] += offsets[i];
+    std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+    std::vector<GlobalDofIndex> sourceDofs(pairs.size());
+    std::vector<BasisFunctionType> weights(pairs.size());
+    for (size_t p = 0; p < pairs.size(); ++p) {
+        const size_t k = next[pairs[p].continuousDof]++;
+        sourceDofs[k] = pairs[p].discontinuousDof;
+        weights[k] = static_cast<BasisFunctionType>(1.) / pairs[p].weight;
+    }
+    // Average the contributions
+    for (size_t i = 0; i < scalarDofCount; ++i) {
+        const size_t count = offsets[i + 1] - offsets[i];
+        for (size_t k = offsets[i]; k < offsets[i + 1]; ++k)
+            weights[k] /= static_cast<BasisFunctionType>(count);
+    }
+    return expandToComponents(numberingOf(discontinuous), numberingOf(continuous),
+                              offsets, sourceDofs, weights);
+}
+
+#define INSTANTIATE_DOF_TRANSFER_OPERATOR(BASIS) \
+    template class DofTransferOperator< BASIS >;
+FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_DOF_TRANSFER_OPERATOR);
+
+#define INSTANTIATE_DOF_TRANSFER_OPERATOR_AS_DISCRETE_OPERATOR(BASIS, RESULT) \
+    template shared_ptr<const CsrDiscreteBoundaryOperator< RESULT > > \
+    DofTransferOperator< BASIS >::asDiscreteOperator< RESULT >() const
+FIBER_ITERATE_OVER_BASIS_AND_RESULT_TYPES(
+    INSTANTIATE_DOF_TRANSFER_OPERATOR_AS_DISCRETE_OPERATOR);
+
+#define INSTANTIATE_DOF_TRANSFER_OPERATOR_FACTORIES(BASIS) \
+    template shared_ptr<const DofTransferOperator< BASIS > > \
+    componentExtractionOperator( \
+        const SimpleVectorSpaceBase< BASIS >& space, int component); \
+    template shared_ptr<const DofTransferOperator< BASIS > > \
+    componentInjectionOperator( \
+        const SimpleVectorSpaceBase< BASIS >& space, int component); \
+    template shared_ptr<const DofTransferOperator< BASIS > > \
+    continuousToDiscontinuousOperator( \
+        const SimpleVectorSpaceBase< BASIS >& continuous, \
+        const SimpleVectorSpaceBase< BASIS >& discontinuous); \
+    template shared_ptr<const DofTransferOperator< BASIS > > \
+    discontinuousToContinuousOperator( \
+        const SimpleVectorSpaceBase< BASIS >& discontinuous, \
+        const SimpleVectorSpaceBase< BASIS >& continuous)
+FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_DOF_TRANSFER_OPERATOR_FACTORIES);
+
+} // namespace Bempp
@@ -0,0 +1,209 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef dof_transfer_operator_hpp
+#define dof_transfer_operator_hpp
+
+#include "common/common.hpp"
+#include "common/scalar_traits.hpp"
+#include "common/shared_ptr.hpp"
+#include "common/types.hpp"
+
+#include <armadillo>
+#include <stdexcept>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <vector>
+
+namespace Bempp
+{
+
+template <typename ValueType> class CsrDiscreteBoundaryOperator;
+template <typename BasisFunctionType> class SimpleVectorSpaceBase;
+
+/** \brief Sparse linear map between the coefficient vectors of two spaces.
+ *
+ *  The map is stored in the CSR format, one row per DOF of the target
+ *  space: the coefficient of the target DOF \p i is the weighted sum of the
+ *  coefficients of the source DOFs <tt>sourceDofs()[k]</tt>, with weights
+ *  <tt>weights()[k]</tt>, for \p k from <tt>rowOffsets()[i]</tt> to
+ *  <tt>rowOffsets()[i + 1] - 1</tt>. Each target coefficient is thus
+ *  gathered from the source vector, so that apply() processes the target
+ *  DOFs in parallel without any synchronization.
+ *
+ *  Objects of this class are returned by
+ *  SimpleVectorSpace::componentExtractor(),
+ *  SimpleVectorSpace::componentInjector(),
+ *  PiecewiseLinearContinuousVectorSpace::prolongationToDiscontinuousSpace()
+ *  and PiecewiseLinearContinuousVectorSpace::restrictionFromDiscontinuousSpace(),
+ *  which cache them. */
+template <typename BasisFunctionType>
+class DofTransferOperator
+{
+public:
+    /** \brief Constructor.
+     *
+     *  An exception is thrown if the arrays are inconsistent with each
+     *  other or with \p sourceDofCount. */
+    DofTransferOperator(size_t sourceDofCount,
+                        const std::vector<size_t>& rowOffsets,
+                        const std::vector<GlobalDofIndex>& sourceDofs,
+                        const std::vector<BasisFunctionType>& weights);
+
+    /** \brief Number of DOFs of the source space. */
+    size_t sourceDofCount() const {
+        return m_sourceDofCount;
+    }
+
+    /** \brief Number of DOFs of the target space. */
+    size_t targetDofCount() const {
+        return m_rowOffsets.size() - 1;
+    }
+
+    /** \brief Offsets of the rows in sourceDofs() and weights(). */
+    const std::vector<size_t>& rowOffsets() const {
+        return m_rowOffsets;
+    }
+
+    /** \brief Source DOFs of the stored entries. */
+    const std::vector<GlobalDofIndex>& sourceDofs() const {
+        return m_sourceDofs;
+    }
+
+    /** \brief Weights of the stored entries. */
+    const std::vector<BasisFunctionType>& weights() const {
+        return m_weights;
+    }
+
+    /** \brief Store in \p target the coefficients of the target space
+     *  obtained from the coefficients \p source of the source space.
+     *
+     *  An exception is thrown if \p source has an incorrect length. */
+    template <typename ResultType>
+    void apply(const arma::Col<ResultType>& source,
+               arma::Col<ResultType>& target) const;
+
+    /** \brief Return a discrete operator equivalent to this map. */
+    template <typename ResultType>
+    shared_ptr<const CsrDiscreteBoundaryOperator<ResultType> >
+    asDiscreteOperator() const;
+
+private:
+    /** \cond PRIVATE */
+    enum { GRAIN_SIZE = 1024 };
+
+    size_t m_sourceDofCount;
+    std::vector<size_t> m_rowOffsets;
+    std::vector<GlobalDofIndex> m_sourceDofs;
+    std::vector<BasisFunctionType> m_weights;
+    /** \endcond */
+};
+
+/** \cond PRIVATE */
+template <typename BasisFunctionType, typename ResultType>
+class DofTransferLoopBody
+{
+public:
+    DofTransferLoopBody(const DofTransferOperator<BasisFunctionType>& op,
+                        const arma::Col<ResultType>& source,
+                        arma::Col<ResultType>& target) :
+        m_op(op), m_source(source), m_target(target)
+    {}
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        const std::vector<size_t>& offsets = m_op.rowOffsets();
+        const std::vector<GlobalDofIndex>& sourceDofs = m_op.sourceDofs();
+        const std::vector<BasisFunctionType>& weights = m_op.weights();
+        for (size_t row = r.begin(); row < r.end(); ++row) {
+            ResultType sum = 0.;
+            for (size_t k = offsets[row]; k < offsets[row + 1]; ++k)
+                sum += weights[k] * m_source(sourceDofs[k]);
+            m_target(row) = sum;
+        }
+    }
+
+private:
+    const DofTransferOperator<BasisFunctionType>& m_op;
+    const arma::Col<ResultType>& m_source;
+    arma::Col<ResultType>& m_target;
+};
+/** \endcond */
+
+template <typename BasisFunctionType>
+template <typename ResultType>
+void DofTransferOperator<BasisFunctionType>::apply(
+    const arma::Col<ResultType>& source, arma::Col<ResultType>& target) const
+{
+    if (source.n_rows != m_sourceDofCount)
+        throw std::invalid_argument("DofTransferOperator::apply(): "
+                                    "vector source has incorrect length");
+    target.set_size(targetDofCount());
+    DofTransferLoopBody<BasisFunctionType, ResultType> body(*this, source, target);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, targetDofCount(), GRAIN_SIZE),
+                      body);
+}
+
+/** \brief Return the operator extracting the coefficients of the component
+ *  \p component of functions from the SimpleVectorSpace \p space.
+ *
+ *  The target space is the scalar space of \p space. */
+template <typename BasisFunctionType>
+shared_ptr<const DofTransferOperator<BasisFunctionType> >
+componentExtractionOperator(const SimpleVectorSpaceBase<BasisFunctionType>& space,
+                            int component);
+
+/** \brief Return the operator injecting functions from the scalar space of
+ *  the SimpleVectorSpace \p space into the component \p component of \p
+ *  space; the other components are set to zero. */
+template <typename BasisFunctionType>
+shared_ptr<const DofTransferOperator<BasisFunctionType> >
+componentInjectionOperator(const SimpleVectorSpaceBase<BasisFunctionType>& space,
+                           int component);
+
+/** \brief Return the operator mapping functions from \p continuous to the
+ *  same functions expressed in the basis of \p discontinuous.
+ *
+ *  The scalar spaces of \p continuous and \p discontinuous must attach
+ *  corresponding local DOFs to each element, as the continuous and
+ *  discontinuous piecewise linear spaces do. Each DOF of \p discontinuous
+ *  is gathered from the single DOF of \p continuous attached to the same
+ *  local DOF. */
+template <typename BasisFunctionType>
+shared_ptr<const DofTransferOperator<BasisFunctionType> >
+continuousToDiscontinuousOperator(
+        const SimpleVectorSpaceBase<BasisFunctionType>& continuous,
+        const SimpleVectorSpaceBase<BasisFunctionType>& discontinuous);
+
+/** \brief Return the operator mapping functions from \p discontinuous to
+ *  \p continuous by averaging the coefficients of all DOFs of \p
+ *  discontinuous attached to the same DOF of \p continuous.
+ *
+ *  The spaces must satisfy the same conditions as in
+ *  continuousToDiscontinuousOperator(); the returned operator is a left
+ *  inverse of the operator returned by that function. */
+template <typename BasisFunctionType>
+shared_ptr<const DofTransferOperator<BasisFunctionType> >
+discontinuousToContinuousOperator(
+        const SimpleVectorSpaceBase<BasisFunctionType>& discontinuous,
+        const SimpleVectorSpaceBase<BasisFunctionType>& continuous);
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,144 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "element_dof_table.hpp"
+
+#include "grid_segment_element_list.hpp"
+
+#include "common/acc.hpp"
+#include "fiber/explicit_instantiation.hpp"
+#include "grid/entity.hpp"
+#include "grid/entity_iterator.hpp"
+#include "grid/grid.hpp"
+#include "grid/grid_view.hpp"
+#include "grid/index_set.hpp"
+#include "space/space.hpp"
+
+#include <memory>
+#include <stdexcept>
+
+namespace Bempp
+{
+
+template <typename BasisFunctionType>
+ElementDofTable<BasisFunctionType>::ElementDofTable(
+    const Space<BasisFunctionType>& scalarSpace, int codomainDim,
+    DofOrdering ordering, const GridSegmentElementList* elements) :
+    m_view(scalarSpace.grid()->leafView().release())
+{
+    const VectorDofNumbering numbering(ordering, codomainDim,
+                                       scalarSpace.globalDofCount());
+    const IndexSet& indexSet = m_view->indexSet();
+    const size_t elementCount = m_view->entityCount(0);
+
+    std::vector<GlobalDofIndex> scalarDofs;
+    std::vector<BasisFunctionType> scalarWeights;
+
+    // First pass: count the DOFs of each element
+    m_offsets.assign(elementCount + 1, 0);
+    if (elements) {
+        for (size_t i = 0; i < elements->size(); ++i) {
+            scalarSpace.getGlobalDofs(elements->element(i),
+                                      scalarDofs, scalarWeights);
+            acc(m_offsets, elements->elementIndex(i) + 1) =
+                scalarDofs.size() * codomainDim;
+        }
+    } else {
+        std::auto_ptr<EntityIterator<0> > it = m_view->entityIterator<0>();
+        for (; !it->finished(); it->next()) {
+            const Entity<0>& element = it->entity();
+            scalarSpace.getGlobalDofs(element, scalarDofs, scalarWeights);
+            acc(m_offsets, indexSet.entityIndex(element) + 1) =
+                scalarDofs.size() * codomainDim;
+        }
+    }
+    for (size_t e = 0; e < elementCount; ++e)
+        acc(m_offsets, e + 1) += acc(m_offsets, e);
+
+    // Second pass: fill in the DOFs and weights
+    m_dofs.resize(m_offsets.back());
+    m_weights.resize(m_offsets.back());
+    if (elements) {
+        for (size_t i = 0; i < elements->size(); ++i) {
+            scalarSpace.getGlobalDofs(elements->element(i),
+                                      scalarDofs, scalarWeights);
+            fillElement(elements->elementIndex(i), numbering,
+                        scalarDofs, scalarWeights);
+        }
+    } else {
+        std::auto_ptr<EntityIterator<0> > it = m_view->entityIterator<0>();
+        for (; !it->finished(); it->next()) {
+            const Entity<0>& element = it->entity();
+            scalarSpace.getGlobalDofs(element, scalarDofs, scalarWeights);
+            fillElement(indexSet.entityIndex(element), numbering,
+                        scalarDofs, scalarWeights);
+        }
+    }
+}
+
+template <typename BasisFunctionType>
+void ElementDofTable<BasisFunctionType>::fillElement(
+    size_t elementIndex, const VectorDofNumbering& numbering,
+    const std::vector<GlobalDofIndex>& scalarDofs,
+    const std::vector<BasisFunctionType>& scalarWeights)
+{
+    size_t offset = acc(m_offsets, elementIndex);
+    for (size_t i = 0; i < scalarDofs.size(); ++i)
+        for (int d = 0; d < numbering.componentCount(); ++d, ++offset) {
+            const GlobalDofIndex scalarDof = acc(scalarDofs, i);
+            acc(m_dofs, offset) =
+                scalarDof < 0 ? scalarDof : numbering.vectorDof(scalarDof, d);
+            acc(m_weights, offset) = acc(scalarWeights, i);
+        }
+}
+
+template <typename BasisFunctionType>
+ElementDofTable<BasisFunctionType>::~ElementDofTable()
+{
+}
+
+template <typename BasisFunctionType>
+size_t ElementDofTable<BasisFunctionType>::elementIndex(
+    const Entity<0>& element) const
+{
+    return m_view->indexSet().entityIndex(element);
+}
+
+template <typename BasisFunctionType>
+ElementDofRange<BasisFunctionType>
+ElementDofTable<BasisFunctionType>::elements(
+    size_t beginElementIndex, size_t endElementIndex) const
+{
+    if (beginElementIndex > endElementIndex || endElementIndex > elementCount())
+        throw std::out_of_range("ElementDofTable::elements(): "
+                                "invalid element index range");
+    ElementDofRange<BasisFunctionType> range;
+    range.offsets = &m_offsets[beginElementIndex];
+    range.dofs = m_dofs.empty() ? 0 : &m_dofs[0];
+    range.weights = m_weights.empty() ? 0 : &m_weights[0];
+    range.elementCount = endElementIndex - beginElementIndex;
+    return range;
+}
+
+#define INSTANTIATE_ELEMENT_DOF_TABLE(BASIS) \
+    template class ElementDofTable< BASIS >;
+FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_ELEMENT_DOF_TABLE);
+
+} // namespace Bempp
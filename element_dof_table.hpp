@@ -0,0 +1,154 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef element_dof_table_hpp
+#define element_dof_table_hpp
+
+#include "dof_ordering.hpp"
+
+#include "common/common.hpp"
+#include "common/types.hpp"
+
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <vector>
+
+namespace Bempp
+{
+
+template <typename BasisFunctionType> class Space;
+template <int codim> class Entity;
+class GridSegmentElementList;
+class GridView;
+
+/** \brief Read-only view of the global DOFs of a contiguous range of elements.
+ *
+ *  The DOFs of the <tt>i</tt>th element of the range are stored in
+ *  <tt>dofs[offsets[i]]</tt>, ..., <tt>dofs[offsets[i + 1] - 1]</tt>; the
+ *  corresponding local DOF weights in \p weights at the same positions. */
+template <typename BasisFunctionType>
+struct ElementDofRange
+{
+    const size_t* offsets;
+    const GlobalDofIndex* dofs;
+    const BasisFunctionType* weights;
+    size_t elementCount;
+
+    size_t dofCount(size_t i) const {
+        return offsets[i + 1] - offsets[i];
+    }
+
+    const GlobalDofIndex* elementDofs(size_t i) const {
+        return dofs + offsets[i];
+    }
+
+    const BasisFunctionType* elementWeights(size_t i) const {
+        return weights + offsets[i];
+    }
+};
+
+/** \brief Element-to-global-DOF map of a SimpleVectorSpace stored in the
+ *  compressed sparse row format.
+ *
+ *  The table is filled once, on construction, from the element-to-DOF map
+ *  of the underlying scalar space; each scalar DOF is expanded into
+ *  \p codomainDim vector DOFs numbered according to \p ordering. Negative
+ *  (unused) scalar DOFs stay negative.
+ *  Elements are identified by their indices in the leaf view of the grid.
+ *
+ *  If a list of elements is passed to the constructor, only these elements
+ *  are queried; all other elements are assumed to carry no DOFs. This is
+ *  the case for spaces defined strictly on a grid segment and makes the
+ *  cost of building the table proportional to the size of the segment. */
+template <typename BasisFunctionType>
+class ElementDofTable : boost::noncopyable
+{
+public:
+    ElementDofTable(const Space<BasisFunctionType>& scalarSpace, int codomainDim,
+                    DofOrdering ordering = INTERLEAVED_DOFS,
+                    const GridSegmentElementList* elements = 0);
+
+    ~ElementDofTable();
+
+    /** \brief Number of elements of the leaf view. */
+    size_t elementCount() const {
+        return m_offsets.size() - 1;
+    }
+
+    /** \brief Index of \p element in the leaf view. */
+    size_t elementIndex(const Entity<0>& element) const;
+
+    /** \brief Number of global DOFs attached to the element with index \p
+     *  elementIndex. */
+    size_t dofCount(size_t elementIndex) const {
+        return m_offsets[elementIndex + 1] - m_offsets[elementIndex];
+    }
+
+    /** \brief Total number of DOFs attached to all elements, counted once
+     *  per element. */
+    size_t entryCount() const {
+        return m_dofs.size();
+    }
+
+    /** \brief Position of the first DOF of the element with index \p
+     *  elementIndex in the concatenation of the DOFs of all elements.
+     *
+     *  The local DOF \p j of the element is stored at position
+     *  <tt>offset(elementIndex) + j</tt>. */
+    size_t offset(size_t elementIndex) const {
+        return m_offsets[elementIndex];
+    }
+
+    /** \brief Pointer to the global DOFs attached to the element with index
+     *  \p elementIndex. */
+    const GlobalDofIndex* dofs(size_t elementIndex) const {
+        return m_dofs.empty() ? 0 : &m_dofs[m_offsets[elementIndex]];
+    }
+
+    /** \brief Pointer to the local DOF weights of the element with index \p
+     *  elementIndex. */
+    const BasisFunctionType* weights(size_t elementIndex) const {
+        return m_weights.empty() ? 0 : &m_weights[m_offsets[elementIndex]];
+    }
+
+    /** \brief Return the DOFs of the elements with indices
+     *  <tt>[beginElementIndex, endElementIndex)</tt>.
+     *
+     *  No memory is allocated; the returned pointers stay valid as long as
+     *  the table exists. */
+    ElementDofRange<BasisFunctionType> elements(
+            size_t beginElementIndex, size_t endElementIndex) const;
+
+private:
+    /** \cond PRIVATE */
+    void fillElement(size_t elementIndex, const VectorDofNumbering& numbering,
+                     const std::vector<GlobalDofIndex>& scalarDofs,
+                     const std::vector<BasisFunctionType>& scalarWeights);
+
+    boost::scoped_ptr<GridView> m_view;
+    std::vector<size_t> m_offsets;
+    std::vector<GlobalDofIndex> m_dofs;
+    std::vector<BasisFunctionType> m_weights;
+    /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
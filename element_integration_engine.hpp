@@ -0,0 +1,1197 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef element_integration_engine_hpp
+#define element_integration_engine_hpp
+
+#include "grid_segment_element_list.hpp"
+#include "parallel_options.hpp"
+#include "simple_vector_space.hpp"
+
+#include "common/acc.hpp"
+#include "common/common.hpp"
+#include "common/scalar_traits.hpp"
+#include "common/shared_ptr.hpp"
+#include "fiber/basis_data.hpp"
+#include "fiber/default_single_quadrature_rule_family.hpp"
+#include "fiber/function.hpp"
+#include "fiber/geometrical_data.hpp"
+#include "fiber/parallelization_options.hpp"
+#include "fiber/shapeset.hpp"
+#include "grid/entity.hpp"
+#include "grid/geometry.hpp"
+#include "grid/grid.hpp"
+#include "grid/grid_segment.hpp"
+#include "space/space.hpp"
+
+#include <boost/make_shared.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/ref.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_scheduler_init.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+namespace Bempp
+{
+
+/** \cond PRIVATE */
+// Quadrature data shared by all elements with the same shapeset and vertex
+// count
+template <typename BasisFunctionType>
+struct ElementIntegrationBucket
+{
+    typedef typename ScalarTraits<BasisFunctionType>::RealType CoordinateType;
+    typedef typename ScalarTraits<BasisFunctionType>::ComplexType ComplexType;
+
+    const Fiber::Shapeset<BasisFunctionType>* shapeset;
+    int vertexCount;
+    // True if the geometries of the elements are affine, so that their
+    // integration elements are constant
+    bool affine;
+    int functionCount;
+    int componentCount;
+    arma::Mat<CoordinateType> quadPoints;
+    // Entry (f * componentCount + d, q): dth component of the fth basis
+    // function at the qth quadrature point times the qth quadrature weight
+    arma::Mat<BasisFunctionType> weightedValues;
+    // Row sums of weightedValues: integrals of the basis functions over the
+    // reference element
+    arma::Col<BasisFunctionType> referenceIntegrals;
+    // Volume of the reference element
+    CoordinateType referenceVolume;
+    // Quadrature points, basis function values and weighted basis function
+    // values (laid out like weightedValues) of the higher-order rule used by
+    // project() and integrateProducts()
+    arma::Mat<CoordinateType> projectionQuadPoints;
+    arma::Mat<BasisFunctionType> projectionValues;
+    arma::Mat<BasisFunctionType> projectionWeightedValues;
+    // projectionWeightedValues converted to the complex type, used to
+    // project complex-valued functions
+    arma::Mat<ComplexType> complexProjectionWeightedValues;
+};
+
+// Data reused by all batches projected by a single thread
+template <typename ResultType>
+struct ElementProjectionScratch
+{
+    // Function values at the quadrature points of all elements of the batch
+    arma::Mat<ResultType> values;
+    // Column d: dth component of the function times the integration
+    // element at the quadrature points of a single element
+    arma::Mat<ResultType> elementValues;
+    arma::Mat<ResultType> products;
+    arma::Col<ResultType> localProjections;
+};
+
+// Data reused by all elements processed by a single thread
+template <typename BasisFunctionType>
+struct ElementIntegrationScratch
+{
+    typedef typename ScalarTraits<BasisFunctionType>::RealType CoordinateType;
+    typedef typename ScalarTraits<BasisFunctionType>::ComplexType ComplexType;
+
+    // Global DOFs and local DOF weights of the elements of the current
+    // batch with used DOFs; the jth entries belong to the element at
+    // position batchPositions[j]. Only the first batchPositions.size()
+    // entries are valid; the others keep their capacity for later batches.
+    std::vector<std::vector<GlobalDofIndex> > batchGlobalDofs;
+    std::vector<std::vector<BasisFunctionType> > batchLocalDofWeights;
+    arma::Mat<BasisFunctionType> localIntegrals;
+    Fiber::GeometricalData<CoordinateType> geomData;
+    // Positions of the elements of the current batch with used DOFs
+    std::vector<size_t> batchPositions;
+    // Column j: integration elements of the jth element of the batch (a
+    // single row for buckets of affine elements)
+    arma::Mat<BasisFunctionType> batchIntegrationElements;
+    // Column j: integrals of the basis functions over the jth element of
+    // the batch, laid out like the rows of weightedValues
+    arma::Mat<BasisFunctionType> batchIntegrals;
+    // Weighted basis function values multiplied by the integration elements
+    // of a single element
+    arma::Mat<BasisFunctionType> scaledValues;
+    // Integrals of the products of the (compact) basis functions over a
+    // single element
+    arma::Mat<BasisFunctionType> products;
+    // Geometrical data at the quadrature points of all elements of the
+    // current batch, element by element
+    Fiber::GeometricalData<CoordinateType> batchGeomData;
+    // Buffers of project() for functions of type BasisFunctionType and
+    // ComplexType
+    ElementProjectionScratch<BasisFunctionType> projection;
+    ElementProjectionScratch<ComplexType> complexProjection;
+};
+
+// Selects the members of buckets and scratch data used to project functions
+// of type ResultType, which is either BasisFunctionType or its complex
+// counterpart
+template <typename BasisFunctionType, typename ResultType>
+struct ElementProjectionData
+{
+    static const arma::Mat<ResultType>& weightedValues(
+            const ElementIntegrationBucket<BasisFunctionType>& bucket) {
+        return bucket.complexProjectionWeightedValues;
+    }
+
+    static ElementProjectionScratch<ResultType>& scratch(
+            ElementIntegrationScratch<BasisFunctionType>& scratch) {
+        return scratch.complexProjection;
+    }
+};
+
+template <typename BasisFunctionType>
+struct ElementProjectionData<BasisFunctionType, BasisFunctionType>
+{
+    static const arma::Mat<BasisFunctionType>& weightedValues(
+            const ElementIntegrationBucket<BasisFunctionType>& bucket) {
+        return bucket.projectionWeightedValues;
+    }
+
+    static ElementProjectionScratch<BasisFunctionType>& scratch(
+            ElementIntegrationScratch<BasisFunctionType>& scratch) {
+        return scratch.projection;
+    }
+};
+/** \endcond */
+
+/** \brief Engine computing the integrals of the basis functions of a space
+ *  over the elements of a grid segment.
+ *
+ *  For each element of the segment the engine evaluates the matrix of local
+ *  integrals, whose <tt>(i, d)</tt>th entry is the integral of the
+ *  <tt>d</tt>th component of the <tt>i</tt>th basis function attached to the
+ *  element, multiplied by the corresponding local DOF weight. Rows
+ *  corresponding to unused (negative) global DOFs are zero.
+ *
+ *  Since integrals of grid functions are linear in their coefficients, all
+ *  integration routines of this module reduce to combining these matrices
+ *  with the global DOF indices. The combination is done by a \p Consumer
+ *  object passed to integrate(), which must provide
+ *
+ *  - a splitting constructor <tt>Consumer(Consumer& other, tbb::split)</tt>
+ *    creating an empty consumer,
+ *  - <tt>void addElement(size_t elementIndex,
+ *        const std::vector<GlobalDofIndex>& globalDofs,
+ *        const arma::Mat<BasisFunctionType>& localIntegrals)</tt>,
+ *  - <tt>void join(Consumer& other)</tt> merging the contributions
+ *    collected by \p other,
+ *
+ *  like the body of tbb::parallel_reduce. The elements are processed in
+ *  parallel.
+ *
+ *  For SimpleVectorSpaces, the basis functions are evaluated in the compact
+ *  format (see SimpleVectorShapeset::evaluateCompact()), i.e. only their
+ *  non-zero components, which are given by the scalar shapesets.
+ *
+ *  On construction, the elements are sorted into buckets of elements sharing
+ *  the same shapeset and vertex count, and the quadrature points and the
+ *  basis function values weighted by the quadrature weights are evaluated
+ *  once per bucket. The elements of a bucket are then integrated in batches:
+ *  the integrals over all elements of a batch are obtained as a single
+ *  product of the matrix of weighted basis function values with the matrix
+ *  whose columns contain the integration elements of the individual
+ *  elements.
+ *
+ *  Elements with affine geometries (e.g. flat triangles) are bucketed
+ *  separately. Their integration elements are constant, so the integrals of
+ *  the basis functions are their integrals over the reference element
+ *  scaled by the ratio of the element volume to the reference volume; for
+ *  piecewise constant functions this is the element area, for linear
+ *  functions on triangles one third of it. The element volumes, vertex
+ *  counts and affinity flags are computed once per element list (see
+ *  GridSegmentElementList::geometries()); engines built repeatedly on the
+ *  same list (e.g. on the list owned by a segment-restricted space, or
+ *  passed explicitly to the constructor) bucket its elements without
+ *  evaluating any geometrical data, and the integrals over a batch are
+ *  obtained without evaluating any geometrical data either.
+ *
+ *  The engine can also compute the projections of a function onto the
+ *  basis functions (see project()) and the local mass matrices (see
+ *  integrateProducts()), using the same buckets and batches.
+ *
+ *  The elements are split into chunks of fixed size, which do not depend on
+ *  the number of threads, and the consumers of the chunks are joined in a
+ *  fixed order (see deterministicParallelReduce()). Floating-point sums
+ *  accumulated by the consumers are therefore reproducible from run to run
+ *  and for any number of threads. */
+template <typename BasisFunctionType>
+class ElementIntegrationEngine : boost::noncopyable
+{
+public:
+    typedef typename ScalarTraits<BasisFunctionType>::RealType CoordinateType;
+    typedef ElementIntegrationScratch<BasisFunctionType> Scratch;
+
+    /** \brief Constructor.
+     *
+     *  Prepare the integration of functions from \p space over the whole
+     *  grid. If \p space is restricted to a grid segment, only the elements
+     *  of that segment are visited. The elements are sorted with at most as
+     *  many threads as allowed by \p parallelOptions. */
+    explicit ElementIntegrationEngine(
+            const Space<BasisFunctionType>& space,
+            const Fiber::ParallelizationOptions& parallelOptions =
+            Fiber::ParallelizationOptions());
+
+    /** \brief Constructor.
+     *
+     *  Prepare the integration of functions from \p space over the elements
+     *  belonging to \p segment. The list of these elements is built by a
+     *  traversal of the grid and owned by the engine; to loop repeatedly
+     *  over the same segment, build a GridSegmentElementList once and pass
+     *  it to the constructor taking a list. */
+    ElementIntegrationEngine(const Space<BasisFunctionType>& space,
+                             const GridSegment& segment,
+                             const Fiber::ParallelizationOptions& parallelOptions =
+                             Fiber::ParallelizationOptions());
+
+    /** \brief Constructor.
+     *
+     *  Prepare the integration of functions from \p space over the elements
+     *  whose leaf-view indices \p i satisfy <tt>elementMask[i] == true</tt>. */
+    ElementIntegrationEngine(const Space<BasisFunctionType>& space,
+                             const std::vector<bool>& elementMask,
+                             const Fiber::ParallelizationOptions& parallelOptions =
+                             Fiber::ParallelizationOptions());
+
+    /** \brief Constructor.
+     *
+     *  Prepare the integration of functions from \p space over the elements
+     *  from the precomputed list \p elements. */
+    ElementIntegrationEngine(const Space<BasisFunctionType>& space,
+                             const shared_ptr<const GridSegmentElementList>& elements,
+                             const Fiber::ParallelizationOptions& parallelOptions =
+                             Fiber::ParallelizationOptions());
+
+    const Space<BasisFunctionType>& space() const {
+        return m_space;
+    }
+
+    int codomainDimension() const {
+        return m_space.codomainDimension();
+    }
+
+    /** \brief Number of elements in the segment. */
+    size_t elementCount() const {
+        return m_elements->size();
+    }
+
+    /** \brief Leaf-view index of the <tt>i</tt>th element of the segment. */
+    size_t elementIndex(size_t i) const {
+        return m_elements->elementIndex(i);
+    }
+
+    /** \brief List of the elements of the segment. */
+    shared_ptr<const GridSegmentElementList> elements() const {
+        return m_elements;
+    }
+
+    /** \brief Pass the local integrals over all elements of the segment to
+     *  \p consumer, processing the elements in parallel with at most as many
+     *  threads as allowed by \p parallelOptions. */
+    template <typename Consumer>
+    void integrate(Consumer& consumer,
+                   const Fiber::ParallelizationOptions& parallelOptions) const;
+
+    /** \brief Pass the local integrals over the elements with positions
+     *  <tt>[begin, end)</tt> in the bucket-sorted element order to \p
+     *  consumer, using the scratch data of the calling thread. */
+    template <typename Consumer>
+    void integrateRange(size_t begin, size_t end, Consumer& consumer) const;
+
+    /** \brief Pass the projections of \p function onto the basis functions
+     *  attached to each element of the segment to \p consumer, processing
+     *  the elements in parallel.
+     *
+     *  \p function must depend only on global coordinates and normals. It
+     *  is evaluated once per batch of elements, at the quadrature points of
+     *  all elements of the batch, so that expensive functions (such as
+     *  Python callbacks) are called infrequently. The quadrature order
+     *  exceeds the order of the shapeset by #PROJECTION_ORDER_INCREMENT.
+     *
+     *  \p Consumer must satisfy the same requirements as in integrate(),
+     *  except that its \p addElement() member receives the projections as
+     *  a column vector:
+     *
+     *  - <tt>void addElement(size_t elementIndex,
+     *        const std::vector<GlobalDofIndex>& globalDofs,
+     *        const arma::Col<ResultType>& localProjections)</tt>.
+     *
+     *  For SimpleVectorSpaces, the projections onto all components are
+     *  obtained at once from the compact (scalar) basis function values. */
+    template <typename ResultType, typename Consumer>
+    void project(const Fiber::Function<ResultType>& function,
+                 Consumer& consumer,
+                 const Fiber::ParallelizationOptions& parallelOptions) const;
+
+    /** \brief Pass the projections of \p function onto the basis functions
+     *  attached to the elements with positions <tt>[begin, end)</tt> in the
+     *  bucket-sorted element order to \p consumer. */
+    template <typename ResultType, typename Consumer>
+    void projectRange(const Fiber::Function<ResultType>& function,
+                      size_t begin, size_t end, Consumer& consumer) const;
+
+    /** \brief Pass the integrals of the products of the basis functions
+     *  attached to each element of the segment (the local mass matrices) to
+     *  \p consumer, processing the elements in parallel.
+     *
+     *  \p Consumer must satisfy the same requirements as in integrate(),
+     *  except that its \p addElement() member receives a square matrix
+     *  whose <tt>(i, j)</tt>th entry is the integral of the scalar product
+     *  of the <tt>i</tt>th and <tt>j</tt>th basis functions attached to the
+     *  element, multiplied by the corresponding local DOF weights:
+     *
+     *  - <tt>void addElement(size_t elementIndex,
+     *        const std::vector<GlobalDofIndex>& globalDofs,
+     *        const arma::Mat<BasisFunctionType>& localProducts)</tt>.
+     *
+     *  The quadrature rule of project() is used; it is exact for shapesets of
+     *  order up to #PROJECTION_ORDER_INCREMENT on affine elements. */
+    template <typename Consumer>
+    void integrateProducts(Consumer& consumer,
+                           const Fiber::ParallelizationOptions& parallelOptions) const;
+
+    /** \brief Pass the local mass matrices of the elements with positions
+     *  <tt>[begin, end)</tt> in the bucket-sorted element order to \p
+     *  consumer. */
+    template <typename Consumer>
+    void integrateProductsRange(size_t begin, size_t end,
+                                Consumer& consumer) const;
+
+    /** \brief Difference between the order of the quadrature rules used by
+     *  project() and the order of the shapesets. */
+    enum { PROJECTION_ORDER_INCREMENT = 2 };
+
+    /** \brief Number of buckets of elements sharing a shapeset, a vertex
+     *  count and the affinity of their geometries. */
+    size_t bucketCount() const {
+        return m_buckets.size();
+    }
+
+private:
+    /** \cond PRIVATE */
+    enum { BATCH_SIZE = 64 };
+    // Size of the chunks of elements processed by a single consumer before
+    // it is joined with the others
+    enum { REDUCTION_GRAIN_SIZE = 4 * BATCH_SIZE };
+
+    void sortElements(const Fiber::ParallelizationOptions& parallelOptions);
+    void initializeBucket(ElementIntegrationBucket<BasisFunctionType>& bucket) const;
+    void evaluateWeightedValues(
+        ElementIntegrationBucket<BasisFunctionType>& bucket, int order,
+        arma::Mat<CoordinateType>& quadPoints,
+        arma::Mat<BasisFunctionType>& values,
+        arma::Mat<BasisFunctionType>& weightedValues,
+        std::vector<CoordinateType>& quadWeights) const;
+    void collectUsedElements(size_t begin, size_t end, Scratch& scratch) const;
+    template <typename Consumer>
+    void integrateBatch(const ElementIntegrationBucket<BasisFunctionType>& bucket,
+                        size_t begin, size_t end,
+                        Scratch& scratch, Consumer& consumer) const;
+    template <typename ResultType, typename Consumer>
+    void projectBatch(const Fiber::Function<ResultType>& function,
+                      const ElementIntegrationBucket<BasisFunctionType>& bucket,
+                      size_t begin, size_t end,
+                      Scratch& scratch, Consumer& consumer) const;
+    template <typename Consumer>
+    void integrateProductsBatch(
+            const ElementIntegrationBucket<BasisFunctionType>& bucket,
+            size_t begin, size_t end,
+            Scratch& scratch, Consumer& consumer) const;
+
+    const Space<BasisFunctionType>& m_space;
+    shared_ptr<const Space<BasisFunctionType> > m_scalarSpace;
+    shared_ptr<const GridSegmentElementList> m_elements;
+    std::vector<ElementIntegrationBucket<BasisFunctionType> > m_buckets;
+    // The positions (in m_elements) of the elements of the bth bucket are
+    // stored in m_order[m_bucketOffsets[b]], ...,
+    // m_order[m_bucketOffsets[b + 1] - 1]
+    std::vector<size_t> m_bucketOffsets;
+    std::vector<size_t> m_order;
+    // Vertex counts, affinity flags and volumes of the elements, indexed by
+    // position in m_elements; owned by m_elements
+    const GridSegmentElementList::Geometries* m_geometries;
+    mutable tbb::enumerable_thread_specific<Scratch> m_scratch;
+    /** \endcond */
+};
+
+/** \cond PRIVATE */
+// Shapeset, vertex count and affinity shared by the elements of a bucket
+template <typename BasisFunctionType>
+struct ElementBucketKey
+{
+    const Fiber::Shapeset<BasisFunctionType>* shapeset;
+    int vertexCount;
+    bool affine;
+
+    bool operator==(const ElementBucketKey& other) const {
+        return shapeset == other.shapeset && vertexCount == other.vertexCount &&
+            affine == other.affine;
+    }
+};
+
+// Finds the bucket key of each element. Each thread collects the distinct
+// keys of its elements in its own list; the lists are merged on join, in
+// the order of first appearance.
+template <typename BasisFunctionType>
+class ElementBucketingLoopBody
+{
+public:
+    typedef ElementBucketKey<BasisFunctionType> Key;
+
+    // If vectorSpace is not null, the shapesets are looked up by element
+    // index with SimpleVectorSpaceBase::scalarShapeset() where possible
+    ElementBucketingLoopBody(const Space<BasisFunctionType>& shapesetSpace,
+                             const SimpleVectorSpaceBase<BasisFunctionType>* vectorSpace,
+                             const GridSegmentElementList& elements,
+                             std::vector<const Fiber::Shapeset<BasisFunctionType>*>&
+                             shapesets) :
+        m_shapesetSpace(shapesetSpace), m_vectorSpace(vectorSpace),
+        m_elements(elements), m_shapesets(shapesets)
+    {}
+
+    ElementBucketingLoopBody(ElementBucketingLoopBody& other, tbb::split) :
+        m_shapesetSpace(other.m_shapesetSpace),
+        m_vectorSpace(other.m_vectorSpace), m_elements(other.m_elements),
+        m_shapesets(other.m_shapesets)
+    {}
+
+    void operator() (const tbb::blocked_range<size_t>& r)
+    {
+        const GridSegmentElementList::Geometries& geometries =
+            m_elements.geometries();
+        Key key;
+        for (size_t i = r.begin(); i < r.end(); ++i) {
+            key.shapeset = m_vectorSpace ?
+                m_vectorSpace->scalarShapeset(m_elements.elementIndex(i)) : 0;
+            if (!key.shapeset)
+                key.shapeset = &m_shapesetSpace.shapeset(m_elements.element(i));
+            key.vertexCount = geometries.vertexCounts[i];
+            key.affine = geometries.affine[i];
+            m_shapesets[i] = key.shapeset;
+            addKey(key);
+        }
+    }
+
+    void join(ElementBucketingLoopBody& other)
+    {
+        for (size_t k = 0; k < other.m_keys.size(); ++k)
+            addKey(other.m_keys[k]);
+    }
+
+    const std::vector<Key>& keys() const {
+        return m_keys;
+    }
+
+private:
+    void addKey(const Key& key)
+    {
+        // There are only a few distinct keys, so a linear search is cheaper
+        // than a map
+        if (std::find(m_keys.begin(), m_keys.end(), key) == m_keys.end())
+            m_keys.push_back(key);
+    }
+
+    const Space<BasisFunctionType>& m_shapesetSpace;
+    const SimpleVectorSpaceBase<BasisFunctionType>* m_vectorSpace;
+    const GridSegmentElementList& m_elements;
+    std::vector<const Fiber::Shapeset<BasisFunctionType>*>& m_shapesets;
+    std::vector<Key> m_keys;
+};
+
+// Stores the index of the bucket of each element
+template <typename BasisFunctionType>
+class ElementBucketIndexLoopBody
+{
+public:
+    typedef ElementBucketKey<BasisFunctionType> Key;
+
+    ElementBucketIndexLoopBody(const std::vector<Key>& keys,
+                               const GridSegmentElementList::Geometries& geometries,
+                               const std::vector<const Fiber::Shapeset<BasisFunctionType>*>&
+                               shapesets,
+                               std::vector<int>& bucketIndices) :
+        m_keys(keys), m_geometries(geometries), m_shapesets(shapesets),
+        m_bucketIndices(bucketIndices)
+    {}
+
+    void operator() (const tbb::blocked_range<size_t>& r) const
+    {
+        Key key;
+        for (size_t i = r.begin(); i < r.end(); ++i) {
+            key.shapeset = m_shapesets[i];
+            key.vertexCount = m_geometries.vertexCounts[i];
+            key.affine = m_geometries.affine[i];
+            m_bucketIndices[i] =
+                std::find(m_keys.begin(), m_keys.end(), key) - m_keys.begin();
+        }
+    }
+
+private:
+    const std::vector<Key>& m_keys;
+    const GridSegmentElementList::Geometries& m_geometries;
+    const std::vector<const Fiber::Shapeset<BasisFunctionType>*>& m_shapesets;
+    std::vector<int>& m_bucketIndices;
+};
+
+template <typename BasisFunctionType, typename Consumer>
+class ElementIntegrationLoopBody
+{
+public:
+    typedef ElementIntegrationEngine<BasisFunctionType> Engine;
+
+    ElementIntegrationLoopBody(const Engine& engine, Consumer& consumer) :
+        m_engine(engine), m_consumer(&consumer)
+    {}
+
+    ElementIntegrationLoopBody(ElementIntegrationLoopBody& other, tbb::split) :
+        m_engine(other.m_engine),
+        m_ownedConsumer(new Consumer(*other.m_consumer, tbb::split())),
+        m_consumer(m_ownedConsumer.get())
+    {}
+
+    void operator() (const tbb::blocked_range<size_t>& r)
+    {
+        m_engine.integrateRange(r.begin(), r.end(), *m_consumer);
+    }
+
+    void join(ElementIntegrationLoopBody& other)
+    {
+        m_consumer->join(*other.m_consumer);
+    }
+
+private:
+    const Engine& m_engine;
+    boost::scoped_ptr<Consumer> m_ownedConsumer;
+    Consumer* m_consumer;
+};
+
+template <typename BasisFunctionType, typename ResultType, typename Consumer>
+class ElementProjectionLoopBody
+{
+public:
+    typedef ElementIntegrationEngine<BasisFunctionType> Engine;
+
+    ElementProjectionLoopBody(const Engine& engine,
+                              const Fiber::Function<ResultType>& function,
+                              Consumer& consumer) :
+        m_engine(engine), m_function(function), m_consumer(&consumer)
+    {}
+
+    ElementProjectionLoopBody(ElementProjectionLoopBody& other, tbb::split) :
+        m_engine(other.m_engine),
+        m_function(other.m_function),
+        m_ownedConsumer(new Consumer(*other.m_consumer, tbb::split())),
+        m_consumer(m_ownedConsumer.get())
+    {}
+
+    void operator() (const tbb::blocked_range<size_t>& r)
+    {
+        m_engine.projectRange(m_function, r.begin(), r.end(), *m_consumer);
+    }
+
+    void join(ElementProjectionLoopBody& other)
+    {
+        m_consumer->join(*other.m_consumer);
+    }
+
+private:
+    const Engine& m_engine;
+    const Fiber::Function<ResultType>& m_function;
+    boost::scoped_ptr<Consumer> m_ownedConsumer;
+    Consumer* m_consumer;
+};
+
+template <typename BasisFunctionType, typename Consumer>
+class ElementProductLoopBody
+{
+public:
+    typedef ElementIntegrationEngine<BasisFunctionType> Engine;
+
+    ElementProductLoopBody(const Engine& engine, Consumer& consumer) :
+        m_engine(engine), m_consumer(&consumer)
+    {}
+
+    ElementProductLoopBody(ElementProductLoopBody& other, tbb::split) :
+        m_engine(other.m_engine),
+        m_ownedConsumer(new Consumer(*other.m_consumer, tbb::split())),
+        m_consumer(m_ownedConsumer.get())
+    {}
+
+    void operator() (const tbb::blocked_range<size_t>& r)
+    {
+        m_engine.integrateProductsRange(r.begin(), r.end(), *m_consumer);
+    }
+
+    void join(ElementProductLoopBody& other)
+    {
+        m_consumer->join(*other.m_consumer);
+    }
+
+private:
+    const Engine& m_engine;
+    boost::scoped_ptr<Consumer> m_ownedConsumer;
+    Consumer* m_consumer;
+};
+
+/** \endcond */
+
+template <typename BasisFunctionType>
+ElementIntegrationEngine<BasisFunctionType>::ElementIntegrationEngine(
+    const Space<BasisFunctionType>& space,
+    const Fiber::ParallelizationOptions& parallelOptions) :
+    m_space(space),
+    m_scalarSpace(scalarSpaceOf(space)),
+    m_elements(elementListOf(space))
+{
+    if (!m_elements)
+        m_elements = boost::make_shared<GridSegmentElementList>(
+                    boost::cref(*space.grid()),
+                    GridSegment::wholeGrid(*space.grid()));
+    sortElements(parallelOptions);
+}
+
+template <typename BasisFunctionType>
+ElementIntegrationEngine<BasisFunctionType>::ElementIntegrationEngine(
+    const Space<BasisFunctionType>& space, const GridSegment& segment,
+    const Fiber::ParallelizationOptions& parallelOptions) :
+    m_space(space),
+    m_scalarSpace(scalarSpaceOf(space)),
+    m_elements(boost::make_shared<GridSegmentElementList>(
+                   boost::cref(*space.grid()), boost::cref(segment)))
+{
+    sortElements(parallelOptions);
+}
+
+template <typename BasisFunctionType>
+ElementIntegrationEngine<BasisFunctionType>::ElementIntegrationEngine(
+    const Space<BasisFunctionType>& space, const std::vector<bool>& elementMask,
+    const Fiber::ParallelizationOptions& parallelOptions) :
+    m_space(space),
+    m_scalarSpace(scalarSpaceOf(space)),
+    m_elements(boost::make_shared<GridSegmentElementList>(
+                   boost::cref(*space.grid()), boost::cref(elementMask)))
+{
+    sortElements(parallelOptions);
+}
+
+template <typename BasisFunctionType>
+ElementIntegrationEngine<BasisFunctionType>::ElementIntegrationEngine(
+    const Space<BasisFunctionType>& space,
+    const shared_ptr<const GridSegmentElementList>& elements,
+    const Fiber::ParallelizationOptions& parallelOptions) :
+    m_space(space),
+    m_scalarSpace(scalarSpaceOf(space)),
+    m_elements(elements)
+{
+    if (!elements)
+        throw std::invalid_argument("ElementIntegrationEngine::"
+                                    "ElementIntegrationEngine(): "
+                                    "elements must not be null");
+    sortElements(parallelOptions);
+}
+
+template <typename BasisFunctionType>
+template <typename Consumer>
+void ElementIntegrationEngine<BasisFunctionType>::integrate(
+    Consumer& consumer,
+    const Fiber::ParallelizationOptions& parallelOptions) const
+{
+    tbb::task_scheduler_init scheduler(maxThreadCountOf(parallelOptions));
+    ElementIntegrationLoopBody<BasisFunctionType, Consumer> body(*this, consumer);
+    deterministicParallelReduce(
+        tbb::blocked_range<size_t>(0, m_order.size(), REDUCTION_GRAIN_SIZE),
+        body);
+}
+
+template <typename BasisFunctionType>
+template <typename ResultType, typename Consumer>
+void ElementIntegrationEngine<BasisFunctionType>::project(
+    const Fiber::Function<ResultType>& function,
+    Consumer& consumer,
+    const Fiber::ParallelizationOptions& parallelOptions) const
+{
+    if (function.codomainDimension() != codomainDimension())
+        throw std::invalid_argument(
+            "ElementIntegrationEngine::project(): codomain dimensions of the "
+            "function and the space do not match");
+    size_t geomDeps = 0;
+    function.addGeometricalDependencies(geomDeps);
+    if (geomDeps & ~(Fiber::GLOBALS | Fiber::NORMALS))
+        throw std::invalid_argument(
+            "ElementIntegrationEngine::project(): the function may depend "
+            "only on global coordinates and normals");
+
+    tbb::task_scheduler_init scheduler(maxThreadCountOf(parallelOptions));
+    ElementProjectionLoopBody<BasisFunctionType, ResultType, Consumer> body(
+        *this, function, consumer);
+    // Each chunk spans several full batches, so that the function is
+    // evaluated at many points at a time
+    deterministicParallelReduce(
+        tbb::blocked_range<size_t>(0, m_order.size(), REDUCTION_GRAIN_SIZE),
+        body);
+}
+
+template <typename BasisFunctionType>
+template <typename Consumer>
+void ElementIntegrationEngine<BasisFunctionType>::integrateProducts(
+    Consumer& consumer,
+    const Fiber::ParallelizationOptions& parallelOptions) const
+{
+    tbb::task_scheduler_init scheduler(maxThreadCountOf(parallelOptions));
+    ElementProductLoopBody<BasisFunctionType, Consumer> body(*this, consumer);
+    deterministicParallelReduce(
+        tbb::blocked_range<size_t>(0, m_order.size(), REDUCTION_GRAIN_SIZE),
+        body);
+}
+
+template <typename BasisFunctionType>
+void ElementIntegrationEngine<BasisFunctionType>::sortElements(
+    const Fiber::ParallelizationOptions& parallelOptions)
+{
+    typedef ElementBucketKey<BasisFunctionType> Key;
+    tbb::task_scheduler_init scheduler(maxThreadCountOf(parallelOptions));
+    const size_t elementCount = m_elements->size();
+    m_geometries = &m_elements->geometries();
+
+    // Assign elements to buckets in parallel. The geometrical data are
+    // evaluated once per element list and shared by all engines using it.
+    const Space<BasisFunctionType>& shapesetSpace =
+        m_scalarSpace ? *m_scalarSpace : m_space;
+    std::vector<const Fiber::Shapeset<BasisFunctionType>*> shapesets(elementCount);
+    ElementBucketingLoopBody<BasisFunctionType> bucketingBody(
+        shapesetSpace,
+        dynamic_cast<const SimpleVectorSpaceBase<BasisFunctionType>*>(&m_space),
+        *m_elements, shapesets);
+    // The buckets are numbered in the order of first appearance of their
+    // keys, which must not depend on the scheduling
+    deterministicParallelReduce(
+        tbb::blocked_range<size_t>(0, elementCount, REDUCTION_GRAIN_SIZE),
+        bucketingBody);
+    const std::vector<Key>& keys = bucketingBody.keys();
+    m_buckets.resize(keys.size());
+    for (size_t b = 0; b < keys.size(); ++b) {
+        m_buckets[b].shapeset = keys[b].shapeset;
+        m_buckets[b].vertexCount = keys[b].vertexCount;
+        m_buckets[b].affine = keys[b].affine;
+    }
+    std::vector<int> bucketIndices(elementCount);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, elementCount),
+                      ElementBucketIndexLoopBody<BasisFunctionType>(
+                          keys, *m_geometries, shapesets, bucketIndices));
+
+    // Counting sort of element positions by bucket
+    m_bucketOffsets.assign(m_buckets.size() + 1, 0);
+    for (size_t i = 0; i < elementCount; ++i)
+        ++acc(m_bucketOffsets, acc(bucketIndices, i) + 1);
+    for (size_t b = 0; b < m_buckets.size(); ++b)
+        acc(m_bucketOffsets, b + 1) += acc(m_bucketOffsets, b);
+    std::vector<size_t> next(m_bucketOffsets.begin(), m_bucketOffsets.end() - 1);
+    m_order.resize(elementCount);
+    for (size_t i = 0; i < elementCount; ++i)
+        acc(m_order, acc(next, acc(bucketIndices, i))++) = i;
+
+    for (size_t b = 0; b < m_buckets.size(); ++b)
+        initializeBucket(m_buckets[b]);
+}
+
+template <typename BasisFunctionType>
+void ElementIntegrationEngine<BasisFunctionType>::initializeBucket(
+    ElementIntegrationBucket<BasisFunctionType>& bucket) const
+{
+    const int order = bucket.shapeset->order();
+    std::vector<CoordinateType> quadWeights;
+    arma::Mat<BasisFunctionType> values;
+    evaluateWeightedValues(bucket, order, bucket.quadPoints,
+                           values, bucket.weightedValues, quadWeights);
+    bucket.referenceIntegrals = arma::sum(bucket.weightedValues, 1);
+    bucket.referenceVolume = 0.;
+    for (size_t pointIndex = 0; pointIndex < quadWeights.size(); ++pointIndex)
+        bucket.referenceVolume += quadWeights[pointIndex];
+
+    evaluateWeightedValues(bucket, order + PROJECTION_ORDER_INCREMENT,
+                           bucket.projectionQuadPoints, bucket.projectionValues,
+                           bucket.projectionWeightedValues, quadWeights);
+    typedef typename ElementIntegrationBucket<BasisFunctionType>::ComplexType
+        ComplexType;
+    bucket.complexProjectionWeightedValues =
+        arma::conv_to<arma::Mat<ComplexType> >::from(
+            bucket.projectionWeightedValues);
+}
+
+template <typename BasisFunctionType>
+void ElementIntegrationEngine<BasisFunctionType>::evaluateWeightedValues(
+    ElementIntegrationBucket<BasisFunctionType>& bucket, int order,
+    arma::Mat<CoordinateType>& quadPoints,
+    arma::Mat<BasisFunctionType>& values,
+    arma::Mat<BasisFunctionType>& weightedValues,
+    std::vector<CoordinateType>& quadWeights) const
+{
+    const Fiber::Shapeset<BasisFunctionType>& shapeset = *bucket.shapeset;
+    bucket.functionCount = shapeset.size();
+
+    Fiber::SingleQuadratureDescriptor desc;
+    desc.vertexCount = bucket.vertexCount;
+    desc.order = order;
+
+    Fiber::DefaultSingleQuadratureRuleFamily<CoordinateType> quadRuleFamily;
+    quadRuleFamily.fillQuadraturePointsAndWeights(desc, quadPoints, quadWeights);
+
+    // These would need to be set differently if arbitrary functionals
+    // were allowed.
+    const size_t basisDataType = Fiber::VALUES;
+    Fiber::BasisData<BasisFunctionType> basisData;
+    shapeset.evaluate(basisDataType, quadPoints, Fiber::ALL_DOFS, basisData);
+
+    bucket.componentCount = basisData.values.extent(0);
+    const size_t pointCount = quadPoints.n_cols;
+    values.set_size(bucket.functionCount * bucket.componentCount, pointCount);
+    weightedValues.set_size(values.n_rows, pointCount);
+    for (size_t pointIndex = 0; pointIndex < pointCount; ++pointIndex)
+        for (int functionIndex = 0; functionIndex < bucket.functionCount;
+             ++functionIndex)
+            for (int dim = 0; dim < bucket.componentCount; ++dim) {
+                const int row = functionIndex * bucket.componentCount + dim;
+                values(row, pointIndex) =
+                    basisData.values(dim, functionIndex, pointIndex);
+                weightedValues(row, pointIndex) =
+                    values(row, pointIndex) * quadWeights[pointIndex];
+            }
+}
+
+template <typename BasisFunctionType>
+template <typename Consumer>
+void ElementIntegrationEngine<BasisFunctionType>::integrateRange(
+    size_t begin, size_t end, Consumer& consumer) const
+{
+    Scratch& scratch = m_scratch.local();
+    size_t b = std::upper_bound(m_bucketOffsets.begin(), m_bucketOffsets.end(),
+                                begin) - m_bucketOffsets.begin() - 1;
+    while (begin < end) {
+        const size_t bucketEnd = std::min(end, m_bucketOffsets[b + 1]);
+        for (; begin < bucketEnd; begin += BATCH_SIZE)
+            integrateBatch(m_buckets[b], begin,
+                           std::min(bucketEnd, begin + BATCH_SIZE),
+                           scratch, consumer);
+        begin = bucketEnd;
+        ++b;
+    }
+}
+
+template <typename BasisFunctionType>
+void ElementIntegrationEngine<BasisFunctionType>::collectUsedElements(
+    size_t begin, size_t end, Scratch& scratch) const
+{
+    // Skip the elements none of whose DOFs are used; keep the DOFs of the
+    // others for the rest of the batch
+    std::vector<size_t>& positions = scratch.batchPositions;
+    positions.clear();
+    if (scratch.batchGlobalDofs.size() < end - begin) {
+        scratch.batchGlobalDofs.resize(end - begin);
+        scratch.batchLocalDofWeights.resize(end - begin);
+    }
+    for (size_t k = begin; k < end; ++k) {
+        const size_t position = m_order[k];
+        const size_t j = positions.size();
+        std::vector<GlobalDofIndex>& globalDofs = scratch.batchGlobalDofs[j];
+        m_space.getGlobalDofs(m_elements->element(position),
+                              globalDofs, scratch.batchLocalDofWeights[j]);
+        for (size_t i = 0; i < globalDofs.size(); ++i)
+            if (globalDofs[i] >= 0) {
+                positions.push_back(position);
+                break;
+            }
+    }
+}
+
+template <typename BasisFunctionType>
+template <typename Consumer>
+void ElementIntegrationEngine<BasisFunctionType>::integrateBatch(
+    const ElementIntegrationBucket<BasisFunctionType>& bucket,
+    size_t begin, size_t end, Scratch& scratch, Consumer& consumer) const
+{
+    const int codomainDim = codomainDimension();
+    arma::Mat<BasisFunctionType>& localIntegrals = scratch.localIntegrals;
+    std::vector<size_t>& positions = scratch.batchPositions;
+    arma::Mat<BasisFunctionType>& integrationElements =
+        scratch.batchIntegrationElements;
+    Fiber::GeometricalData<CoordinateType>& geomData = scratch.geomData;
+    const size_t pointCount = bucket.quadPoints.n_cols;
+
+    collectUsedElements(begin, end, scratch);
+    if (positions.empty())
+        return;
+
+    if (bucket.affine) {
+        // Closed form: the integration elements are constant
+        integrationElements.set_size(1, positions.size());
+        for (size_t j = 0; j < positions.size(); ++j)
+            integrationElements(0, j) =
+                static_cast<CoordinateType>(acc(m_geometries->volumes, positions[j])) /
+                bucket.referenceVolume;
+        scratch.batchIntegrals = bucket.referenceIntegrals * integrationElements;
+    } else {
+        integrationElements.set_size(pointCount, positions.size());
+        for (size_t j = 0; j < positions.size(); ++j) {
+            const Geometry& geometry = m_elements->element(positions[j]).geometry();
+            geometry.getData(Fiber::INTEGRATION_ELEMENTS, bucket.quadPoints, geomData);
+            for (size_t pointIndex = 0; pointIndex < pointCount; ++pointIndex)
+                integrationElements(pointIndex, j) =
+                    geomData.integrationElements(pointIndex);
+        }
+        scratch.batchIntegrals = bucket.weightedValues * integrationElements;
+    }
+
+    for (size_t j = 0; j < positions.size(); ++j) {
+        const size_t position = positions[j];
+        const std::vector<GlobalDofIndex>& globalDofs = scratch.batchGlobalDofs[j];
+        const std::vector<BasisFunctionType>& localDofWeights =
+            scratch.batchLocalDofWeights[j];
+        const BasisFunctionType* integrals = scratch.batchIntegrals.colptr(j);
+        localIntegrals.zeros(globalDofs.size(), codomainDim);
+        if (m_scalarSpace)
+            for (int functionIndex = 0; functionIndex < bucket.functionCount;
+                 ++functionIndex)
+                for (int dim = 0; dim < codomainDim; ++dim)
+                    localIntegrals(functionIndex * codomainDim + dim, dim) =
+                        integrals[functionIndex];
+        else
+            for (int functionIndex = 0; functionIndex < bucket.functionCount;
+                 ++functionIndex)
+                for (int dim = 0; dim < codomainDim; ++dim)
+                    localIntegrals(functionIndex, dim) =
+                        integrals[functionIndex * bucket.componentCount + dim];
+
+        for (size_t i = 0; i < globalDofs.size(); ++i)
+            if (globalDofs[i] >= 0)
+                localIntegrals.row(i) *= localDofWeights[i];
+            else
+                localIntegrals.row(i).fill(0.);
+        consumer.addElement(m_elements->elementIndex(position),
+                            globalDofs, localIntegrals);
+    }
+}
+
+template <typename BasisFunctionType>
+template <typename ResultType, typename Consumer>
+void ElementIntegrationEngine<BasisFunctionType>::projectRange(
+    const Fiber::Function<ResultType>& function,
+    size_t begin, size_t end, Consumer& consumer) const
+{
+    Scratch& scratch = m_scratch.local();
+    size_t b = std::upper_bound(m_bucketOffsets.begin(), m_bucketOffsets.end(),
+                                begin) - m_bucketOffsets.begin() - 1;
+    while (begin < end) {
+        const size_t bucketEnd = std::min(end, m_bucketOffsets[b + 1]);
+        for (; begin < bucketEnd; begin += BATCH_SIZE)
+            projectBatch(function, m_buckets[b], begin,
+                         std::min(bucketEnd, begin + BATCH_SIZE),
+                         scratch, consumer);
+        begin = bucketEnd;
+        ++b;
+    }
+}
+
+template <typename BasisFunctionType>
+template <typename ResultType, typename Consumer>
+void ElementIntegrationEngine<BasisFunctionType>::projectBatch(
+    const Fiber::Function<ResultType>& function,
+    const ElementIntegrationBucket<BasisFunctionType>& bucket,
+    size_t begin, size_t end, Scratch& scratch, Consumer& consumer) const
+{
+    const int codomainDim = codomainDimension();
+    std::vector<size_t>& positions = scratch.batchPositions;
+    arma::Mat<BasisFunctionType>& integrationElements =
+        scratch.batchIntegrationElements;
+    Fiber::GeometricalData<CoordinateType>& geomData = scratch.geomData;
+    Fiber::GeometricalData<CoordinateType>& batchGeomData = scratch.batchGeomData;
+    typedef ElementProjectionData<BasisFunctionType, ResultType> ProjectionData;
+    ElementProjectionScratch<ResultType>& projectionScratch =
+        ProjectionData::scratch(scratch);
+    arma::Mat<ResultType>& values = projectionScratch.values;
+    arma::Mat<ResultType>& elementValues = projectionScratch.elementValues;
+    arma::Mat<ResultType>& products = projectionScratch.products;
+    arma::Col<ResultType>& localProjections = projectionScratch.localProjections;
+    const size_t pointCount = bucket.projectionQuadPoints.n_cols;
+
+    collectUsedElements(begin, end, scratch);
+    if (positions.empty())
+        return;
+
+    // Gather the geometrical data at the quadrature points of all elements
+    // of the batch so that the function is evaluated in a single call
+    size_t geomDeps = Fiber::INTEGRATION_ELEMENTS;
+    function.addGeometricalDependencies(geomDeps);
+    const bool needsNormals = geomDeps & Fiber::NORMALS;
+    integrationElements.set_size(pointCount, positions.size());
+    for (size_t j = 0; j < positions.size(); ++j) {
+        const Geometry& geometry = m_elements->element(positions[j]).geometry();
+        geometry.getData(geomDeps, bucket.projectionQuadPoints, geomData);
+        if (j == 0) {
+            batchGeomData.globals.set_size(geomData.globals.n_rows,
+                                           positions.size() * pointCount);
+            if (needsNormals)
+                batchGeomData.normals.set_size(geomData.normals.n_rows,
+                                               positions.size() * pointCount);
+        }
+        const size_t firstCol = j * pointCount;
+        const size_t lastCol = firstCol + pointCount - 1;
+        batchGeomData.globals.cols(firstCol, lastCol) = geomData.globals;
+        if (needsNormals)
+            batchGeomData.normals.cols(firstCol, lastCol) = geomData.normals;
+        for (size_t pointIndex = 0; pointIndex < pointCount; ++pointIndex)
+            integrationElements(pointIndex, j) =
+                geomData.integrationElements(pointIndex);
+    }
+    function.evaluate(batchGeomData, values);
+
+    const arma::Mat<ResultType>& weightedValues =
+        ProjectionData::weightedValues(bucket);
+    elementValues.set_size(pointCount, codomainDim);
+    for (size_t j = 0; j < positions.size(); ++j) {
+        // Column d: dth component of the function times the integration
+        // element, so that a single product yields the projections of all
+        // components onto all (compact) basis functions
+        for (int dim = 0; dim < codomainDim; ++dim)
+            for (size_t pointIndex = 0; pointIndex < pointCount; ++pointIndex)
+                elementValues(pointIndex, dim) =
+                    values(dim, j * pointCount + pointIndex) *
+                    integrationElements(pointIndex, j);
+        products = weightedValues * elementValues;
+
+        const size_t position = positions[j];
+        const std::vector<GlobalDofIndex>& globalDofs = scratch.batchGlobalDofs[j];
+        const std::vector<BasisFunctionType>& localDofWeights =
+            scratch.batchLocalDofWeights[j];
+        localProjections.zeros(globalDofs.size());
+        if (m_scalarSpace)
+            for (int functionIndex = 0; functionIndex < bucket.functionCount;
+                 ++functionIndex)
+                for (int dim = 0; dim < codomainDim; ++dim)
+                    localProjections(functionIndex * codomainDim + dim) =
+                        products(functionIndex, dim);
+        else
+            for (int functionIndex = 0; functionIndex < bucket.functionCount;
+                 ++functionIndex)
+                for (int dim = 0; dim < codomainDim; ++dim)
+                    localProjections(functionIndex) += products(
+                        functionIndex * bucket.componentCount + dim, dim);
+
+        for (size_t i = 0; i < globalDofs.size(); ++i)
+            if (globalDofs[i] >= 0)
+                localProjections(i) *= localDofWeights[i];
+            else
+                localProjections(i) = 0.;
+        consumer.addElement(m_elements->elementIndex(position),
+                            globalDofs, localProjections);
+    }
+}
+
+template <typename BasisFunctionType>
+template <typename Consumer>
+void ElementIntegrationEngine<BasisFunctionType>::integrateProductsRange(
+    size_t begin, size_t end, Consumer& consumer) const
+{
+    Scratch& scratch = m_scratch.local();
+    size_t b = std::upper_bound(m_bucketOffsets.begin(), m_bucketOffsets.end(),
+                                begin) - m_bucketOffsets.begin() - 1;
+    while (begin < end) {
+        const size_t bucketEnd = std::min(end, m_bucketOffsets[b + 1]);
+        for (; begin < bucketEnd; begin += BATCH_SIZE)
+            integrateProductsBatch(m_buckets[b], begin,
+                                   std::min(bucketEnd, begin + BATCH_SIZE),
+                                   scratch, consumer);
+        begin = bucketEnd;
+        ++b;
+    }
+}
+
+template <typename BasisFunctionType>
+template <typename Consumer>
+void ElementIntegrationEngine<BasisFunctionType>::integrateProductsBatch(
+    const ElementIntegrationBucket<BasisFunctionType>& bucket,
+    size_t begin, size_t end, Scratch& scratch, Consumer& consumer) const
+{
+    const int codomainDim = codomainDimension();
+    arma::Mat<BasisFunctionType>& localProducts = scratch.localIntegrals;
+    arma::Mat<BasisFunctionType>& scaledValues = scratch.scaledValues;
+    arma::Mat<BasisFunctionType>& products = scratch.products;
+    std::vector<size_t>& positions = scratch.batchPositions;
+    Fiber::GeometricalData<CoordinateType>& geomData = scratch.geomData;
+    const size_t pointCount = bucket.projectionQuadPoints.n_cols;
+
+    collectUsedElements(begin, end, scratch);
+    for (size_t j = 0; j < positions.size(); ++j) {
+        const size_t position = positions[j];
+        const Entity<0>& element = m_elements->element(position);
+        if (bucket.affine)
+            // Closed form: the integration elements are constant
+            scaledValues = bucket.projectionWeightedValues *
+                (static_cast<CoordinateType>(acc(m_geometries->volumes, position)) /
+                 bucket.referenceVolume);
+        else {
+            element.geometry().getData(Fiber::INTEGRATION_ELEMENTS,
+                                       bucket.projectionQuadPoints, geomData);
+            scaledValues = bucket.projectionWeightedValues;
+            for (size_t pointIndex = 0; pointIndex < pointCount; ++pointIndex)
+                scaledValues.col(pointIndex) *=
+                    geomData.integrationElements(pointIndex);
+        }
+        products = scaledValues * arma::trans(bucket.projectionValues);
+
+        const std::vector<GlobalDofIndex>& globalDofs = scratch.batchGlobalDofs[j];
+        const std::vector<BasisFunctionType>& localDofWeights =
+            scratch.batchLocalDofWeights[j];
+        localProducts.zeros(globalDofs.size(), globalDofs.size());
+        if (m_scalarSpace)
+            // Basis functions oriented along different axes are orthogonal
+            for (int g = 0; g < bucket.functionCount; ++g)
+                for (int f = 0; f < bucket.functionCount; ++f)
+                    for (int dim = 0; dim < codomainDim; ++dim)
+                        localProducts(f * codomainDim + dim,
+                                      g * codomainDim + dim) = products(f, g);
+        else
+            for (int g = 0; g < bucket.functionCount; ++g)
+                for (int f = 0; f < bucket.functionCount; ++f)
+                    for (int dim = 0; dim < bucket.componentCount; ++dim)
+                        localProducts(f, g) += products(
+                            f * bucket.componentCount + dim,
+                            g * bucket.componentCount + dim);
+
+        for (size_t i = 0; i < globalDofs.size(); ++i)
+            if (globalDofs[i] >= 0) {
+                localProducts.row(i) *= localDofWeights[i];
+                localProducts.col(i) *= localDofWeights[i];
+            } else {
+                localProducts.row(i).fill(0.);
+                localProducts.col(i).fill(0.);
+            }
+        consumer.addElement(m_elements->elementIndex(position),
+                            globalDofs, localProducts);
+    }
+}
+
+} // namespace Bempp
+
+#endif
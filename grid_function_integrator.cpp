@@ -0,0 +1,362 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "grid_function_integrator.hpp"
+
+#include "element_integration_engine.hpp"
+#include "parallel_options.hpp"
+#include "simple_vector_space.hpp"
+
+#include "assembly/grid_function.hpp"
+#include "fiber/explicit_instantiation.hpp"
+#include "fiber/parallelization_options.hpp"
+#include "grid/grid.hpp"
+#include "grid/grid_segment.hpp"
+#include "space/space.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_scheduler_init.h>
+
+namespace Bempp
+{
+
+namespace
+{
+    // Global-to-local DOF map of a space in the CSR format: the local DOFs of
+    // the global DOF i are stored at positions offsets[i], ...,
+    // offsets[i + 1] - 1 of localDofs
+    template <typename BasisFunctionType>
+    void getGlobalToLocalMap(const Space<BasisFunctionType>& space,
+                             std::vector<size_t>& offsets,
+                             std::vector<LocalDof>& localDofs)
+    {
+        const size_t dofCount = space.globalDofCount();
+        std::vector<GlobalDofIndex> globalDofs(dofCount);
+        for (size_t i = 0; i < dofCount; ++i)
+            globalDofs[i] = i;
+        std::vector<BasisFunctionType> weights;
+        if (const SimpleVectorSpaceBase<BasisFunctionType>* vectorSpace =
+                dynamic_cast<const SimpleVectorSpaceBase<BasisFunctionType>*>(&space)) {
+            vectorSpace->global2localDofs(globalDofs.empty() ? 0 : &globalDofs[0],
+                                          dofCount, offsets, localDofs, weights);
+            return;
+        }
+        std::vector<std::vector<LocalDof> > nestedLocalDofs;
+        std::vector<std::vector<BasisFunctionType> > nestedWeights;
+        space.global2localDofs(globalDofs, nestedLocalDofs, nestedWeights);
+        offsets.resize(dofCount + 1);
+        offsets[0] = 0;
+        for (size_t i = 0; i < dofCount; ++i)
+            offsets[i + 1] = offsets[i] + nestedLocalDofs[i].size();
+        localDofs.clear();
+        localDofs.reserve(offsets[dofCount]);
+        for (size_t i = 0; i < dofCount; ++i)
+            localDofs.insert(localDofs.end(), nestedLocalDofs[i].begin(),
+                             nestedLocalDofs[i].end());
+    }
+
+    // Local integrals of all elements, stored in one slot per local DOF that
+    // is attached to a global DOF. The local DOF j of the element with index
+    // e occupies the columns elementOffsets[e] + j of values.
+    template <typename BasisFunctionType>
+    struct LocalIntegralSlots
+    {
+        LocalIntegralSlots(int codomainDim,
+                           const std::vector<LocalDof>& localDofs)
+        {
+            size_t elementCount = 0;
+            for (size_t k = 0; k < localDofs.size(); ++k)
+                elementCount = std::max<size_t>(elementCount,
+                                                localDofs[k].entityIndex + 1);
+            std::vector<size_t> slotCounts(elementCount, 0);
+            for (size_t k = 0; k < localDofs.size(); ++k)
+                slotCounts[localDofs[k].entityIndex] = std::max<size_t>(
+                    slotCounts[localDofs[k].entityIndex],
+                    localDofs[k].dofIndex + 1);
+            elementOffsets.resize(elementCount + 1);
+            elementOffsets[0] = 0;
+            for (size_t e = 0; e < elementCount; ++e)
+                elementOffsets[e + 1] = elementOffsets[e] + slotCounts[e];
+            values.zeros(codomainDim, elementOffsets[elementCount]);
+        }
+
+        size_t slot(const LocalDof& localDof) const {
+            return elementOffsets[localDof.entityIndex] + localDof.dofIndex;
+        }
+
+        std::vector<size_t> elementOffsets;
+        arma::Mat<BasisFunctionType> values;
+    };
+
+    // Stores the local integrals of each element in its slots. Each element
+    // is visited by a single thread, so all consumers write to the same
+    // slots.
+    template <typename BasisFunctionType>
+    class WeightConsumer
+    {
+    public:
+        explicit WeightConsumer(LocalIntegralSlots<BasisFunctionType>& slots) :
+            m_slots(slots)
+        {}
+
+        WeightConsumer(WeightConsumer& other, tbb::split) :
+            m_slots(other.m_slots)
+        {}
+
+        void addElement(size_t elementIndex,
+                        const std::vector<GlobalDofIndex>& globalDofs,
+                        const arma::Mat<BasisFunctionType>& localIntegrals)
+        {
+            // Elements carrying no global DOFs have no slots
+            if (elementIndex + 1 >= m_slots.elementOffsets.size())
+                return;
+            const size_t offset = m_slots.elementOffsets[elementIndex];
+            const size_t slotCount =
+                m_slots.elementOffsets[elementIndex + 1] - offset;
+            for (size_t i = 0; i < std::min(slotCount, globalDofs.size()); ++i)
+                for (size_t dim = 0; dim < localIntegrals.n_cols; ++dim)
+                    m_slots.values(dim, offset + i) = localIntegrals(i, dim);
+        }
+
+        void join(WeightConsumer& other)
+        {
+        }
+
+    private:
+        LocalIntegralSlots<BasisFunctionType>& m_slots;
+    };
+
+    // Sums the local integrals attached to each global DOF. In the counting
+    // pass, only the numbers of non-zero weights are stored (in offsets[i +
+    // 1]); in the filling pass, the weights are stored from offsets[i] on.
+    template <typename BasisFunctionType>
+    class WeightGatherLoopBody
+    {
+    public:
+        WeightGatherLoopBody(const LocalIntegralSlots<BasisFunctionType>& slots,
+                             const std::vector<size_t>& localDofOffsets,
+                             const std::vector<LocalDof>& localDofs,
+                             bool fill,
+                             std::vector<size_t>& offsets,
+                             std::vector<int>& components,
+                             std::vector<BasisFunctionType>& weights) :
+            m_slots(slots), m_localDofOffsets(localDofOffsets),
+            m_localDofs(localDofs), m_fill(fill), m_offsets(offsets),
+            m_components(components), m_weights(weights)
+        {}
+
+        void operator() (const tbb::blocked_range<size_t>& r) const {
+            const int codomainDim = m_slots.values.n_rows;
+            arma::Col<BasisFunctionType> sum(codomainDim);
+            for (size_t dof = r.begin(); dof < r.end(); ++dof) {
+                sum.fill(0.);
+                for (size_t k = m_localDofOffsets[dof];
+                     k < m_localDofOffsets[dof + 1]; ++k)
+                    sum += m_slots.values.unsafe_col(
+                        m_slots.slot(m_localDofs[k]));
+                size_t next = m_fill ? m_offsets[dof] : 0;
+                for (int dim = 0; dim < codomainDim; ++dim)
+                    if (sum(dim) != static_cast<BasisFunctionType>(0.)) {
+                        if (m_fill) {
+                            m_components[next] = dim;
+                            m_weights[next] = sum(dim);
+                        }
+                        ++next;
+                    }
+                if (!m_fill)
+                    m_offsets[dof + 1] = next;
+            }
+        }
+
+    private:
+        const LocalIntegralSlots<BasisFunctionType>& m_slots;
+        const std::vector<size_t>& m_localDofOffsets;
+        const std::vector<LocalDof>& m_localDofs;
+        bool m_fill;
+        std::vector<size_t>& m_offsets;
+        std::vector<int>& m_components;
+        std::vector<BasisFunctionType>& m_weights;
+    };
+
+    // Global DOFs handled by a single task of the gather passes
+    const size_t GATHER_GRAIN_SIZE = 1024;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+GridFunctionIntegrator<BasisFunctionType, ResultType>::GridFunctionIntegrator(
+    const shared_ptr<const Space<BasisFunctionType> >& space) :
+    m_space(space)
+{
+    if (!space)
+        throw std::invalid_argument("GridFunctionIntegrator::GridFunctionIntegrator(): "
+                                    "space must not be null");
+    ElementIntegrationEngine<BasisFunctionType> engine(*space);
+    initialize(engine, Fiber::ParallelizationOptions());
+}
+
+template <typename BasisFunctionType, typename ResultType>
+GridFunctionIntegrator<BasisFunctionType, ResultType>::GridFunctionIntegrator(
+    const shared_ptr<const Space<BasisFunctionType> >& space,
+    const Fiber::ParallelizationOptions& parallelOptions) :
+    m_space(space)
+{
+    if (!space)
+        throw std::invalid_argument("GridFunctionIntegrator::GridFunctionIntegrator(): "
+                                    "space must not be null");
+    ElementIntegrationEngine<BasisFunctionType> engine(*space, parallelOptions);
+    initialize(engine, parallelOptions);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+GridFunctionIntegrator<BasisFunctionType, ResultType>::GridFunctionIntegrator(
+    const shared_ptr<const Space<BasisFunctionType> >& space,
+    const GridSegment& segment) :
+    m_space(space)
+{
+    if (!space)
+        throw std::invalid_argument("GridFunctionIntegrator::GridFunctionIntegrator(): "
+                                    "space must not be null");
+    ElementIntegrationEngine<BasisFunctionType> engine(*space, segment);
+    initialize(engine, Fiber::ParallelizationOptions());
+}
+
+template <typename BasisFunctionType, typename ResultType>
+GridFunctionIntegrator<BasisFunctionType, ResultType>::GridFunctionIntegrator(
+    const shared_ptr<const Space<BasisFunctionType> >& space,
+    const GridSegment& segment,
+    const Fiber::ParallelizationOptions& parallelOptions) :
+    m_space(space)
+{
+    if (!space)
+        throw std::invalid_argument("GridFunctionIntegrator::GridFunctionIntegrator(): "
+                                    "space must not be null");
+    ElementIntegrationEngine<BasisFunctionType> engine(*space, segment,
+                                                       parallelOptions);
+    initialize(engine, parallelOptions);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+GridFunctionIntegrator<BasisFunctionType, ResultType>::GridFunctionIntegrator(
+    const shared_ptr<const Space<BasisFunctionType> >& space,
+    const shared_ptr<const GridSegmentElementList>& elements,
+    const Fiber::ParallelizationOptions& parallelOptions) :
+    m_space(space)
+{
+    if (!space)
+        throw std::invalid_argument("GridFunctionIntegrator::GridFunctionIntegrator(): "
+                                    "space must not be null");
+    ElementIntegrationEngine<BasisFunctionType> engine(*space, elements,
+                                                       parallelOptions);
+    initialize(engine, parallelOptions);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void GridFunctionIntegrator<BasisFunctionType, ResultType>::initialize(
+    const ElementIntegrationEngine<BasisFunctionType>& engine,
+    const Fiber::ParallelizationOptions& parallelOptions)
+{
+    m_codomainDim = m_space->codomainDimension();
+    const size_t dofCount = m_space->globalDofCount();
+
+    // Store the local integrals of the elements, then gather them per DOF
+    std::vector<size_t> localDofOffsets;
+    std::vector<LocalDof> localDofs;
+    getGlobalToLocalMap(*m_space, localDofOffsets, localDofs);
+    LocalIntegralSlots<BasisFunctionType> slots(m_codomainDim, localDofs);
+    WeightConsumer<BasisFunctionType> consumer(slots);
+    engine.integrate(consumer, parallelOptions);
+
+    // Count the non-zero weights of each DOF, then store them
+    tbb::task_scheduler_init scheduler(maxThreadCountOf(parallelOptions));
+    const tbb::blocked_range<size_t> dofRange(0, dofCount, GATHER_GRAIN_SIZE);
+    m_offsets.resize(dofCount + 1);
+    m_offsets[0] = 0;
+    tbb::parallel_for(dofRange, WeightGatherLoopBody<BasisFunctionType>(
+                          slots, localDofOffsets, localDofs, false /* fill */,
+                          m_offsets, m_components, m_weights));
+    for (size_t dof = 0; dof < dofCount; ++dof)
+        m_offsets[dof + 1] += m_offsets[dof];
+    m_components.resize(m_offsets[dofCount]);
+    m_weights.resize(m_offsets[dofCount]);
+    tbb::parallel_for(dofRange, WeightGatherLoopBody<BasisFunctionType>(
+                          slots, localDofOffsets, localDofs, true /* fill */,
+                          m_offsets, m_components, m_weights));
+}
+
+template <typename BasisFunctionType, typename ResultType>
+arma::Col<ResultType>
+GridFunctionIntegrator<BasisFunctionType, ResultType>::integrate(
+    const GridFunction<BasisFunctionType, ResultType>& gridFunction) const
+{
+    if (gridFunction.space().get() != m_space.get())
+        throw std::invalid_argument("GridFunctionIntegrator::integrate(): "
+                                    "grid function is defined on a different space");
+    return integrate(gridFunction.coefficients());
+}
+
+template <typename BasisFunctionType, typename ResultType>
+arma::Col<ResultType>
+GridFunctionIntegrator<BasisFunctionType, ResultType>::integrate(
+    const arma::Col<ResultType>& coefficients) const
+{
+    const size_t dofCount = m_offsets.size() - 1;
+    if (coefficients.n_rows != dofCount)
+        throw std::invalid_argument("GridFunctionIntegrator::integrate(): "
+                                    "incorrect number of coefficients");
+    arma::Col<ResultType> integral(m_codomainDim);
+    integral.fill(0.);
+    for (size_t dof = 0; dof < dofCount; ++dof) {
+        const ResultType coefficient = coefficients(dof);
+        for (size_t k = m_offsets[dof]; k < m_offsets[dof + 1]; ++k)
+            integral(m_components[k]) += coefficient * m_weights[k];
+    }
+    return integral;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+arma::Col<ResultType>
+GridFunctionIntegrator<BasisFunctionType, ResultType>::integralIncrement(
+    const std::vector<GlobalDofIndex>& dofs,
+    const arma::Col<ResultType>& coefficientIncrements) const
+{
+    if (coefficientIncrements.n_rows != dofs.size())
+        throw std::invalid_argument("GridFunctionIntegrator::integralIncrement(): "
+                                    "dofs and coefficientIncrements must have "
+                                    "the same length");
+    const size_t dofCount = m_offsets.size() - 1;
+    arma::Col<ResultType> increment(m_codomainDim);
+    increment.fill(0.);
+    for (size_t i = 0; i < dofs.size(); ++i) {
+        const GlobalDofIndex dof = dofs[i];
+        if (dof < 0 || static_cast<size_t>(dof) >= dofCount)
+            throw std::out_of_range("GridFunctionIntegrator::integralIncrement(): "
+                                    "invalid DOF index");
+        for (size_t k = m_offsets[dof]; k < m_offsets[dof + 1]; ++k)
+            increment(m_components[k]) += coefficientIncrements(i) * m_weights[k];
+    }
+    return increment;
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_BASIS_AND_RESULT(GridFunctionIntegrator);
+
+} // namespace Bempp
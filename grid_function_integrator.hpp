@@ -0,0 +1,164 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef grid_function_integrator_hpp
+#define grid_function_integrator_hpp
+
+#include "common/common.hpp"
+#include "common/armadillo_fwd.hpp"
+#include "common/shared_ptr.hpp"
+#include "common/types.hpp"
+
+#include <vector>
+
+namespace Fiber
+{
+
+class ParallelizationOptions;
+
+} // end namespace Fiber
+
+namespace Bempp
+{
+
+template <typename BasisFunctionType, typename ResultType> class GridFunction;
+template <typename BasisFunctionType> class Space;
+template <typename BasisFunctionType> class ElementIntegrationEngine;
+class GridSegment;
+class GridSegmentElementList;
+
+/** \brief Integrator of many grid functions defined on the same space.
+ *
+ *  The integral of a grid function over a grid segment is a linear function
+ *  of its coefficients: its <tt>d</tt>th component is equal to
+ *  <tt>sum_i w(d, i) c(i)</tt>, where <tt>c(i)</tt> is the <tt>i</tt>th
+ *  coefficient and <tt>w(d, i)</tt> the integral of the <tt>d</tt>th
+ *  component of the <tt>i</tt>th basis function over the segment. On
+ *  construction, this class evaluates the weights <tt>w(d, i)</tt> once and
+ *  stores their non-zero entries column by column (i.e. grouped by global
+ *  DOFs). The local integrals of the elements are stored in one slot per
+ *  local DOF and summed per global DOF, in parallel, with the help of the
+ *  global-to-local DOF map of the space. Each subsequent integration is a
+ *  sparse matrix-vector product, and the change of an integral caused by a
+ *  change of a few coefficients costs only as much as the number of
+ *  modified coefficients. */
+template <typename BasisFunctionType, typename ResultType>
+class GridFunctionIntegrator
+{
+public:
+    /** \brief Constructor.
+     *
+     *  Prepare the integration of functions from \p space over the whole grid
+     *  on which \p space is defined. The weights are evaluated with the
+     *  default parallelization options, i.e. with all available threads. */
+    explicit GridFunctionIntegrator(
+            const shared_ptr<const Space<BasisFunctionType> >& space);
+
+    /** \brief Constructor.
+     *
+     *  Prepare the integration of functions from \p space over the whole grid
+     *  on which \p space is defined, evaluating the weights with at most as
+     *  many threads as allowed by \p parallelOptions. */
+    GridFunctionIntegrator(
+            const shared_ptr<const Space<BasisFunctionType> >& space,
+            const Fiber::ParallelizationOptions& parallelOptions);
+
+    /** \brief Constructor.
+     *
+     *  Prepare the integration of functions from \p space over the segment
+     *  \p segment of the grid on which \p space is defined. The weights are
+     *  evaluated with the default parallelization options. */
+    GridFunctionIntegrator(
+            const shared_ptr<const Space<BasisFunctionType> >& space,
+            const GridSegment& segment);
+
+    /** \brief Constructor.
+     *
+     *  Prepare the integration of functions from \p space over the segment
+     *  \p segment of the grid on which \p space is defined, evaluating the
+     *  weights with at most as many threads as allowed by \p
+     *  parallelOptions. */
+    GridFunctionIntegrator(
+            const shared_ptr<const Space<BasisFunctionType> >& space,
+            const GridSegment& segment,
+            const Fiber::ParallelizationOptions& parallelOptions);
+
+    /** \brief Constructor.
+     *
+     *  Prepare the integration of functions from \p space over the elements
+     *  from the precomputed list \p elements, evaluating the weights with at
+     *  most as many threads as allowed by \p parallelOptions. */
+    GridFunctionIntegrator(
+            const shared_ptr<const Space<BasisFunctionType> >& space,
+            const shared_ptr<const GridSegmentElementList>& elements,
+            const Fiber::ParallelizationOptions& parallelOptions);
+
+    /** \brief Space of the functions handled by this integrator. */
+    shared_ptr<const Space<BasisFunctionType> > space() const {
+        return m_space;
+    }
+
+    /** \brief Number of components of the integrals. */
+    int codomainDimension() const {
+        return m_codomainDim;
+    }
+
+    /** \brief Number of stored non-zero weights. */
+    size_t nonzeroWeightCount() const {
+        return m_weights.size();
+    }
+
+    /** \brief Return the integral of \p gridFunction.
+     *
+     *  An exception is thrown if \p gridFunction is not defined on the space
+     *  passed to the constructor. */
+    arma::Col<ResultType> integrate(
+            const GridFunction<BasisFunctionType, ResultType>& gridFunction) const;
+
+    /** \brief Return the integral of the function from space() with
+     *  coefficients \p coefficients. */
+    arma::Col<ResultType> integrate(
+            const arma::Col<ResultType>& coefficients) const;
+
+    /** \brief Return the change of the integral of a function caused by
+     *  incrementing its coefficients with indices \p dofs by \p
+     *  coefficientIncrements. */
+    arma::Col<ResultType> integralIncrement(
+            const std::vector<GlobalDofIndex>& dofs,
+            const arma::Col<ResultType>& coefficientIncrements) const;
+
+private:
+    /** \cond PRIVATE */
+    void initialize(const ElementIntegrationEngine<BasisFunctionType>& engine,
+                    const Fiber::ParallelizationOptions& parallelOptions);
+
+    shared_ptr<const Space<BasisFunctionType> > m_space;
+    int m_codomainDim;
+    // Weights associated with the global DOF i are stored at positions
+    // m_offsets[i], ..., m_offsets[i + 1] - 1 of m_components and m_weights
+    std::vector<size_t> m_offsets;
+    std::vector<int> m_components;
+    std::vector<BasisFunctionType> m_weights;
+    /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,172 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "grid_segment_element_list.hpp"
+
+#include "grid/entity.hpp"
+#include "grid/entity_iterator.hpp"
+#include "grid/entity_pointer.hpp"
+#include "grid/geometry.hpp"
+#include "grid/grid.hpp"
+#include "grid/grid_segment.hpp"
+#include "grid/grid_view.hpp"
+#include "grid/index_set.hpp"
+
+#include <boost/make_shared.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <utility>
+
+namespace Bempp
+{
+
+namespace
+{
+    struct SegmentElementFilter
+    {
+        explicit SegmentElementFilter(const GridSegment& segment) :
+            m_segment(segment)
+        {}
+
+        bool operator() (size_t elementIndex) const {
+            return m_segment.contains(0 /*codim*/, elementIndex);
+        }
+
+        const GridSegment& m_segment;
+    };
+
+    struct MaskElementFilter
+    {
+        explicit MaskElementFilter(const std::vector<bool>& mask) :
+            m_mask(mask)
+        {}
+
+        bool operator() (size_t elementIndex) const {
+            return elementIndex < m_mask.size() && m_mask[elementIndex];
+        }
+
+        const std::vector<bool>& m_mask;
+    };
+
+    class GeometryLoopBody
+    {
+    public:
+        GeometryLoopBody(const GridSegmentElementList& elements,
+                         GridSegmentElementList::Geometries& geometries) :
+            m_elements(elements), m_geometries(geometries)
+        {}
+
+        void operator() (const tbb::blocked_range<size_t>& r) const {
+            for (size_t i = r.begin(); i < r.end(); ++i) {
+                const Geometry& geometry = m_elements.element(i).geometry();
+                m_geometries.vertexCounts[i] = geometry.cornerCount();
+                m_geometries.affine[i] = geometry.affine();
+                if (m_geometries.affine[i])
+                    m_geometries.volumes[i] = geometry.volume();
+            }
+        }
+
+    private:
+        const GridSegmentElementList& m_elements;
+        GridSegmentElementList::Geometries& m_geometries;
+    };
+}
+
+GridSegmentElementList::GridSegmentElementList(
+    const Grid& grid, const GridSegment& segment) :
+    m_view(grid.leafView().release())
+{
+    collectElements(SegmentElementFilter(segment));
+}
+
+GridSegmentElementList::GridSegmentElementList(
+    const Grid& grid, const std::vector<bool>& elementMask) :
+    m_view(grid.leafView().release())
+{
+    collectElements(MaskElementFilter(elementMask));
+}
+
+GridSegmentElementList::~GridSegmentElementList()
+{
+}
+
+const Entity<0>& GridSegmentElementList::element(size_t i) const
+{
+    return m_elements[i].entity();
+}
+
+const GridSegmentElementList::Geometries& GridSegmentElementList::geometries() const
+{
+    shared_ptr<const Geometries> geometries = m_geometries.get();
+    if (!geometries) {
+        LazySharedPtr<const Geometries>::Initializer initializer(m_geometries);
+        geometries = initializer.value();
+        if (!geometries) {
+            shared_ptr<Geometries> newGeometries = boost::make_shared<Geometries>();
+            newGeometries->vertexCounts.resize(size());
+            newGeometries->affine.resize(size());
+            newGeometries->volumes.assign(size(), 0.);
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, size()),
+                              GeometryLoopBody(*this, *newGeometries));
+            geometries = initializer.publish(newGeometries);
+        }
+    }
+    // The published object lives as long as the list
+    return *geometries;
+}
+
+template <typename ElementFilter>
+void GridSegmentElementList::collectElements(const ElementFilter& filter)
+{
+    typedef std::pair<size_t, EntityPointer<0>*> IndexedElement;
+
+    const IndexSet& indexSet = m_view->indexSet();
+    std::vector<IndexedElement> elements;
+    try {
+        std::auto_ptr<EntityIterator<0> > it = m_view->entityIterator<0>();
+        for (; !it->finished(); it->next()) {
+            const size_t index = indexSet.entityIndex(it->entity());
+            if (filter(index)) {
+                std::auto_ptr<EntityPointer<0> > element = it->frozen();
+                elements.push_back(IndexedElement(index, element.get()));
+                element.release();
+            }
+        }
+    }
+    catch (...) {
+        for (size_t i = 0; i < elements.size(); ++i)
+            delete elements[i].second;
+        throw;
+    }
+
+    // Traversal order need not coincide with index order
+    std::sort(elements.begin(), elements.end());
+    m_indices.resize(elements.size());
+    m_elements.reserve(elements.size());
+    for (size_t i = 0; i < elements.size(); ++i) {
+        m_indices[i] = elements[i].first;
+        m_elements.push_back(elements[i].second);
+    }
+}
+
+} // namespace Bempp
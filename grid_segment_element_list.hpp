@@ -0,0 +1,121 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef grid_segment_element_list_hpp
+#define grid_segment_element_list_hpp
+
+#include "lazy_shared_ptr.hpp"
+
+#include "common/common.hpp"
+
+#include <boost/noncopyable.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <vector>
+
+namespace Bempp
+{
+
+class Grid;
+class GridSegment;
+class GridView;
+template <int codim> class Entity;
+template <int codim> class EntityPointer;
+
+/** \brief Sorted list of the elements belonging to a grid segment.
+ *
+ *  The list stores the leaf-view indices of the elements of the segment in
+ *  ascending order, together with pointers to these elements. It is built by
+ *  a single traversal of the leaf view; afterwards, loops over the elements
+ *  of the segment cost time proportional to the size of the segment rather
+ *  than to the size of the grid. Objects that repeatedly loop over the same
+ *  segment should build the list once and keep it, as do the
+ *  segment-restricted vector spaces. */
+class GridSegmentElementList : boost::noncopyable
+{
+public:
+    /** \brief Construct the list of the elements of \p grid belonging to \p
+     *  segment. */
+    GridSegmentElementList(const Grid& grid, const GridSegment& segment);
+
+    /** \brief Construct the list of the elements of \p grid whose leaf-view
+     *  indices \p i satisfy <tt>elementMask[i] == true</tt>. */
+    GridSegmentElementList(const Grid& grid, const std::vector<bool>& elementMask);
+
+    ~GridSegmentElementList();
+
+    /** \brief Number of elements in the list. */
+    size_t size() const {
+        return m_indices.size();
+    }
+
+    /** \brief Leaf-view index of the <tt>i</tt>th element of the list. */
+    size_t elementIndex(size_t i) const {
+        return m_indices[i];
+    }
+
+    /** \brief Leaf-view indices of all elements of the list, in ascending
+     *  order. */
+    const std::vector<size_t>& elementIndices() const {
+        return m_indices;
+    }
+
+    /** \brief Reference to the <tt>i</tt>th element of the list. */
+    const Entity<0>& element(size_t i) const;
+
+    /** \brief Shape data of the elements of the list, indexed by their
+     *  positions in the list. */
+    struct Geometries
+    {
+        std::vector<int> vertexCounts;
+        // Nonzero if the geometry of the element is affine
+        std::vector<char> affine;
+        // Volumes of the elements with affine geometries (zero for the others)
+        std::vector<double> volumes;
+    };
+
+    /** \brief Vertex counts, affinity flags and volumes of the elements.
+     *
+     *  These data are evaluated in parallel on first call and then kept with
+     *  the list; they are shared by all ElementIntegrationEngines built on
+     *  the same list (e.g. the list owned by a segment-restricted vector
+     *  space). This function is thread-safe. */
+    const Geometries& geometries() const;
+
+    /** \brief Leaf view to which the elements belong. */
+    const GridView& gridView() const {
+        return *m_view;
+    }
+
+private:
+    /** \cond PRIVATE */
+    template <typename ElementFilter>
+    void collectElements(const ElementFilter& filter);
+
+    boost::scoped_ptr<GridView> m_view;
+    std::vector<size_t> m_indices;
+    boost::ptr_vector<EntityPointer<0> > m_elements;
+    mutable LazySharedPtr<const Geometries> m_geometries;
+    /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
@@ -1,22 +1,19 @@
 #include "integrate_grid_function.hpp"
 
+#include "element_integration_engine.hpp"
+
 #include "common/scalar_traits.hpp"
+#include "assembly/assembly_options.hpp"
+#include "assembly/context.hpp"
 #include "assembly/grid_function.hpp"
-#include "fiber/basis_data.hpp"
-#include "fiber/default_single_quadrature_rule_family.hpp"
 #include "fiber/explicit_instantiation.hpp"
-#include "fiber/geometrical_data.hpp"
-#include "fiber/shapeset.hpp"
-#include "grid/entity.hpp"
-#include "grid/entity_iterator.hpp"
-#include "grid/geometry.hpp"
 #include "grid/grid.hpp"
 #include "grid/grid_segment.hpp"
 #include "grid/grid_view.hpp"
 #include "space/space.hpp"
 
-#include <iostream>
-#include <map>
+#include <memory>
+#include <stdexcept>
 #include <vector>
 
 namespace Bempp
@@ -24,24 +21,241 @@ namespace Bempp
 
 namespace
 {
-    template <typename BasisFunctionType>
-    struct ShapesetData
+    // Accumulates the integral of a single function
+    template <typename BasisFunctionType, typename ResultType>
+    class IntegralConsumer
+    {
+    public:
+        IntegralConsumer(const arma::Col<ResultType>& coeffs, int codomainDim) :
+            m_coeffs(coeffs), m_integral(codomainDim)
+        {
+            m_integral.fill(0.);
+        }
+
+        IntegralConsumer(IntegralConsumer& other, tbb::split) :
+            m_coeffs(other.m_coeffs), m_integral(other.m_integral.n_rows)
+        {
+            m_integral.fill(0.);
+        }
+
+        void addElement(size_t elementIndex,
+                        const std::vector<GlobalDofIndex>& globalDofs,
+                        const arma::Mat<BasisFunctionType>& localIntegrals)
+        {
+            for (int dim = 0; dim < localIntegrals.n_cols; ++dim)
+                for (size_t i = 0; i < globalDofs.size(); ++i)
+                    if (globalDofs[i] >= 0)
+                        m_integral(dim) += 
+                            m_coeffs(globalDofs[i]) * localIntegrals(i, dim);
+        }
+
+        void join(IntegralConsumer& other)
+        {
+            m_integral += other.m_integral;
+        }
+
+        const arma::Col<ResultType>& integral() const
+        {
+            return m_integral;
+        }
+
+    private:
+        const arma::Col<ResultType>& m_coeffs;
+        arma::Col<ResultType> m_integral;
+    };
+
+    // Accumulates the integrals of several functions, whose coefficients
+    // are stored in the columns of a matrix
+    template <typename BasisFunctionType, typename ResultType>
+    class MultiIntegralConsumer
     {
-        typedef typename ScalarTraits<BasisFunctionType>::RealType CoordinateType;
+    public:
+        MultiIntegralConsumer(const arma::Mat<ResultType>& coeffs, int codomainDim) :
+            m_coeffs(coeffs), m_integrals(codomainDim, coeffs.n_cols)
+        {
+            m_integrals.fill(0.);
+        }
+
+        MultiIntegralConsumer(MultiIntegralConsumer& other, tbb::split) :
+            m_coeffs(other.m_coeffs),
+            m_integrals(other.m_integrals.n_rows, other.m_integrals.n_cols)
+        {
+            m_integrals.fill(0.);
+        }
 
-        int functionCount;
-        arma::Mat<CoordinateType> quadPoints;
-        std::vector<CoordinateType> quadWeights;
-        Fiber::BasisData<BasisFunctionType> basisData;
+        void addElement(size_t elementIndex,
+                        const std::vector<GlobalDofIndex>& globalDofs,
+                        const arma::Mat<BasisFunctionType>& localIntegrals)
+        {
+            // Gather the local coefficients of all functions and add the
+            // product of the local integrals and coefficients to the result
+            m_localCoeffs.set_size(globalDofs.size(), m_coeffs.n_cols);
+            for (size_t i = 0; i < globalDofs.size(); ++i)
+                if (globalDofs[i] >= 0)
+                    m_localCoeffs.row(i) = m_coeffs.row(globalDofs[i]);
+                else
+                    m_localCoeffs.row(i).fill(0.);
+            // The transposed local integrals, converted to ResultType, and
+            // their product with the coefficients are written to members
+            // whose memory is reused from element to element
+            m_localIntegralsTransposed.set_size(localIntegrals.n_cols,
+                                                localIntegrals.n_rows);
+            for (size_t i = 0; i < localIntegrals.n_rows; ++i)
+                for (size_t dim = 0; dim < localIntegrals.n_cols; ++dim)
+                    m_localIntegralsTransposed(dim, i) = localIntegrals(i, dim);
+            m_elementIntegrals = m_localIntegralsTransposed * m_localCoeffs;
+            m_integrals += m_elementIntegrals;
+        }
+
+        void join(MultiIntegralConsumer& other)
+        {
+            m_integrals += other.m_integrals;
+        }
+
+        const arma::Mat<ResultType>& integrals() const
+        {
+            return m_integrals;
+        }
+
+    private:
+        const arma::Mat<ResultType>& m_coeffs;
+        arma::Mat<ResultType> m_integrals;
+        arma::Mat<ResultType> m_localCoeffs;
+        arma::Mat<ResultType> m_localIntegralsTransposed;
+        arma::Mat<ResultType> m_elementIntegrals;
     };
+
+    // Accumulates the integrals of a single function over several groups of
+    // elements. The element with index e belongs to the groups
+    // groups[groupOffsets[e]], ..., groups[groupOffsets[e + 1] - 1].
+    template <typename BasisFunctionType, typename ResultType>
+    class GroupedIntegralConsumer
+    {
+    public:
+        GroupedIntegralConsumer(const arma::Col<ResultType>& coeffs,
+                                const std::vector<size_t>& groupOffsets,
+                                const std::vector<int>& groups,
+                                int codomainDim, int groupCount) :
+            m_coeffs(coeffs), m_groupOffsets(groupOffsets), m_groups(groups),
+            m_integrals(codomainDim, groupCount),
+            m_elementIntegral(codomainDim)
+        {
+            m_integrals.fill(0.);
+        }
+
+        GroupedIntegralConsumer(GroupedIntegralConsumer& other, tbb::split) :
+            m_coeffs(other.m_coeffs),
+            m_groupOffsets(other.m_groupOffsets), m_groups(other.m_groups),
+            m_integrals(other.m_integrals.n_rows, other.m_integrals.n_cols),
+            m_elementIntegral(other.m_elementIntegral.n_rows)
+        {
+            m_integrals.fill(0.);
+        }
+
+        void addElement(size_t elementIndex,
+                        const std::vector<GlobalDofIndex>& globalDofs,
+                        const arma::Mat<BasisFunctionType>& localIntegrals)
+        {
+            // The integral over the element is evaluated once, then added to
+            // all groups containing the element
+            m_elementIntegral.fill(0.);
+            for (int dim = 0; dim < localIntegrals.n_cols; ++dim)
+                for (size_t i = 0; i < globalDofs.size(); ++i)
+                    if (globalDofs[i] >= 0)
+                        m_elementIntegral(dim) += 
+                            m_coeffs(globalDofs[i]) * localIntegrals(i, dim);
+            for (size_t k = m_groupOffsets[elementIndex];
+                 k < m_groupOffsets[elementIndex + 1]; ++k)
+                m_integrals.col(m_groups[k]) += m_elementIntegral;
+        }
+
+        void join(GroupedIntegralConsumer& other)
+        {
+            m_integrals += other.m_integrals;
+        }
+
+        const arma::Mat<ResultType>& integrals() const
+        {
+            return m_integrals;
+        }
+
+    private:
+        const arma::Col<ResultType>& m_coeffs;
+        const std::vector<size_t>& m_groupOffsets;
+        const std::vector<int>& m_groups;
+        arma::Mat<ResultType> m_integrals;
+        arma::Col<ResultType> m_elementIntegral;
+    };
+
+    template <typename BasisFunctionType, typename ResultType>
+    arma::Col<ResultType> integrateWithEngine(
+        const ElementIntegrationEngine<BasisFunctionType>& engine,
+        const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
+        const Fiber::ParallelizationOptions& parallelOptions)
+    {
+        IntegralConsumer<BasisFunctionType, ResultType> consumer(
+            gridFunction.coefficients(), engine.codomainDimension());
+        engine.integrate(consumer, parallelOptions);
+        return consumer.integral();
+    }
+
+    template <typename BasisFunctionType, typename ResultType>
+    arma::Mat<ResultType> integrateWithEngine(
+        const ElementIntegrationEngine<BasisFunctionType>& engine,
+        const Space<BasisFunctionType>& space,
+        const arma::Mat<ResultType>& coefficients,
+        const Fiber::ParallelizationOptions& parallelOptions)
+    {
+        if (coefficients.n_rows != space.globalDofCount())
+            throw std::invalid_argument("integrateGridFunctionOnSegment(): "
+                                        "incorrect number of coefficients");
+        MultiIntegralConsumer<BasisFunctionType, ResultType> consumer(
+            coefficients, space.codomainDimension());
+        engine.integrate(consumer, parallelOptions);
+        return consumer.integrals();
+    }
+
+    template <typename BasisFunctionType, typename ResultType>
+    arma::Mat<ResultType> integrateOverGroups(
+        const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
+        const std::vector<size_t>& groupOffsets,
+        const std::vector<int>& groups,
+        int groupCount,
+        const Fiber::ParallelizationOptions& parallelOptions)
+    {
+        const Space<BasisFunctionType>& space = *gridFunction.space();
+        const size_t elementCount = groupOffsets.size() - 1;
+        std::vector<bool> elementMask(elementCount);
+        for (size_t e = 0; e < elementCount; ++e)
+            elementMask[e] = groupOffsets[e + 1] > groupOffsets[e];
+
+        ElementIntegrationEngine<BasisFunctionType> engine(space, elementMask,
+                                                           parallelOptions);
+        GroupedIntegralConsumer<BasisFunctionType, ResultType> consumer(
+            gridFunction.coefficients(), groupOffsets, groups,
+            space.codomainDimension(), groupCount);
+        engine.integrate(consumer, parallelOptions);
+        return consumer.integrals();
+    }
 }
 
 template <typename BasisFunctionType, typename ResultType>
 arma::Col<ResultType> integrateGridFunction(
     const GridFunction<BasisFunctionType, ResultType>& gridFunction)
 {
-    return integrateGridFunctionOnSegment(
-        gridFunction, GridSegment::wholeGrid(*gridFunction.space()->grid()));
+    return integrateGridFunction(
+        gridFunction,
+        gridFunction.context()->assemblyOptions().parallelizationOptions());
+}
+
+template <typename BasisFunctionType, typename ResultType>
+arma::Col<ResultType> integrateGridFunction(
+    const GridFunction<BasisFunctionType, ResultType>& gridFunction,
+    const Fiber::ParallelizationOptions& parallelOptions)
+{
+    const Space<BasisFunctionType>& space = *gridFunction.space();
+    ElementIntegrationEngine<BasisFunctionType> engine(space, parallelOptions);
+    return integrateWithEngine(engine, gridFunction, parallelOptions);
 }
 
 template <typename BasisFunctionType, typename ResultType>
@@ -49,103 +263,258 @@ arma::Col<ResultType> integrateGridFunctionOnSegment(
     const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
     const GridSegment &gridSegment)
 {
-    typedef typename ScalarTraits<BasisFunctionType>::RealType CoordinateType;
+    return integrateGridFunctionOnSegment(
+        gridFunction, gridSegment,
+        gridFunction.context()->assemblyOptions().parallelizationOptions());
+}
 
-    const arma::Col<ResultType>& coeffs = gridFunction.coefficients();
+template <typename BasisFunctionType, typename ResultType>
+arma::Col<ResultType> integrateGridFunctionOnSegment(
+    const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
+    const GridSegment &gridSegment,
+    const Fiber::ParallelizationOptions& parallelOptions)
+{
     const Space<BasisFunctionType>& space = *gridFunction.space();
+    ElementIntegrationEngine<BasisFunctionType> engine(space, gridSegment,
+                                                       parallelOptions);
+    return integrateWithEngine(engine, gridFunction, parallelOptions);
+}
 
-    const int codomainDim = space.codomainDimension();
-    arma::Col<ResultType> integral(codomainDim);
-    integral.fill(0.);
+template <typename BasisFunctionType, typename ResultType>
+arma::Col<ResultType> integrateGridFunctionOnSegment(
+    const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
+    const shared_ptr<const GridSegmentElementList>& elements)
+{
+    return integrateGridFunctionOnSegment(
+        gridFunction, elements,
+        gridFunction.context()->assemblyOptions().parallelizationOptions());
+}
 
-    const Grid& grid = *space.grid();
-    std::auto_ptr<GridView> view = grid.leafView();
-    std::auto_ptr<EntityIterator<0> > it = view->entityIterator<0>();
-    const IndexSet& indexSet = view->indexSet();
-
-    std::vector<GlobalDofIndex> globalDofs;
-    std::vector<BasisFunctionType> localDofWeights;
-    std::vector<ResultType> localCoeffs;
-
-    typedef std::map<const Fiber::Shapeset<BasisFunctionType>*,
-        ShapesetData<BasisFunctionType> > ShapesetCache;
-    ShapesetCache shapesetCache;
-
-    Fiber::DefaultSingleQuadratureRuleFamily<CoordinateType> quadRuleFamily;
-
-    Fiber::GeometricalData<CoordinateType> geomData;
-
-    for (; !it->finished(); it->next()) {
-        const Entity<0>& element = it->entity();
-        if (!gridSegment.contains(0 /*codim*/, indexSet.entityIndex(element)))
-            continue;
-
-        space.getGlobalDofs(element, globalDofs, localDofWeights);
-        localCoeffs.resize(globalDofs.size());
-
-        bool anyDofsUsed = false;
-        for (size_t i = 0; i < globalDofs.size(); ++i)
-            if (globalDofs[i] >= 0) {
-                anyDofsUsed = true;
-                localCoeffs[i] = coeffs(globalDofs[i]) * localDofWeights[i];
-            } else {
-                localCoeffs[i] = 0.;
-            }
-        if (!anyDofsUsed)
-            continue;
-
-        const Geometry &geometry = element.geometry();
-
-        const Fiber::Shapeset<BasisFunctionType>& shapeset = space.shapeset(element);
-        typename ShapesetCache::const_iterator shapesetIt = 
-            shapesetCache.find(&shapeset);
-        if (shapesetIt == shapesetCache.end())
-        {
-            ShapesetData<BasisFunctionType> data;
-            data.functionCount = shapeset.size();
+template <typename BasisFunctionType, typename ResultType>
+arma::Col<ResultType> integrateGridFunctionOnSegment(
+    const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
+    const shared_ptr<const GridSegmentElementList>& elements,
+    const Fiber::ParallelizationOptions& parallelOptions)
+{
+    const Space<BasisFunctionType>& space = *gridFunction.space();
+    ElementIntegrationEngine<BasisFunctionType> engine(space, elements,
+                                                       parallelOptions);
+    return integrateWithEngine(engine, gridFunction, parallelOptions);
+}
 
-            Fiber::SingleQuadratureDescriptor desc;
-            desc.vertexCount = geometry.cornerCount();
-            desc.order = shapeset.order();
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunction(
+    const std::vector<GridFunction<BasisFunctionType, ResultType> >& gridFunctions)
+{
+    if (gridFunctions.empty())
+        throw std::invalid_argument("integrateGridFunction(): "
+                                    "no grid functions given");
+    return integrateGridFunctionOnSegment(
+        gridFunctions,
+        GridSegment::wholeGrid(*gridFunctions.front().space()->grid()));
+}
 
-            quadRuleFamily.fillQuadraturePointsAndWeights(
-                desc, data.quadPoints, data.quadWeights);
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunctionOnSegment(
+    const std::vector<GridFunction<BasisFunctionType, ResultType> >& gridFunctions,
+    const GridSegment &gridSegment)
+{
+    if (gridFunctions.empty())
+        throw std::invalid_argument("integrateGridFunctionOnSegment(): "
+                                    "no grid functions given");
+    const GridFunction<BasisFunctionType, ResultType>& first = gridFunctions.front();
+    const Space<BasisFunctionType>& space = *first.space();
+    arma::Mat<ResultType> coefficients(space.globalDofCount(), gridFunctions.size());
+    for (size_t j = 0; j < gridFunctions.size(); ++j) {
+        if (gridFunctions[j].space().get() != &space)
+            throw std::invalid_argument("integrateGridFunctionOnSegment(): "
+                                        "all grid functions must be defined "
+                                        "on the same space");
+        coefficients.col(j) = gridFunctions[j].coefficients();
+    }
+    return integrateGridFunctionOnSegment(
+        space, coefficients, gridSegment,
+        first.context()->assemblyOptions().parallelizationOptions());
+}
 
-            // These would need to be set differently if arbitrary functionals
-            // were allowed.
-            const size_t basisDataType = Fiber::VALUES;
-            shapeset.evaluate(basisDataType, data.quadPoints, Fiber::ALL_DOFS, data.basisData);
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunction(
+    const Space<BasisFunctionType>& space,
+    const arma::Mat<ResultType>& coefficients,
+    const Fiber::ParallelizationOptions& parallelOptions)
+{
+    ElementIntegrationEngine<BasisFunctionType> engine(space, parallelOptions);
+    return integrateWithEngine(engine, space, coefficients, parallelOptions);
+}
 
-            shapesetIt = shapesetCache.insert(
-                typename ShapesetCache::value_type(&shapeset, data)).first;
-        }
-        const ShapesetData<BasisFunctionType> &shapesetData = shapesetIt->second;
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunctionOnSegment(
+    const Space<BasisFunctionType>& space,
+    const arma::Mat<ResultType>& coefficients,
+    const GridSegment &gridSegment,
+    const Fiber::ParallelizationOptions& parallelOptions)
+{
+    ElementIntegrationEngine<BasisFunctionType> engine(space, gridSegment,
+                                                       parallelOptions);
+    return integrateWithEngine(engine, space, coefficients, parallelOptions);
+}
 
-        geometry.getData(Fiber::INTEGRATION_ELEMENTS, shapesetData.quadPoints, geomData);
-        for (int pointIndex = 0; pointIndex < shapesetData.quadPoints.n_cols; ++pointIndex)
-        {
-            for (int functionIndex = 0; 
-                 functionIndex < shapesetData.functionCount; ++functionIndex)
-                {
-                    for (int dim = 0; dim < codomainDim; ++dim)
-                    {
-                        integral(dim) += 
-                            localCoeffs[functionIndex] * 
-                            shapesetData.basisData.values(dim, functionIndex, pointIndex) *
-                            geomData.integrationElements(pointIndex) *
-                            shapesetData.quadWeights[pointIndex];
-                    }
-                }
-        }
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunctionOnSegment(
+    const Space<BasisFunctionType>& space,
+    const arma::Mat<ResultType>& coefficients,
+    const shared_ptr<const GridSegmentElementList>& elements,
+    const Fiber::ParallelizationOptions& parallelOptions)
+{
+    ElementIntegrationEngine<BasisFunctionType> engine(space, elements,
+                                                       parallelOptions);
+    return integrateWithEngine(engine, space, coefficients, parallelOptions);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunctionOnSegments(
+    const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
+    const std::vector<GridSegment>& gridSegments)
+{
+    return integrateGridFunctionOnSegments(
+        gridFunction, gridSegments,
+        gridFunction.context()->assemblyOptions().parallelizationOptions());
+}
+
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunctionOnSegments(
+    const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
+    const std::vector<GridSegment>& gridSegments,
+    const Fiber::ParallelizationOptions& parallelOptions)
+{
+    const Grid& grid = *gridFunction.space()->grid();
+    std::auto_ptr<GridView> view = grid.leafView();
+    const size_t elementCount = view->entityCount(0);
+
+    // Find the segments containing each element
+    std::vector<size_t> groupOffsets(elementCount + 1, 0);
+    std::vector<int> groups;
+    for (size_t e = 0; e < elementCount; ++e) {
+        for (size_t s = 0; s < gridSegments.size(); ++s)
+            if (gridSegments[s].contains(0 /*codim*/, e))
+                groups.push_back(s);
+        groupOffsets[e + 1] = groups.size();
     }
+    return integrateOverGroups(gridFunction, groupOffsets, groups,
+                               gridSegments.size(), parallelOptions);
+}
 
-    return integral;
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunctionOnLabelledElements(
+    const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
+    const std::vector<int>& elementLabels,
+    int labelCount)
+{
+    return integrateGridFunctionOnLabelledElements(
+        gridFunction, elementLabels, labelCount,
+        gridFunction.context()->assemblyOptions().parallelizationOptions());
+}
+
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunctionOnLabelledElements(
+    const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
+    const std::vector<int>& elementLabels,
+    int labelCount,
+    const Fiber::ParallelizationOptions& parallelOptions)
+{
+    const Grid& grid = *gridFunction.space()->grid();
+    std::auto_ptr<GridView> view = grid.leafView();
+    const size_t elementCount = view->entityCount(0);
+    if (elementLabels.size() != elementCount)
+        throw std::invalid_argument("integrateGridFunctionOnLabelledElements(): "
+                                    "elementLabels must have one entry per element");
+
+    std::vector<size_t> groupOffsets(elementCount + 1, 0);
+    std::vector<int> groups;
+    groups.reserve(elementCount);
+    for (size_t e = 0; e < elementCount; ++e) {
+        const int label = elementLabels[e];
+        if (label >= labelCount)
+            throw std::invalid_argument("integrateGridFunctionOnLabelledElements(): "
+                                        "element label out of range");
+        if (label >= 0)
+            groups.push_back(label);
+        groupOffsets[e + 1] = groups.size();
+    }
+    return integrateOverGroups(gridFunction, groupOffsets, groups,
+                               labelCount, parallelOptions);
 }
 
 #define INSTANTIATE_integrateGridFunction(BASIS, RESULT) \
     template \
         arma::Col<RESULT> integrateGridFunction(\
-            const GridFunction<BASIS, RESULT>& gridFunction)
+            const GridFunction<BASIS, RESULT>& gridFunction); \
+    template \
+        arma::Col<RESULT> integrateGridFunction(\
+            const GridFunction<BASIS, RESULT>& gridFunction, \
+            const Fiber::ParallelizationOptions& parallelOptions); \
+    template \
+        arma::Col<RESULT> integrateGridFunctionOnSegment(\
+            const GridFunction<BASIS, RESULT>& gridFunction, \
+            const GridSegment &gridSegment); \
+    template \
+        arma::Col<RESULT> integrateGridFunctionOnSegment(\
+            const GridFunction<BASIS, RESULT>& gridFunction, \
+            const GridSegment &gridSegment, \
+            const Fiber::ParallelizationOptions& parallelOptions); \
+    template \
+        arma::Col<RESULT> integrateGridFunctionOnSegment(\
+            const GridFunction<BASIS, RESULT>& gridFunction, \
+            const shared_ptr<const GridSegmentElementList>& elements); \
+    template \
+        arma::Col<RESULT> integrateGridFunctionOnSegment(\
+            const GridFunction<BASIS, RESULT>& gridFunction, \
+            const shared_ptr<const GridSegmentElementList>& elements, \
+            const Fiber::ParallelizationOptions& parallelOptions); \
+    template \
+        arma::Mat<RESULT> integrateGridFunction(\
+            const std::vector<GridFunction<BASIS, RESULT> >& gridFunctions); \
+    template \
+        arma::Mat<RESULT> integrateGridFunctionOnSegment(\
+            const std::vector<GridFunction<BASIS, RESULT> >& gridFunctions, \
+            const GridSegment &gridSegment); \
+    template \
+        arma::Mat<RESULT> integrateGridFunction(\
+            const Space<BASIS>& space, \
+            const arma::Mat<RESULT>& coefficients, \
+            const Fiber::ParallelizationOptions& parallelOptions); \
+    template \
+        arma::Mat<RESULT> integrateGridFunctionOnSegment(\
+            const Space<BASIS>& space, \
+            const arma::Mat<RESULT>& coefficients, \
+            const GridSegment &gridSegment, \
+            const Fiber::ParallelizationOptions& parallelOptions); \
+    template \
+        arma::Mat<RESULT> integrateGridFunctionOnSegment(\
+            const Space<BASIS>& space, \
+            const arma::Mat<RESULT>& coefficients, \
+            const shared_ptr<const GridSegmentElementList>& elements, \
+            const Fiber::ParallelizationOptions& parallelOptions); \
+    template \
+        arma::Mat<RESULT> integrateGridFunctionOnSegments(\
+            const GridFunction<BASIS, RESULT>& gridFunction, \
+            const std::vector<GridSegment>& gridSegments); \
+    template \
+        arma::Mat<RESULT> integrateGridFunctionOnSegments(\
+            const GridFunction<BASIS, RESULT>& gridFunction, \
+            const std::vector<GridSegment>& gridSegments, \
+            const Fiber::ParallelizationOptions& parallelOptions); \
+    template \
+        arma::Mat<RESULT> integrateGridFunctionOnLabelledElements(\
+            const GridFunction<BASIS, RESULT>& gridFunction, \
+            const std::vector<int>& elementLabels, \
+            int labelCount); \
+    template \
+        arma::Mat<RESULT> integrateGridFunctionOnLabelledElements(\
+            const GridFunction<BASIS, RESULT>& gridFunction, \
+            const std::vector<int>& elementLabels, \
+            int labelCount, \
+            const Fiber::ParallelizationOptions& parallelOptions)
 
 FIBER_ITERATE_OVER_BASIS_AND_RESULT_TYPES(INSTANTIATE_integrateGridFunction);
 
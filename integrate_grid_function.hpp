@@ -22,25 +22,178 @@
 #define integrate_grid_function_hpp
 
 #include <common/armadillo_fwd.hpp>
+#include <common/shared_ptr.hpp>
+
+#include <vector>
+
+namespace Fiber
+{
+
+class ParallelizationOptions;
+
+} // end namespace Fiber
 
 namespace Bempp
 {
 
 template <typename BasisFunctionType, typename ResultType> class GridFunction;
+template <typename BasisFunctionType> class Space;
 class GridSegment;
+class GridSegmentElementList;
 
 //! Return the integral of \p gridFunction over the grid on which it is defined.
 template <typename BasisFunctionType, typename ResultType>
 arma::Col<ResultType> integrateGridFunction(
     const GridFunction<BasisFunctionType, ResultType>& gridFunction);
 
+//! Return the integral of \p gridFunction over the grid on which it is defined,
+//! using at most as many threads as allowed by \p parallelOptions.
+template <typename BasisFunctionType, typename ResultType>
+arma::Col<ResultType> integrateGridFunction(
+    const GridFunction<BasisFunctionType, ResultType>& gridFunction,
+    const Fiber::ParallelizationOptions& parallelOptions);
+
 //! Return the integral of \p gridFunction over the segment \p gridSegment 
 //! of the grid on which it is defined.
+//!
+//! The elements are processed in parallel, with the thread count limited as
+//! specified by the parallelization options of the assembly options stored in
+//! the context of \p gridFunction. Each call traverses the grid once to find
+//! the elements of \p gridSegment; to integrate repeatedly over the same
+//! segment, use the overload taking a GridSegmentElementList or a
+//! GridFunctionIntegrator, which visits the segment only once.
+template <typename BasisFunctionType, typename ResultType>
+arma::Col<ResultType> integrateGridFunctionOnSegment(
+    const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
+    const GridSegment &gridSegment);
+
+//! Return the integral of \p gridFunction over the segment \p gridSegment 
+//! of the grid on which it is defined, using at most as many threads as
+//! allowed by \p parallelOptions.
+template <typename BasisFunctionType, typename ResultType>
+arma::Col<ResultType> integrateGridFunctionOnSegment(
+    const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
+    const GridSegment &gridSegment,
+    const Fiber::ParallelizationOptions& parallelOptions);
+
+//! Return the integral of \p gridFunction over the elements listed in \p
+//! elements.
+//!
+//! The cost is proportional to the number of listed elements; build the list
+//! once and reuse it to integrate repeatedly over the same segment.
+template <typename BasisFunctionType, typename ResultType>
+arma::Col<ResultType> integrateGridFunctionOnSegment(
+    const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
+    const shared_ptr<const GridSegmentElementList>& elements);
+
+//! Return the integral of \p gridFunction over the elements listed in \p
+//! elements, using at most as many threads as allowed by \p parallelOptions.
 template <typename BasisFunctionType, typename ResultType>
 arma::Col<ResultType> integrateGridFunctionOnSegment(
     const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
+    const shared_ptr<const GridSegmentElementList>& elements,
+    const Fiber::ParallelizationOptions& parallelOptions);
+
+//! Return the integrals of \p gridFunctions over the grid on which they are
+//! defined.
+//!
+//! All functions must be defined on the same space. The <tt>j</tt>th column of
+//! the returned matrix is the integral of the <tt>j</tt>th function. Geometry
+//! data and basis functions are evaluated once per element for all functions.
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunction(
+    const std::vector<GridFunction<BasisFunctionType, ResultType> >& gridFunctions);
+
+//! Return the integrals of \p gridFunctions over the segment \p gridSegment 
+//! of the grid on which they are defined.
+//!
+//! All functions must be defined on the same space. The <tt>j</tt>th column of
+//! the returned matrix is the integral of the <tt>j</tt>th function.
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunctionOnSegment(
+    const std::vector<GridFunction<BasisFunctionType, ResultType> >& gridFunctions,
     const GridSegment &gridSegment);
 
+//! Return the integrals over the grid on which \p space is defined of the
+//! functions from \p space whose coefficients are stored in the columns of \p
+//! coefficients, using at most as many threads as allowed by \p
+//! parallelOptions.
+//!
+//! The <tt>j</tt>th column of the returned matrix is the integral of the
+//! function with coefficients given by the <tt>j</tt>th column of \p
+//! coefficients.
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunction(
+    const Space<BasisFunctionType>& space,
+    const arma::Mat<ResultType>& coefficients,
+    const Fiber::ParallelizationOptions& parallelOptions);
+
+//! Return the integrals over the segment \p gridSegment of the grid on which
+//! \p space is defined of the functions from \p space whose coefficients are
+//! stored in the columns of \p coefficients, using at most as many threads as
+//! allowed by \p parallelOptions.
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunctionOnSegment(
+    const Space<BasisFunctionType>& space,
+    const arma::Mat<ResultType>& coefficients,
+    const GridSegment &gridSegment,
+    const Fiber::ParallelizationOptions& parallelOptions);
+
+//! Return the integrals over the elements listed in \p elements of the
+//! functions from \p space whose coefficients are stored in the columns of \p
+//! coefficients, using at most as many threads as allowed by \p
+//! parallelOptions.
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunctionOnSegment(
+    const Space<BasisFunctionType>& space,
+    const arma::Mat<ResultType>& coefficients,
+    const shared_ptr<const GridSegmentElementList>& elements,
+    const Fiber::ParallelizationOptions& parallelOptions);
+
+//! Return the integrals of \p gridFunction over each of the segments \p
+//! gridSegments of the grid on which it is defined.
+//!
+//! The <tt>j</tt>th column of the returned matrix is the integral over the
+//! <tt>j</tt>th segment. The grid is traversed only once; the local integrals
+//! over elements belonging to several segments are evaluated only once.
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunctionOnSegments(
+    const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
+    const std::vector<GridSegment>& gridSegments);
+
+//! Return the integrals of \p gridFunction over each of the segments \p
+//! gridSegments of the grid on which it is defined, using at most as many
+//! threads as allowed by \p parallelOptions.
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunctionOnSegments(
+    const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
+    const std::vector<GridSegment>& gridSegments,
+    const Fiber::ParallelizationOptions& parallelOptions);
+
+//! Return the integrals of \p gridFunction over groups of elements
+//! identified by labels.
+//!
+//! \p elementLabels must have as many entries as the leaf view of the grid
+//! on which \p gridFunction is defined has elements. The element with index
+//! \p i belongs to the group <tt>elementLabels[i]</tt>, or to no group if
+//! this label is negative. The <tt>j</tt>th column of the returned matrix,
+//! which has \p labelCount columns, is the integral over the group \p j.
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunctionOnLabelledElements(
+    const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
+    const std::vector<int>& elementLabels,
+    int labelCount);
+
+//! Return the integrals of \p gridFunction over groups of elements
+//! identified by labels, using at most as many threads as allowed by \p
+//! parallelOptions.
+template <typename BasisFunctionType, typename ResultType>
+arma::Mat<ResultType> integrateGridFunctionOnLabelledElements(
+    const GridFunction<BasisFunctionType, ResultType>& gridFunction, 
+    const std::vector<int>& elementLabels,
+    int labelCount,
+    const Fiber::ParallelizationOptions& parallelOptions);
+
 } // end namespace Bempp
 
 #endif
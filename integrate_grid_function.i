@@ -2,10 +2,27 @@
 %{
 #define SWIG_FILE_WITH_INIT
 #include <numpy/arrayobject.h>
+#include "grid_function_integrator.hpp"
 #include "integrate_grid_function.hpp"
+#include "python_batch_functor.hpp"
+#include "simple_vector_space.hpp"
+#include "vector_projection.hpp"
+
+#include "assembly/context.hpp"
+#include "fiber/function.hpp"
+#include "grid/grid_segment.hpp"
+
+#include <stdexcept>
 %}
 
 %include "bempp.swg"
+%include "std_vector.i"
+
+namespace std
+{
+%template(_vector_int) vector<int>;
+%template(_vector_GridSegment) vector<Bempp::GridSegment>;
+}
 
 %init %{
     import_array();
@@ -30,6 +47,95 @@ void _integrateGridFunctionOnSegment(
 {
     result = integrateGridFunctionOnSegment(gridFunction, gridSegment);
 }
+
+template <typename BasisFunctionType, typename ResultType>
+void _integrateGridFunctionOnSegments(
+        const GridFunction<BasisFunctionType, ResultType>& gridFunction,
+        const std::vector<GridSegment>& gridSegments,
+        arma::Mat<ResultType> &result)
+{
+    result = integrateGridFunctionOnSegments(gridFunction, gridSegments);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void _integrateGridFunctionOnLabelledElements(
+        const GridFunction<BasisFunctionType, ResultType>& gridFunction,
+        const std::vector<int>& elementLabels,
+        int labelCount,
+        arma::Mat<ResultType> &result)
+{
+    result = integrateGridFunctionOnLabelledElements(
+        gridFunction, elementLabels, labelCount);
+}
+
+// In the two wrappers below, a null gridSegment stands for the whole grid
+template <typename BasisFunctionType, typename ResultType>
+void _integrateCoefficientsOnSegment(
+        const Space<BasisFunctionType>& space,
+        const arma::Mat<ResultType>& coefficients,
+        const GridSegment* gridSegment,
+        const Fiber::ParallelizationOptions& parallelOptions,
+        arma::Mat<ResultType> &result)
+{
+    if (gridSegment)
+        result = integrateGridFunctionOnSegment(
+            space, coefficients, *gridSegment, parallelOptions);
+    else
+        result = integrateGridFunction(space, coefficients, parallelOptions);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void _integrateGridFunctionsOnSegment(
+        const GridFunction<BasisFunctionType, ResultType>& first,
+        const arma::Mat<ResultType>& coefficients,
+        const GridSegment* gridSegment,
+        arma::Mat<ResultType> &result)
+{
+    _integrateCoefficientsOnSegment(
+        *first.space(), coefficients, gridSegment,
+        first.context()->assemblyOptions().parallelizationOptions(), result);
+}
+
+template <typename BasisFunctionType>
+const SimpleVectorSpaceBase<BasisFunctionType>& _projectionSpaceOf(
+        const Space<BasisFunctionType>& space)
+{
+    const SimpleVectorSpaceBase<BasisFunctionType>* vectorSpace =
+        dynamic_cast<const SimpleVectorSpaceBase<BasisFunctionType>*>(&space);
+    if (!vectorSpace)
+        throw std::invalid_argument("projectOnVectorSpace(): space must be a "
+                                    "vector space created by the "
+                                    "simple_vector_spaces module");
+    return *vectorSpace;
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void _projectOnVectorSpace(
+        const Space<BasisFunctionType>& space,
+        const Fiber::Function<ResultType>& function,
+        arma::Col<ResultType> &result)
+{
+    projectOnVectorSpace(_projectionSpaceOf(space), function, result);
+}
+
+// The callable is called from the worker threads, so the GIL is released
+// while the projection runs
+template <typename BasisFunctionType, typename ResultType>
+void _projectCallableOnVectorSpace(
+        const Space<BasisFunctionType>& space,
+        PyObject* callable,
+        bool dependsOnNormals,
+        arma::Col<ResultType> &result)
+{
+    const BatchFunction<PythonBatchFunctor<ResultType> > function(
+        PythonBatchFunctor<ResultType>(
+            callable, space.grid()->dimWorld(), space.codomainDimension(),
+            dependsOnNormals));
+    const SimpleVectorSpaceBase<BasisFunctionType>& vectorSpace =
+        _projectionSpaceOf(space);
+    ScopedGilRelease gilRelease;
+    projectOnVectorSpace(vectorSpace, function, result);
+}
 }
 %}
 
@@ -40,18 +146,72 @@ namespace Bempp
 %apply arma::Col<double>& ARGOUT_COL { arma::Col<double>& result };
 %apply arma::Col<std::complex<float> >& ARGOUT_COL { arma::Col<std::complex<float> >& result };
 %apply arma::Col<std::complex<double> >& ARGOUT_COL { arma::Col<std::complex<double> >& result };
+%apply arma::Mat<float>& ARGOUT_MAT { arma::Mat<float>& result };
+%apply arma::Mat<double>& ARGOUT_MAT { arma::Mat<double>& result };
+%apply arma::Mat<std::complex<float> >& ARGOUT_MAT { arma::Mat<std::complex<float> >& result };
+%apply arma::Mat<std::complex<double> >& ARGOUT_MAT { arma::Mat<std::complex<double> >& result };
+%apply const arma::Mat<float>& IN_MAT { const arma::Mat<float>& coefficients };
+%apply const arma::Mat<double>& IN_MAT { const arma::Mat<double>& coefficients };
+%apply const arma::Mat<std::complex<float> >& IN_MAT { const arma::Mat<std::complex<float> >& coefficients };
+%apply const arma::Mat<std::complex<double> >& IN_MAT { const arma::Mat<std::complex<double> >& coefficients };
 
 BEMPP_INSTANTIATE_SYMBOL_TEMPLATED_ON_BASIS_AND_RESULT(_integrateGridFunction);
 BEMPP_INSTANTIATE_SYMBOL_TEMPLATED_ON_BASIS_AND_RESULT(_integrateGridFunctionOnSegment);
+BEMPP_INSTANTIATE_SYMBOL_TEMPLATED_ON_BASIS_AND_RESULT(_integrateGridFunctionOnSegments);
+BEMPP_INSTANTIATE_SYMBOL_TEMPLATED_ON_BASIS_AND_RESULT(_integrateGridFunctionOnLabelledElements);
+BEMPP_INSTANTIATE_SYMBOL_TEMPLATED_ON_BASIS_AND_RESULT(_integrateCoefficientsOnSegment);
+BEMPP_INSTANTIATE_SYMBOL_TEMPLATED_ON_BASIS_AND_RESULT(_integrateGridFunctionsOnSegment);
+BEMPP_INSTANTIATE_SYMBOL_TEMPLATED_ON_BASIS_AND_RESULT(_projectOnVectorSpace);
+BEMPP_INSTANTIATE_SYMBOL_TEMPLATED_ON_BASIS_AND_RESULT(_projectCallableOnVectorSpace);
+
+// The integrals are returned through output arguments; the constructor
+// taking a precomputed element list is not exposed
+%ignore GridFunctionIntegrator::GridFunctionIntegrator(
+    const shared_ptr<const Space<BasisFunctionType> >&,
+    const shared_ptr<const GridSegmentElementList>&,
+    const Fiber::ParallelizationOptions&);
+%ignore GridFunctionIntegrator::integrate(
+    const GridFunction<BasisFunctionType, ResultType>&) const;
+%ignore GridFunctionIntegrator::integrate(const arma::Col<ResultType>&) const;
+%ignore GridFunctionIntegrator::integralIncrement;
+
+%extend GridFunctionIntegrator
+{
+    void integrate(
+            const GridFunction<BasisFunctionType, ResultType>& gridFunction,
+            arma::Col<ResultType>& result)
+    {
+        result = $self->integrate(gridFunction);
+    }
+}
+
+%include "grid_function_integrator.hpp"
+
+BEMPP_INSTANTIATE_SYMBOL_TEMPLATED_ON_BASIS_AND_RESULT(GridFunctionIntegrator);
 
 %clear arma::Col<float>& result;
 %clear arma::Col<double>& result;
 %clear arma::Col<std::complex<float> >& result;
 %clear arma::Col<std::complex<double> >& result;
+%clear arma::Mat<float>& result;
+%clear arma::Mat<double>& result;
+%clear arma::Mat<std::complex<float> >& result;
+%clear arma::Mat<std::complex<double> >& result;
+%clear const arma::Mat<float>& coefficients;
+%clear const arma::Mat<double>& coefficients;
+%clear const arma::Mat<std::complex<float> >& coefficients;
+%clear const arma::Mat<std::complex<double> >& coefficients;
 }
 
 %pythoncode %{
     def integrateGridFunction(gridFunction):
+        """Integrate gridFunction over the grid on which it is defined.
+
+        gridFunction may also be a list of grid functions defined on the
+        same space; the integral of the jth function is then stored in the
+        jth column of the returned matrix."""
+        if isinstance(gridFunction, (list, tuple)):
+            return _integrateGridFunctions(gridFunction, None)
         import bempp.lib
         basisFunctionType = gridFunction.basisFunctionType()
         resultType = gridFunction.resultType()
@@ -65,6 +225,13 @@ BEMPP_INSTANTIATE_SYMBOL_TEMPLATED_ON_BASIS_AND_RESULT(_integrateGridFunctionOnS
         return func(gridFunction)
 
     def integrateGridFunctionOnSegment(gridFunction, gridSegment):
+        """Integrate gridFunction over the segment gridSegment.
+
+        gridFunction may also be a list of grid functions defined on the
+        same space; the integral of the jth function is then stored in the
+        jth column of the returned matrix."""
+        if isinstance(gridFunction, (list, tuple)):
+            return _integrateGridFunctions(gridFunction, gridSegment)
         import bempp.lib
         basisFunctionType = gridFunction.basisFunctionType()
         resultType = gridFunction.resultType()
@@ -76,6 +243,136 @@ BEMPP_INSTANTIATE_SYMBOL_TEMPLATED_ON_BASIS_AND_RESULT(_integrateGridFunctionOnS
         except KeyError:
             raise TypeError("Function " + fullName + " does not exist.")
         return func(gridFunction, gridSegment)
-%}
 
+    def integrateGridFunctionOnSegments(gridFunction, gridSegments):
+        """Integrate gridFunction over each of the segments gridSegments.
 
+        The integral over the jth segment is stored in the jth column of the
+        returned matrix."""
+        import bempp.lib
+        basisFunctionType = gridFunction.basisFunctionType()
+        resultType = gridFunction.resultType()
+        fullName = ("_integrateGridFunctionOnSegments_" +
+                    bempp.lib.checkType(basisFunctionType) + "_" +
+                    bempp.lib.checkType(resultType))
+        try:
+            func = globals()[fullName]
+        except KeyError:
+            raise TypeError("Function " + fullName + " does not exist.")
+        return func(gridFunction, list(gridSegments))
+
+    def integrateGridFunctionOnLabelledElements(gridFunction, elementLabels,
+                                                labelCount):
+        """Integrate gridFunction over groups of elements identified by labels.
+
+        elementLabels[i] is the group of the element with leaf-view index i,
+        or a negative number if this element belongs to no group. The
+        integral over the group j is stored in the jth column of the
+        returned matrix, which has labelCount columns."""
+        import bempp.lib
+        basisFunctionType = gridFunction.basisFunctionType()
+        resultType = gridFunction.resultType()
+        fullName = ("_integrateGridFunctionOnLabelledElements_" +
+                    bempp.lib.checkType(basisFunctionType) + "_" +
+                    bempp.lib.checkType(resultType))
+        try:
+            func = globals()[fullName]
+        except KeyError:
+            raise TypeError("Function " + fullName + " does not exist.")
+        return func(gridFunction, [int(label) for label in elementLabels],
+                    labelCount)
+
+    def _integrateGridFunctions(gridFunctions, gridSegment):
+        import bempp.lib
+        import numpy
+        if not gridFunctions:
+            raise ValueError("integrateGridFunction(): no grid functions given")
+        first = gridFunctions[0]
+        coefficients = numpy.column_stack(
+            [f.coefficients() for f in gridFunctions])
+        fullName = ("_integrateGridFunctionsOnSegment_" +
+                    bempp.lib.checkType(first.basisFunctionType()) + "_" +
+                    bempp.lib.checkType(first.resultType()))
+        try:
+            func = globals()[fullName]
+        except KeyError:
+            raise TypeError("Function " + fullName + " does not exist.")
+        return func(first, coefficients, gridSegment)
+
+    def integrateCoefficients(space, coefficients, parallelOptions,
+                              gridSegment=None, resultType=None):
+        """Integrate the functions from space with the given coefficients.
+
+        The jth column of the returned matrix is the integral, over
+        gridSegment (by default, the whole grid), of the function whose
+        coefficients are stored in the jth column of coefficients. resultType
+        defaults to the basis function type of space."""
+        import bempp.lib
+        basisFunctionType = space.basisFunctionType()
+        if resultType is None:
+            resultType = basisFunctionType
+        fullName = ("_integrateCoefficientsOnSegment_" +
+                    bempp.lib.checkType(basisFunctionType) + "_" +
+                    bempp.lib.checkType(resultType))
+        try:
+            func = globals()[fullName]
+        except KeyError:
+            raise TypeError("Function " + fullName + " does not exist.")
+        return func(space, coefficients, gridSegment, parallelOptions)
+
+    def gridFunctionIntegrator(space, gridSegment=None, parallelOptions=None,
+                               resultType=None):
+        """Create an integrator of functions from space over gridSegment.
+
+        The whole grid is used if gridSegment is None. resultType defaults
+        to the basis function type of space. The integral of a grid
+        function g is then returned by integrator.integrate(g)."""
+        import bempp.lib
+        basisFunctionType = space.basisFunctionType()
+        if resultType is None:
+            resultType = basisFunctionType
+        fullName = ("GridFunctionIntegrator_" +
+                    bempp.lib.checkType(basisFunctionType) + "_" +
+                    bempp.lib.checkType(resultType))
+        try:
+            cls = globals()[fullName]
+        except KeyError:
+            raise TypeError("Class " + fullName + " does not exist.")
+        args = [space]
+        if gridSegment is not None:
+            args.append(gridSegment)
+        if parallelOptions is not None:
+            args.append(parallelOptions)
+        return cls(*args)
+
+    def projectOnVectorSpace(space, function, resultType=None,
+                             dependsOnNormals=False):
+        """Project function on the vector space space.
+
+        function is either a wrapped Fiber::Function object or a Python
+        callable. A callable is called once per batch of elements as
+        function(points, normals), where points and normals are arrays of
+        shape (worldDimension, n) with the global coordinates and the
+        normals at the n quadrature points of the batch (normals is None
+        unless dependsOnNormals is True). It must return an array of shape
+        (codomainDimension, n) with the function values at these points.
+        resultType defaults to the basis function type of space."""
+        import bempp.lib
+        basisFunctionType = space.basisFunctionType()
+        if resultType is None:
+            resultType = basisFunctionType
+        if callable(function):
+            prefix = "_projectCallableOnVectorSpace_"
+            args = (space, function, dependsOnNormals)
+        else:
+            prefix = "_projectOnVectorSpace_"
+            args = (space, function)
+        fullName = (prefix +
+                    bempp.lib.checkType(basisFunctionType) + "_" +
+                    bempp.lib.checkType(resultType))
+        try:
+            func = globals()[fullName]
+        except KeyError:
+            raise TypeError("Function " + fullName + " does not exist.")
+        return func(*args)
+%}
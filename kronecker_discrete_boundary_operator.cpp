@@ -0,0 +1,282 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "kronecker_discrete_boundary_operator.hpp"
+
+#include "csr_discrete_boundary_operator.hpp"
+#include "simple_vector_space.hpp"
+
+#include "assembly/boundary_operator.hpp"
+#include "fiber/explicit_instantiation.hpp"
+#include "space/space.hpp"
+
+#ifdef WITH_TRILINOS
+#include <Thyra_DefaultSpmdVectorSpace_decl.hpp>
+#endif
+
+#include <boost/make_shared.hpp>
+#include <stdexcept>
+
+namespace Bempp
+{
+
+namespace
+{
+
+// Marks scratch storage as used for the lifetime of the object
+class ScratchGuard
+{
+public:
+    explicit ScratchGuard(bool& inUse) : m_inUse(inUse) {
+        m_inUse = true;
+    }
+
+    ~ScratchGuard() {
+        m_inUse = false;
+    }
+
+private:
+    bool& m_inUse;
+};
+
+} // namespace
+
+template <typename ValueType>
+KroneckerDiscreteBoundaryOperator<ValueType>::KroneckerDiscreteBoundaryOperator(
+    const shared_ptr<const DiscreteBoundaryOperator<ValueType> >& scalarOperator,
+    int componentCount,
+    DofOrdering rowOrdering,
+    DofOrdering columnOrdering) :
+    m_scalarOperator(scalarOperator),
+    m_csrScalarOperator(
+        dynamic_cast<const CsrDiscreteBoundaryOperator<ValueType>*>(
+            scalarOperator.get())),
+    m_componentCount(componentCount),
+    m_rowOrdering(rowOrdering),
+    m_columnOrdering(columnOrdering)
+{
+    if (!scalarOperator)
+        throw std::invalid_argument(
+            "KroneckerDiscreteBoundaryOperator::"
+            "KroneckerDiscreteBoundaryOperator(): "
+            "scalarOperator must not be null");
+    if (componentCount < 1)
+        throw std::invalid_argument(
+            "KroneckerDiscreteBoundaryOperator::"
+            "KroneckerDiscreteBoundaryOperator(): "
+            "componentCount must be positive");
+#ifdef WITH_TRILINOS
+    m_domainSpace = Thyra::defaultSpmdVectorSpace<ValueType>(columnCount());
+    m_rangeSpace = Thyra::defaultSpmdVectorSpace<ValueType>(rowCount());
+#endif
+}
+
+template <typename ValueType>
+unsigned int KroneckerDiscreteBoundaryOperator<ValueType>::rowCount() const
+{
+    return m_scalarOperator->rowCount() * m_componentCount;
+}
+
+template <typename ValueType>
+unsigned int KroneckerDiscreteBoundaryOperator<ValueType>::columnCount() const
+{
+    return m_scalarOperator->columnCount() * m_componentCount;
+}
+
+template <typename ValueType>
+void KroneckerDiscreteBoundaryOperator<ValueType>::collectComponent(
+    const std::vector<int>& indices,
+    const VectorDofNumbering& numbering, int component,
+    std::vector<int>& scalarIndices,
+    std::vector<size_t>& positions) const
+{
+    scalarIndices.clear();
+    positions.clear();
+    for (size_t i = 0; i < indices.size(); ++i)
+        if (numbering.component(indices[i]) == component) {
+            scalarIndices.push_back(numbering.scalarDof(indices[i]));
+            positions.push_back(i);
+        }
+}
+
+template <typename ValueType>
+void KroneckerDiscreteBoundaryOperator<ValueType>::addBlock(
+    const std::vector<int>& rows,
+    const std::vector<int>& cols,
+    const ValueType alpha,
+    arma::Mat<ValueType>& block) const
+{
+    if (block.n_rows != rows.size() || block.n_cols != cols.size())
+        throw std::invalid_argument(
+            "KroneckerDiscreteBoundaryOperator::addBlock(): "
+            "incorrect block size");
+
+    // Entries coupling different components are zero, so the block is
+    // assembled from one (smaller) block of the scalar operator per component
+    const VectorDofNumbering rowNumbering(
+        m_rowOrdering, m_componentCount, m_scalarOperator->rowCount());
+    const VectorDofNumbering colNumbering(
+        m_columnOrdering, m_componentCount, m_scalarOperator->columnCount());
+    std::vector<int> scalarRows, scalarCols;
+    std::vector<size_t> rowPositions, colPositions;
+    arma::Mat<ValueType> scalarBlock;
+    for (int component = 0; component < m_componentCount; ++component) {
+        collectComponent(rows, rowNumbering, component, scalarRows, rowPositions);
+        collectComponent(cols, colNumbering, component, scalarCols, colPositions);
+        if (scalarRows.empty() || scalarCols.empty())
+            continue;
+
+        scalarBlock.zeros(scalarRows.size(), scalarCols.size());
+        m_scalarOperator->addBlock(scalarRows, scalarCols, alpha, scalarBlock);
+        for (size_t j = 0; j < colPositions.size(); ++j)
+            for (size_t i = 0; i < rowPositions.size(); ++i)
+                block(rowPositions[i], colPositions[j]) += scalarBlock(i, j);
+    }
+}
+
+#ifdef WITH_TRILINOS
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType> >
+KroneckerDiscreteBoundaryOperator<ValueType>::domain() const
+{
+    return m_domainSpace;
+}
+
+template <typename ValueType>
+Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType> >
+KroneckerDiscreteBoundaryOperator<ValueType>::range() const
+{
+    return m_rangeSpace;
+}
+
+template <typename ValueType>
+bool KroneckerDiscreteBoundaryOperator<ValueType>::opSupportedImpl(
+    Thyra::EOpTransp M_trans) const
+{
+    return m_scalarOperator->opSupported(M_trans);
+}
+#endif // WITH_TRILINOS
+
+template <typename ValueType>
+void KroneckerDiscreteBoundaryOperator<ValueType>::applyBuiltInImpl(
+    const TranspositionMode trans,
+    const arma::Col<ValueType>& x_in,
+    arma::Col<ValueType>& y_inout,
+    const ValueType alpha,
+    const ValueType beta) const
+{
+    const bool transposed = (trans == TRANSPOSE || trans == CONJUGATE_TRANSPOSE);
+    const size_t scalarXSize = transposed ?
+        m_scalarOperator->rowCount() : m_scalarOperator->columnCount();
+    const size_t scalarYSize = transposed ?
+        m_scalarOperator->columnCount() : m_scalarOperator->rowCount();
+    if (x_in.n_rows != scalarXSize * m_componentCount)
+        throw std::invalid_argument(
+            "KroneckerDiscreteBoundaryOperator::apply(): "
+            "vector x_in has incorrect length");
+    if (y_inout.n_rows != scalarYSize * m_componentCount)
+        throw std::invalid_argument(
+            "KroneckerDiscreteBoundaryOperator::apply(): "
+            "vector y_inout has incorrect length");
+
+    const DofOrdering xOrdering = transposed ? m_rowOrdering : m_columnOrdering;
+    const DofOrdering yOrdering = transposed ? m_columnOrdering : m_rowOrdering;
+
+    // The vectors are handled as the column-major storage of matrices with
+    // one column per component. With interleaved components, they are first
+    // permuted to that layout in scratch arrays. The arrays of the calling
+    // thread are already in use if this product is nested in another one
+    // (TBB may run other tasks on this thread while it waits for the scalar
+    // operator); fresh arrays are then allocated.
+    ApplyScratch& threadScratch = m_applyScratch.local();
+    ApplyScratch nestedScratch;
+    ApplyScratch& scratch = threadScratch.inUse ? nestedScratch : threadScratch;
+    ScratchGuard guard(scratch.inUse);
+    const ValueType* xData = x_in.memptr();
+    if (xOrdering == INTERLEAVED_DOFS) {
+        scratch.x.set_size(x_in.n_rows);
+        interleavedToBlockedDofs(x_in.memptr(), scratch.x.memptr(),
+                                 scalarXSize, m_componentCount);
+        xData = scratch.x.memptr();
+    }
+    ValueType* yData = y_inout.memptr();
+    if (yOrdering == INTERLEAVED_DOFS) {
+        scratch.y.set_size(y_inout.n_rows);
+        if (beta == static_cast<ValueType>(0.))
+            scratch.y.fill(0.);
+        else
+            interleavedToBlockedDofs(y_inout.memptr(), scratch.y.memptr(),
+                                     scalarYSize, m_componentCount);
+        yData = scratch.y.memptr();
+    }
+
+    if (m_csrScalarOperator)
+        m_csrScalarOperator->applyToBlock(trans, xData, yData,
+                                          m_componentCount, alpha, beta);
+    else {
+        const arma::Mat<ValueType> x(const_cast<ValueType*>(xData),
+                                     scalarXSize, m_componentCount,
+                                     false /* copy_aux_mem */, true /* strict */);
+        arma::Mat<ValueType> y(yData, scalarYSize, m_componentCount,
+                               false /* copy_aux_mem */, true /* strict */);
+        m_scalarOperator->apply(trans, x, y, alpha, beta);
+    }
+
+    if (yOrdering == INTERLEAVED_DOFS)
+        blockedToInterleavedDofs(scratch.y.memptr(), y_inout.memptr(),
+                                 scalarYSize, m_componentCount);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType> >
+kroneckerWeakForm(
+    const BoundaryOperator<BasisFunctionType, ResultType>& scalarOperator,
+    const Space<BasisFunctionType>& domain,
+    const Space<BasisFunctionType>& dualToRange)
+{
+    typedef KroneckerDiscreteBoundaryOperator<ResultType> KroneckerOperator;
+
+    const int componentCount = domain.codomainDimension();
+    if (dualToRange.codomainDimension() != componentCount)
+        return shared_ptr<const DiscreteBoundaryOperator<ResultType> >();
+    shared_ptr<const Space<BasisFunctionType> > scalarDomain =
+        scalarSpaceOf(domain);
+    shared_ptr<const Space<BasisFunctionType> > scalarDualToRange =
+        scalarSpaceOf(dualToRange);
+    if (!scalarDomain || !scalarDualToRange ||
+            scalarDomain.get() != scalarOperator.domain().get() ||
+            scalarDualToRange.get() != scalarOperator.dualToRange().get())
+        return shared_ptr<const DiscreteBoundaryOperator<ResultType> >();
+    return boost::make_shared<KroneckerOperator>(
+        scalarOperator.weakForm(), componentCount,
+        dofOrderingOf(dualToRange), dofOrderingOf(domain));
+}
+
+FIBER_INSTANTIATE_CLASS_TEMPLATED_ON_RESULT(KroneckerDiscreteBoundaryOperator);
+
+#define INSTANTIATE_KRONECKER_WEAK_FORM(BASIS, RESULT) \
+    template shared_ptr<const DiscreteBoundaryOperator< RESULT > > \
+    kroneckerWeakForm( \
+        const BoundaryOperator< BASIS, RESULT >& scalarOperator, \
+        const Space< BASIS >& domain, \
+        const Space< BASIS >& dualToRange)
+FIBER_ITERATE_OVER_BASIS_AND_RESULT_TYPES(INSTANTIATE_KRONECKER_WEAK_FORM);
+
+} // namespace Bempp
@@ -0,0 +1,184 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef kronecker_discrete_boundary_operator_hpp
+#define kronecker_discrete_boundary_operator_hpp
+
+#include "dof_ordering.hpp"
+
+#include "common/common.hpp"
+#include "common/shared_ptr.hpp"
+
+#include "assembly/discrete_boundary_operator.hpp"
+
+#ifdef WITH_TRILINOS
+#include <Teuchos_RCP.hpp>
+#include <Thyra_SpmdVectorSpaceBase_decl.hpp>
+#endif
+
+#include <tbb/enumerable_thread_specific.h>
+
+namespace Bempp
+{
+
+template <typename BasisFunctionType, typename ResultType> class BoundaryOperator;
+template <typename BasisFunctionType> class Space;
+template <typename ValueType> class CsrDiscreteBoundaryOperator;
+
+/** \brief Discrete operator <tt>I_n (x) A</tt> acting componentwise on
+ *  vectors of several components.
+ *
+ *  The operator has \p componentCount times as many rows and columns as the
+ *  scalar operator \p A. The rows (columns) are numbered as the DOFs of a
+ *  SimpleVectorSpace with the given DofOrdering: with INTERLEAVED_DOFS, row
+ *  <tt>i * componentCount + c</tt> corresponds to row \p i of \p A and to
+ *  the component \p c; with BLOCKED_DOFS, row <tt>c * n + i</tt> does, \p n
+ *  being the number of rows of \p A. Only \p A is stored; the action of the
+ *  operator is computed as a product of \p A with a matrix having one column
+ *  per component.
+ *
+ *  With blocked ordering, the vectors already are the column-major storage
+ *  of such matrices, so no data need to be rearranged. With interleaved
+ *  ordering, each vector is permuted once to the blocked ordering (and the
+ *  result back) by the tiled kernels of dof_ordering.hpp, in per-thread
+ *  scratch arrays reused from one product to the next. If \p A is a
+ *  CsrDiscreteBoundaryOperator, it is applied to all components in a
+ *  single traversal of the matrix; other operators are applied to the
+ *  components one by one, since DiscreteBoundaryOperator offers no product
+ *  with several vectors. */
+template <typename ValueType>
+class KroneckerDiscreteBoundaryOperator :
+        public DiscreteBoundaryOperator<ValueType>
+{
+public:
+    typedef DiscreteBoundaryOperator<ValueType> Base;
+
+    /** \brief Constructor.
+     *
+     *  \param[in] scalarOperator Operator acting on each component.
+     *  \param[in] componentCount Number of components.
+     *  \param[in] rowOrdering Numbering of the rows.
+     *  \param[in] columnOrdering Numbering of the columns. */
+    KroneckerDiscreteBoundaryOperator(
+            const shared_ptr<const DiscreteBoundaryOperator<ValueType> >& scalarOperator,
+            int componentCount,
+            DofOrdering rowOrdering = INTERLEAVED_DOFS,
+            DofOrdering columnOrdering = INTERLEAVED_DOFS);
+
+    virtual unsigned int rowCount() const;
+    virtual unsigned int columnCount() const;
+
+    virtual void addBlock(const std::vector<int>& rows,
+                          const std::vector<int>& cols,
+                          const ValueType alpha,
+                          arma::Mat<ValueType>& block) const;
+
+    /** \brief Operator acting on each component. */
+    shared_ptr<const DiscreteBoundaryOperator<ValueType> > scalarOperator() const {
+        return m_scalarOperator;
+    }
+
+    /** \brief Number of components. */
+    int componentCount() const {
+        return m_componentCount;
+    }
+
+    /** \brief Numbering of the rows. */
+    DofOrdering rowOrdering() const {
+        return m_rowOrdering;
+    }
+
+    /** \brief Numbering of the columns. */
+    DofOrdering columnOrdering() const {
+        return m_columnOrdering;
+    }
+
+#ifdef WITH_TRILINOS
+public:
+    virtual Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType> > domain() const;
+    virtual Teuchos::RCP<const Thyra::VectorSpaceBase<ValueType> > range() const;
+
+protected:
+    virtual bool opSupportedImpl(Thyra::EOpTransp M_trans) const;
+#endif
+
+private:
+    virtual void applyBuiltInImpl(const TranspositionMode trans,
+                                  const arma::Col<ValueType>& x_in,
+                                  arma::Col<ValueType>& y_inout,
+                                  const ValueType alpha,
+                                  const ValueType beta) const;
+
+private:
+    /** \cond PRIVATE */
+    void collectComponent(const std::vector<int>& indices,
+                          const VectorDofNumbering& numbering, int component,
+                          std::vector<int>& scalarIndices,
+                          std::vector<size_t>& positions) const;
+
+    // Vectors permuted to the blocked ordering
+    struct ApplyScratch
+    {
+        ApplyScratch() : inUse(false) {}
+
+        arma::Col<ValueType> x;
+        arma::Col<ValueType> y;
+        bool inUse;
+    };
+
+    shared_ptr<const DiscreteBoundaryOperator<ValueType> > m_scalarOperator;
+    // m_scalarOperator if it is a CsrDiscreteBoundaryOperator, otherwise null
+    const CsrDiscreteBoundaryOperator<ValueType>* m_csrScalarOperator;
+    int m_componentCount;
+    DofOrdering m_rowOrdering;
+    DofOrdering m_columnOrdering;
+#ifdef WITH_TRILINOS
+    Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType> > m_domainSpace;
+    Teuchos::RCP<const Thyra::SpmdVectorSpaceBase<ValueType> > m_rangeSpace;
+#endif
+    mutable tbb::enumerable_thread_specific<ApplyScratch> m_applyScratch;
+    /** \endcond */
+};
+
+/** \brief Assemble the weak form of a componentwise operator on vector spaces
+ *  from the weak form of a scalar operator.
+ *
+ *  If \p domain and \p dualToRange are SimpleVectorSpace objects with the
+ *  same number of components whose scalar spaces are the domain and the dual
+ *  to range of \p scalarOperator, the weak form of the operator acting as \p
+ *  scalarOperator on each component of functions from \p domain is equal to
+ *  <tt>I (x) A</tt>, with \p A the weak form of \p scalarOperator. In this
+ *  case, the function assembles \p A (or reuses its cached copy) and returns
+ *  a KroneckerDiscreteBoundaryOperator wrapping it, numbering its rows and
+ *  columns as the DOFs of \p dualToRange and \p domain. Otherwise a null
+ *  pointer is returned.
+ *
+ *  This applies, for example, to the identity operator and to the single-layer
+ *  potential boundary operators of the Laplace and Helmholtz equations. */
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType> >
+kroneckerWeakForm(
+        const BoundaryOperator<BasisFunctionType, ResultType>& scalarOperator,
+        const Space<BasisFunctionType>& domain,
+        const Space<BasisFunctionType>& dualToRange);
+
+} // namespace Bempp
+
+#endif
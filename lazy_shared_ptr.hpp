@@ -0,0 +1,129 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef lazy_shared_ptr_hpp
+#define lazy_shared_ptr_hpp
+
+#include "common/common.hpp"
+#include "common/shared_ptr.hpp"
+
+#include <boost/noncopyable.hpp>
+#include <cassert>
+#include <tbb/atomic.h>
+#include <tbb/mutex.h>
+
+namespace Bempp
+{
+
+/** \brief Shared pointer set at most once, read without locking.
+ *
+ *  This class is used to cache objects derived from a space, such as its
+ *  discontinuous counterpart, that are built on first use by const member
+ *  functions possibly called from many threads at a time:
+ *
+ *  \code
+ *  shared_ptr<const T> object = m_cache.get();
+ *  if (!object) {
+ *      LazySharedPtr<const T>::Initializer initializer(m_cache);
+ *      object = initializer.value();
+ *      if (!object)
+ *          object = initializer.publish(buildObject());
+ *  }
+ *  return object;
+ *  \endcode
+ *
+ *  Once the pointer has been published, get() costs a single atomic load and
+ *  never takes a lock. Before that, Initializers lock a mutex for their
+ *  lifetime: the first thread constructing an Initializer becomes the
+ *  builder, and Initializers constructed by other threads block, without
+ *  consuming CPU time, until the builder's Initializer has been destroyed;
+ *  they then return the published pointer from value(), so that the object
+ *  is built only once. If the builder leaves its scope without publishing
+ *  (e.g. because building the object threw an exception), the next waiting
+ *  thread becomes the builder. */
+template <typename T>
+class LazySharedPtr : boost::noncopyable
+{
+public:
+    /** \brief Scoped permission to build the cached object.
+     *
+     *  See the documentation of LazySharedPtr for an example of use. */
+    class Initializer : boost::noncopyable
+    {
+    public:
+        /** \brief Constructor.
+         *
+         *  Block until no other thread holds an Initializer of \p cache. */
+        explicit Initializer(LazySharedPtr& cache) :
+            m_cache(cache), m_lock(cache.m_mutex)
+        {}
+
+        /** \brief Return the pointer published by another thread, or a
+         *  null pointer if the calling thread is the builder. */
+        shared_ptr<T> value() const {
+            return m_cache.get();
+        }
+
+        /** \brief Publish \p value and return it.
+         *
+         *  May only be called by the builder, i.e. if value() has returned a
+         *  null pointer, and only once. */
+        shared_ptr<T> publish(const shared_ptr<T>& value) {
+            assert(!m_cache.m_holder);
+            m_cache.m_holder = new shared_ptr<T>(value);
+            return value;
+        }
+
+    private:
+        /** \cond PRIVATE */
+        LazySharedPtr& m_cache;
+        tbb::mutex::scoped_lock m_lock;
+        /** \endcond */
+    };
+
+    LazySharedPtr() {
+        m_holder = 0;
+    }
+
+    ~LazySharedPtr() {
+        delete static_cast<shared_ptr<T>*>(m_holder);
+    }
+
+    /** \brief Return the published pointer, or a null pointer if none has
+     *  been published yet. */
+    shared_ptr<T> get() const {
+        const shared_ptr<T>* holder = m_holder;
+        return holder ? *holder : shared_ptr<T>();
+    }
+
+private:
+    /** \cond PRIVATE */
+    // Set once from null to a heap-allocated pointer that is never modified
+    // afterwards, with release semantics, so that a thread loading a
+    // non-null value also sees the pointed-to object
+    tbb::atomic<shared_ptr<T>*> m_holder;
+    // Held by the Initializers; never taken by get()
+    tbb::mutex m_mutex;
+    /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
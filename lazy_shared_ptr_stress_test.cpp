@@ -0,0 +1,144 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Stress test of LazySharedPtr. In each round, all threads wait at a
+// barrier and are then released together onto the same fresh cache. The
+// object of each round must be built exactly once and the same pointer must
+// be handed to all threads. Build with -fsanitize=thread to have the
+// accesses checked for data races as well.
+
+#include "lazy_shared_ptr.hpp"
+
+#include <boost/make_shared.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <tbb/atomic.h>
+#include <tbb/tbb_thread.h>
+#include <vector>
+
+namespace
+{
+
+using namespace Bempp;
+
+const size_t ROUND_COUNT = 2000;
+const size_t THREAD_COUNT = 8;
+
+struct StressTestData
+{
+    StressTestData() :
+        buildCounts(ROUND_COUNT), results(ROUND_COUNT * THREAD_COUNT)
+    {
+        for (size_t round = 0; round < ROUND_COUNT; ++round) {
+            caches.push_back(new LazySharedPtr<const size_t>);
+            buildCounts[round] = 0;
+        }
+        arrivedCount = 0;
+    }
+
+    // One fresh cache per round
+    boost::ptr_vector<LazySharedPtr<const size_t> > caches;
+    std::vector<tbb::atomic<size_t> > buildCounts;
+    // Object obtained by thread t in round r is stored at index
+    // r * THREAD_COUNT + t
+    std::vector<shared_ptr<const size_t> > results;
+    // Number of threads that have reached the start barrier, summed over
+    // all rounds
+    tbb::atomic<size_t> arrivedCount;
+};
+
+shared_ptr<const size_t> cachedValue(StressTestData& data, size_t round)
+{
+    LazySharedPtr<const size_t>& cache = data.caches[round];
+    shared_ptr<const size_t> value = cache.get();
+    if (!value) {
+        LazySharedPtr<const size_t>::Initializer initializer(cache);
+        value = initializer.value();
+        if (!value) {
+            ++data.buildCounts[round];
+            // Building a real object takes time; give the other threads a
+            // chance to arrive at the Initializer meanwhile, even on a
+            // single core
+            tbb::this_tbb_thread::yield();
+            value = initializer.publish(boost::make_shared<size_t>(round));
+        }
+    }
+    return value;
+}
+
+class StressTestThread
+{
+public:
+    StressTestThread(StressTestData& data, size_t threadIndex) :
+        m_data(data), m_threadIndex(threadIndex)
+    {}
+
+    void operator() () const {
+        for (size_t round = 0; round < ROUND_COUNT; ++round) {
+            // Start barrier: spin until all threads have arrived, so that
+            // they request the object of this round at the same time
+            ++m_data.arrivedCount;
+            const size_t target = (round + 1) * THREAD_COUNT;
+            while (m_data.arrivedCount < target)
+                tbb::this_tbb_thread::yield();
+            m_data.results[round * THREAD_COUNT + m_threadIndex] =
+                cachedValue(m_data, round);
+        }
+    }
+
+private:
+    StressTestData& m_data;
+    size_t m_threadIndex;
+};
+
+} // namespace
+
+int main()
+{
+    StressTestData data;
+    {
+        boost::ptr_vector<tbb::tbb_thread> threads;
+        for (size_t t = 0; t < THREAD_COUNT; ++t)
+            threads.push_back(new tbb::tbb_thread(StressTestThread(data, t)));
+        for (size_t t = 0; t < THREAD_COUNT; ++t)
+            threads[t].join();
+    }
+
+    bool ok = true;
+    for (size_t round = 0; round < ROUND_COUNT; ++round) {
+        if (data.buildCounts[round] != 1) {
+            std::cerr << "Round " << round << ": expected 1 build, got "
+                      << data.buildCounts[round] << std::endl;
+            ok = false;
+        }
+        for (size_t t = 0; t < THREAD_COUNT; ++t) {
+            const shared_ptr<const size_t>& result =
+                data.results[round * THREAD_COUNT + t];
+            if (!result || *result != round ||
+                    result != data.caches[round].get()) {
+                std::cerr << "Round " << round << ": thread " << t
+                          << " received a wrong object" << std::endl;
+                ok = false;
+            }
+        }
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,144 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "local_dof_table.hpp"
+
+#include "common/acc.hpp"
+#include "fiber/explicit_instantiation.hpp"
+#include "space/space.hpp"
+
+namespace Bempp
+{
+
+template <typename BasisFunctionType>
+LocalDofTable<BasisFunctionType>::LocalDofTable(
+    const Space<BasisFunctionType>& scalarSpace, int codomainDim,
+    DofOrdering ordering) :
+    m_codomainDim(codomainDim),
+    m_globalNumbering(ordering, codomainDim, scalarSpace.globalDofCount()),
+    m_flatLocalNumbering(ordering, codomainDim, scalarSpace.flatLocalDofCount())
+{
+    const size_t globalDofCount = scalarSpace.globalDofCount();
+    std::vector<GlobalDofIndex> globalDofs(globalDofCount);
+    for (size_t i = 0; i < globalDofCount; ++i)
+        acc(globalDofs, i) = i;
+    std::vector<std::vector<LocalDof> > localDofs;
+    std::vector<std::vector<BasisFunctionType> > localDofWeights;
+    scalarSpace.global2localDofs(globalDofs, localDofs, localDofWeights);
+
+    m_globalOffsets.resize(globalDofCount + 1);
+    m_globalOffsets[0] = 0;
+    for (size_t i = 0; i < globalDofCount; ++i)
+        acc(m_globalOffsets, i + 1) =
+            acc(m_globalOffsets, i) + acc(localDofs, i).size();
+    m_globalLocalDofs.reserve(m_globalOffsets.back());
+    m_globalWeights.reserve(m_globalOffsets.back());
+    for (size_t i = 0; i < globalDofCount; ++i) {
+        m_globalLocalDofs.insert(m_globalLocalDofs.end(),
+                                 acc(localDofs, i).begin(),
+                                 acc(localDofs, i).end());
+        m_globalWeights.insert(m_globalWeights.end(),
+                               acc(localDofWeights, i).begin(),
+                               acc(localDofWeights, i).end());
+    }
+
+    const size_t flatLocalDofCount = scalarSpace.flatLocalDofCount();
+    std::vector<FlatLocalDofIndex> flatLocalDofs(flatLocalDofCount);
+    for (size_t i = 0; i < flatLocalDofCount; ++i)
+        acc(flatLocalDofs, i) = i;
+    scalarSpace.flatLocal2localDofs(flatLocalDofs, m_flatLocalDofs);
+}
+
+template <typename BasisFunctionType>
+void LocalDofTable<BasisFunctionType>::global2localDofs(
+    const GlobalDofIndex* globalDofs, size_t globalDofCount,
+    std::vector<size_t>& offsets,
+    std::vector<LocalDof>& localDofs,
+    std::vector<BasisFunctionType>& localDofWeights) const
+{
+    offsets.resize(globalDofCount + 1);
+    offsets[0] = 0;
+    for (size_t i = 0; i < globalDofCount; ++i)
+        offsets[i + 1] = offsets[i] + localDofCount(globalDofs[i]);
+    localDofs.resize(offsets.back());
+    localDofWeights.resize(offsets.back());
+
+    size_t k = 0;
+    for (size_t i = 0; i < globalDofCount; ++i) {
+        const size_t scalarDof = m_globalNumbering.scalarDof(globalDofs[i]);
+        const int component = m_globalNumbering.component(globalDofs[i]);
+        for (size_t j = acc(m_globalOffsets, scalarDof);
+             j < acc(m_globalOffsets, scalarDof + 1); ++j, ++k) {
+            localDofs[k].entityIndex = acc(m_globalLocalDofs, j).entityIndex;
+            localDofs[k].dofIndex =
+                acc(m_globalLocalDofs, j).dofIndex * m_codomainDim + component;
+            localDofWeights[k] = acc(m_globalWeights, j);
+        }
+    }
+}
+
+template <typename BasisFunctionType>
+void LocalDofTable<BasisFunctionType>::global2localDofs(
+    const std::vector<GlobalDofIndex>& globalDofs,
+    std::vector<std::vector<LocalDof> >& localDofs,
+    std::vector<std::vector<BasisFunctionType> >& localDofWeights) const
+{
+    const size_t globalDofCount = globalDofs.size();
+    localDofs.resize(globalDofCount);
+    localDofWeights.resize(globalDofCount);
+    for (size_t i = 0; i < globalDofCount; ++i) {
+        const size_t scalarDof = m_globalNumbering.scalarDof(acc(globalDofs, i));
+        const int component = m_globalNumbering.component(acc(globalDofs, i));
+        const size_t begin = acc(m_globalOffsets, scalarDof);
+        const size_t end = acc(m_globalOffsets, scalarDof + 1);
+        // Overwrite the inner vectors in place so that their capacity is
+        // reused when the caller passes the same vectors again
+        std::vector<LocalDof>& dofs = acc(localDofs, i);
+        std::vector<BasisFunctionType>& weights = acc(localDofWeights, i);
+        dofs.resize(end - begin);
+        weights.resize(end - begin);
+        for (size_t j = begin; j < end; ++j) {
+            dofs[j - begin].entityIndex = acc(m_globalLocalDofs, j).entityIndex;
+            dofs[j - begin].dofIndex =
+                acc(m_globalLocalDofs, j).dofIndex * m_codomainDim + component;
+            weights[j - begin] = acc(m_globalWeights, j);
+        }
+    }
+}
+
+template <typename BasisFunctionType>
+void LocalDofTable<BasisFunctionType>::flatLocal2localDofs(
+    const FlatLocalDofIndex* flatLocalDofs, size_t flatLocalDofCount,
+    LocalDof* localDofs) const
+{
+    for (size_t i = 0; i < flatLocalDofCount; ++i) {
+        const LocalDof& scalarLocalDof = acc(
+            m_flatLocalDofs, m_flatLocalNumbering.scalarDof(flatLocalDofs[i]));
+        localDofs[i].entityIndex = scalarLocalDof.entityIndex;
+        localDofs[i].dofIndex = scalarLocalDof.dofIndex * m_codomainDim +
+            m_flatLocalNumbering.component(flatLocalDofs[i]);
+    }
+}
+
+#define INSTANTIATE_LOCAL_DOF_TABLE(BASIS) \
+    template class LocalDofTable< BASIS >;
+FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_LOCAL_DOF_TABLE);
+
+} // namespace Bempp
@@ -0,0 +1,107 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef local_dof_table_hpp
+#define local_dof_table_hpp
+
+#include "dof_ordering.hpp"
+
+#include "common/common.hpp"
+#include "common/types.hpp"
+
+#include <boost/noncopyable.hpp>
+#include <vector>
+
+namespace Bempp
+{
+
+template <typename BasisFunctionType> class Space;
+
+/** \brief Global-to-local and flat-local-to-local DOF maps of a
+ *  SimpleVectorSpace.
+ *
+ *  The maps of the underlying scalar space are queried once, on
+ *  construction, and stored in flat arrays; the maps of the vector space are
+ *  derived from them on the fly. Global and flat local DOFs of the vector
+ *  space are numbered according to \p ordering (see DofOrdering). The
+ *  <tt>d</tt>th component of the local DOF \p j of an element is the local
+ *  DOF <tt>j * codomainDim + d</tt>, irrespective of \p ordering. */
+template <typename BasisFunctionType>
+class LocalDofTable : boost::noncopyable
+{
+public:
+    LocalDofTable(const Space<BasisFunctionType>& scalarSpace, int codomainDim,
+                  DofOrdering ordering = INTERLEAVED_DOFS);
+
+    /** \brief Number of local DOFs corresponding to the global DOF \p
+     *  globalDof. */
+    size_t localDofCount(GlobalDofIndex globalDof) const {
+        const size_t scalarDof = m_globalNumbering.scalarDof(globalDof);
+        return m_globalOffsets[scalarDof + 1] - m_globalOffsets[scalarDof];
+    }
+
+    /** \brief Map global DOFs to local DOFs.
+     *
+     *  The local DOFs corresponding to <tt>globalDofs[i]</tt> and their
+     *  weights are stored at positions <tt>offsets[i]</tt>, ...,
+     *  <tt>offsets[i + 1] - 1</tt> of \p localDofs and \p localDofWeights.
+     *  The output vectors are resized as needed; if the caller reuses them,
+     *  no memory is allocated once they have grown large enough. */
+    void global2localDofs(
+            const GlobalDofIndex* globalDofs, size_t globalDofCount,
+            std::vector<size_t>& offsets,
+            std::vector<LocalDof>& localDofs,
+            std::vector<BasisFunctionType>& localDofWeights) const;
+
+    /** \brief Map global DOFs to local DOFs (format used by Space).
+     *
+     *  This format needs one vector per global DOF; the inner vectors are
+     *  overwritten in place, so memory is allocated only for global DOFs
+     *  whose vectors have not grown large enough in a previous call. Code
+     *  that needs the maps of many DOFs should use the overload above. */
+    void global2localDofs(
+            const std::vector<GlobalDofIndex>& globalDofs,
+            std::vector<std::vector<LocalDof> >& localDofs,
+            std::vector<std::vector<BasisFunctionType> >& localDofWeights) const;
+
+    /** \brief Map the \p flatLocalDofCount flat local DOFs pointed to by \p
+     *  flatLocalDofs to local DOFs, stored in the array \p localDofs. */
+    void flatLocal2localDofs(
+            const FlatLocalDofIndex* flatLocalDofs, size_t flatLocalDofCount,
+            LocalDof* localDofs) const;
+
+private:
+    /** \cond PRIVATE */
+    int m_codomainDim;
+    VectorDofNumbering m_globalNumbering;
+    VectorDofNumbering m_flatLocalNumbering;
+    // Local DOFs of the scalar global DOF i and their weights are stored at
+    // positions m_globalOffsets[i], ..., m_globalOffsets[i + 1] - 1
+    std::vector<size_t> m_globalOffsets;
+    std::vector<LocalDof> m_globalLocalDofs;
+    std::vector<BasisFunctionType> m_globalWeights;
+    // Local DOF corresponding to each scalar flat local DOF
+    std::vector<LocalDof> m_flatLocalDofs;
+    /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,94 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef parallel_options_hpp
+#define parallel_options_hpp
+
+#include "fiber/parallelization_options.hpp"
+
+#include <tbb/parallel_invoke.h>
+#include <tbb/task_scheduler_init.h>
+#include <tbb/tbb_stddef.h>
+
+namespace Bempp
+{
+
+/** \brief Return the number of threads to be passed to the constructor of
+ *  tbb::task_scheduler_init to comply with \p parallelOptions.
+ *
+ *  If OpenCL is enabled, the CPU work is done in a single thread. */
+inline int maxThreadCountOf(const Fiber::ParallelizationOptions& parallelOptions)
+{
+    if (parallelOptions.isOpenClEnabled())
+        return 1;
+    if (parallelOptions.maxThreadCount() == Fiber::ParallelizationOptions::AUTO)
+        return tbb::task_scheduler_init::automatic;
+    return parallelOptions.maxThreadCount();
+}
+
+template <typename Range, typename Body>
+void deterministicParallelReduce(Range range, Body& body);
+
+/** \cond PRIVATE */
+template <typename Range, typename Body>
+class DeterministicReduceHalf
+{
+public:
+    DeterministicReduceHalf(Range& range, Body& body) :
+        m_range(range), m_body(body)
+    {}
+
+    void operator() () const {
+        deterministicParallelReduce(m_range, m_body);
+    }
+
+private:
+    Range& m_range;
+    Body& m_body;
+};
+/** \endcond */
+
+/** \brief Reduce \p range in parallel with \p body in a reproducible
+ *  order.
+ *
+ *  \p Body must satisfy the requirements of tbb::parallel_reduce. Unlike
+ *  tbb::parallel_reduce, which splits ranges and bodies depending on the
+ *  scheduling, this function always splits \p range in halves down to its
+ *  grain size, applies a fresh body to each half and joins each left body
+ *  with its right neighbour. Floating-point results are thus the same for
+ *  any number of threads. */
+template <typename Range, typename Body>
+void deterministicParallelReduce(Range range, Body& body)
+{
+    if (!range.is_divisible()) {
+        if (!range.empty())
+            body(range);
+        return;
+    }
+    Range rightRange(range, tbb::split());
+    Body rightBody(body, tbb::split());
+    tbb::parallel_invoke(DeterministicReduceHalf<Range, Body>(range, body),
+                         DeterministicReduceHalf<Range, Body>(rightRange, rightBody));
+    body.join(rightBody);
+}
+
+} // namespace Bempp
+
+#endif
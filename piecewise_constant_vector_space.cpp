@@ -27,15 +27,18 @@
 #include "fiber/explicit_instantiation.hpp"
 
 #include <boost/make_shared.hpp>
+#include <boost/ref.hpp>
 
 namespace Bempp
 {
 
 template <typename BasisFunctionType, int codomainDim>
 PiecewiseConstantVectorSpace<BasisFunctionType, codomainDim>::PiecewiseConstantVectorSpace(
-    const shared_ptr<const Grid>& grid) :
+    const shared_ptr<const Grid>& grid,
+    DofOrdering ordering) :
     SimpleVectorSpace<BasisFunctionType, codomainDim>( 
-        boost::make_shared<PiecewiseConstantScalarSpace<BasisFunctionType> >(grid)),
+        boost::make_shared<PiecewiseConstantScalarSpace<BasisFunctionType> >(grid),
+        ordering),
     m_shapeset(
         boost::make_shared<Fiber::SimpleVectorShapeset<BasisFunctionType, codomainDim> >(
             boost::make_shared<Fiber::ConstantScalarShapeset<BasisFunctionType> >()))
@@ -45,9 +48,13 @@ PiecewiseConstantVectorSpace<BasisFunctionType, codomainDim>::PiecewiseConstantV
 template <typename BasisFunctionType, int codomainDim>
 PiecewiseConstantVectorSpace<BasisFunctionType, codomainDim>::PiecewiseConstantVectorSpace(
     const shared_ptr<const Grid>& grid,
-    const GridSegment& segment) :
+    const GridSegment& segment,
+    DofOrdering ordering) :
     SimpleVectorSpace<BasisFunctionType, codomainDim>( 
-        boost::make_shared<PiecewiseConstantScalarSpace<BasisFunctionType> >(grid, segment)),
+        boost::make_shared<PiecewiseConstantScalarSpace<BasisFunctionType> >(grid, segment),
+        boost::make_shared<GridSegmentElementList>(boost::cref(*grid),
+                                                   boost::cref(segment)),
+        ordering),
     m_shapeset(
         boost::make_shared<Fiber::SimpleVectorShapeset<BasisFunctionType, codomainDim> >(
             boost::make_shared<Fiber::ConstantScalarShapeset<BasisFunctionType> >()))
@@ -74,6 +81,15 @@ PiecewiseConstantVectorSpace<BasisFunctionType, codomainDim>::shapeset(
     return *m_shapeset;
 }
 
+template <typename BasisFunctionType, int codomainDim>
+const Fiber::Shapeset<BasisFunctionType>*
+PiecewiseConstantVectorSpace<BasisFunctionType, codomainDim>::scalarShapeset(
+    size_t elementIndex) const
+{
+    return &static_cast<const Fiber::SimpleVectorShapeset<BasisFunctionType, codomainDim>&>(
+        *m_shapeset).scalarShapeset();
+}
+
 template <typename BasisFunctionType, int codomainDim>
 shared_ptr<const Space<BasisFunctionType> > 
 PiecewiseConstantVectorSpace<BasisFunctionType, codomainDim>::barycentricSpace(
@@ -99,11 +115,15 @@ PiecewiseConstantVectorSpace<BasisFunctionType, codomainDim>::spaceIsCompatible(
     const Space<BasisFunctionType>& other) const
 {
     return other.grid().get() == this->grid().get() && 
-        other.spaceIdentifier() == this->spaceIdentifier();
+        other.spaceIdentifier() == this->spaceIdentifier() &&
+        dofOrderingOf(other) == this->dofOrdering();
 }
 
+#define INSTANTIATE_PIECEWISE_CONSTANT_VECTOR_SPACE_WITH_DIM(BASIS, DIM) \
+    template class PiecewiseConstantVectorSpace< BASIS, DIM >
 #define INSTANTIATE_PIECEWISE_CONSTANT_VECTOR_SPACE(BASIS) \
-    template class PiecewiseConstantVectorSpace< BASIS, 3 >;
+    SIMPLE_VECTOR_SPACE_ITERATE_OVER_CODOMAIN_DIMS( \
+        INSTANTIATE_PIECEWISE_CONSTANT_VECTOR_SPACE_WITH_DIM, BASIS)
 FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_PIECEWISE_CONSTANT_VECTOR_SPACE);
 
 } // namespace Bempp
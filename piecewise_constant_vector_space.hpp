@@ -39,11 +39,13 @@ public:
     /** \brief Constructor.
      *
      *  Construct a space of piecewise constant vector functions with \p codomainDim
-     *  components defined on the grid \p grid.
+     *  components defined on the grid \p grid. The DOFs are numbered
+     *  according to \p ordering.
      *
      *  An exception is thrown if \p grid is a null pointer.
      */
-    explicit PiecewiseConstantVectorSpace(const shared_ptr<const Grid>& grid);
+    explicit PiecewiseConstantVectorSpace(const shared_ptr<const Grid>& grid,
+                                          DofOrdering ordering = INTERLEAVED_DOFS);
 
     /** \brief Constructor.
      *
@@ -54,7 +56,8 @@ public:
      *  An exception is thrown if \p grid is a null pointer.
      */
     PiecewiseConstantVectorSpace(const shared_ptr<const Grid>& grid,
-                                 const GridSegment& segment);
+                                 const GridSegment& segment,
+                                 DofOrdering ordering = INTERLEAVED_DOFS);
 
     virtual shared_ptr<const Space<BasisFunctionType> > discontinuousSpace(
         const shared_ptr<const Space<BasisFunctionType> >& self) const;
@@ -62,6 +65,9 @@ public:
     virtual const Fiber::Shapeset<BasisFunctionType>& shapeset(
         const Entity<0>& element) const;
 
+    virtual const Fiber::Shapeset<BasisFunctionType>* scalarShapeset(
+        size_t elementIndex) const;
+
     virtual shared_ptr<const Space<BasisFunctionType> > barycentricSpace(
         const shared_ptr<const Space<BasisFunctionType> >& self) const;
 
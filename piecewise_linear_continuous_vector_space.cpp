@@ -22,21 +22,25 @@
 
 #include "simple_vector_shapeset.hpp"
 
+#include "dof_transfer_operator.hpp"
 #include "piecewise_linear_discontinuous_vector_space.hpp"
 
 #include "space/piecewise_linear_continuous_scalar_space.hpp"
 #include "fiber/explicit_instantiation.hpp"
 
 #include <boost/make_shared.hpp>
+#include <boost/ref.hpp>
 
 namespace Bempp
 {
 
 template <typename BasisFunctionType, int codomainDim>
 PiecewiseLinearContinuousVectorSpace<BasisFunctionType, codomainDim>::PiecewiseLinearContinuousVectorSpace(
-    const shared_ptr<const Grid>& grid) :
+    const shared_ptr<const Grid>& grid,
+    DofOrdering ordering) :
     PiecewiseLinearVectorSpace<BasisFunctionType, codomainDim>( 
-        boost::make_shared<PiecewiseLinearContinuousScalarSpace<BasisFunctionType> >(grid)),
+        boost::make_shared<PiecewiseLinearContinuousScalarSpace<BasisFunctionType> >(grid),
+        ordering),
     m_segment(GridSegment::wholeGrid(*grid)),
     m_strictlyOnSegment(false)
 {
@@ -46,10 +50,16 @@ template <typename BasisFunctionType, int codomainDim>
 PiecewiseLinearContinuousVectorSpace<BasisFunctionType, codomainDim>::PiecewiseLinearContinuousVectorSpace(
     const shared_ptr<const Grid>& grid,
     const GridSegment& segment,
-    bool strictlyOnSegment) :
+    bool strictlyOnSegment,
+    DofOrdering ordering) :
     PiecewiseLinearVectorSpace<BasisFunctionType, codomainDim>( 
         boost::make_shared<PiecewiseLinearContinuousScalarSpace<BasisFunctionType> >(
-            grid, segment, strictlyOnSegment)),
+            grid, segment, strictlyOnSegment),
+        strictlyOnSegment ?
+            boost::make_shared<GridSegmentElementList>(boost::cref(*grid),
+                                                       boost::cref(segment)) :
+            shared_ptr<GridSegmentElementList>(),
+        ordering),
     m_segment(segment),
     m_strictlyOnSegment(strictlyOnSegment)
 {
@@ -65,16 +75,20 @@ shared_ptr<const Space<BasisFunctionType> >
 PiecewiseLinearContinuousVectorSpace<BasisFunctionType, codomainDim>::discontinuousSpace(
     const shared_ptr<const Space<BasisFunctionType> >& self) const
 {
-    if (!m_discontinuousSpace) {
-        tbb::mutex::scoped_lock lock(m_discontinuousSpaceMutex);
-        typedef PiecewiseLinearDiscontinuousVectorSpace<BasisFunctionType, codomainDim>
-                DiscontinuousSpace;
-        if (!m_discontinuousSpace)
-            m_discontinuousSpace.reset(
-                        new DiscontinuousSpace(this->grid(), m_segment,
-                                               m_strictlyOnSegment));
+    typedef PiecewiseLinearDiscontinuousVectorSpace<BasisFunctionType, codomainDim>
+            DiscontinuousSpace;
+    shared_ptr<const Space<BasisFunctionType> > space = m_discontinuousSpace.get();
+    if (!space) {
+        typename LazySharedPtr<const Space<BasisFunctionType> >::Initializer
+                initializer(m_discontinuousSpace);
+        space = initializer.value();
+        if (!space)
+            space = initializer.publish(
+                        boost::make_shared<DiscontinuousSpace>(
+                            this->grid(), m_segment, m_strictlyOnSegment,
+                            this->dofOrdering()));
     }
-    return m_discontinuousSpace;
+    return space;
 }
 
 template <typename BasisFunctionType, int codomainDim>
@@ -102,11 +116,64 @@ PiecewiseLinearContinuousVectorSpace<BasisFunctionType, codomainDim>::spaceIsCom
     const Space<BasisFunctionType>& other) const
 {
     return other.grid().get() == this->grid().get() && 
-        other.spaceIdentifier() == this->spaceIdentifier();
+        other.spaceIdentifier() == this->spaceIdentifier() &&
+        dofOrderingOf(other) == this->dofOrdering();
+}
+
+template <typename BasisFunctionType, int codomainDim>
+const SimpleVectorSpaceBase<BasisFunctionType>&
+PiecewiseLinearContinuousVectorSpace<BasisFunctionType, codomainDim>::
+discontinuousVectorSpace() const
+{
+    typedef PiecewiseLinearDiscontinuousVectorSpace<BasisFunctionType, codomainDim>
+            DiscontinuousSpace;
+    return static_cast<const DiscontinuousSpace&>(
+        *discontinuousSpace(shared_ptr<const Space<BasisFunctionType> >()));
+}
+
+template <typename BasisFunctionType, int codomainDim>
+shared_ptr<const DofTransferOperator<BasisFunctionType> >
+PiecewiseLinearContinuousVectorSpace<BasisFunctionType, codomainDim>::
+prolongationToDiscontinuousSpace() const
+{
+    shared_ptr<const DofTransferOperator<BasisFunctionType> > prolongation =
+        m_prolongation.get();
+    if (!prolongation) {
+        typename LazySharedPtr<const DofTransferOperator<BasisFunctionType> >::
+                Initializer initializer(m_prolongation);
+        prolongation = initializer.value();
+        if (!prolongation)
+            prolongation = initializer.publish(
+                        continuousToDiscontinuousOperator(
+                            *this, discontinuousVectorSpace()));
+    }
+    return prolongation;
+}
+
+template <typename BasisFunctionType, int codomainDim>
+shared_ptr<const DofTransferOperator<BasisFunctionType> >
+PiecewiseLinearContinuousVectorSpace<BasisFunctionType, codomainDim>::
+restrictionFromDiscontinuousSpace() const
+{
+    shared_ptr<const DofTransferOperator<BasisFunctionType> > restriction =
+        m_restriction.get();
+    if (!restriction) {
+        typename LazySharedPtr<const DofTransferOperator<BasisFunctionType> >::
+                Initializer initializer(m_restriction);
+        restriction = initializer.value();
+        if (!restriction)
+            restriction = initializer.publish(
+                        discontinuousToContinuousOperator(
+                            discontinuousVectorSpace(), *this));
+    }
+    return restriction;
 }
 
+#define INSTANTIATE_PIECEWISE_LINEAR_CONTINUOUS_VECTOR_SPACE_WITH_DIM(BASIS, DIM) \
+    template class PiecewiseLinearContinuousVectorSpace< BASIS, DIM >
 #define INSTANTIATE_PIECEWISE_LINEAR_CONTINUOUS_VECTOR_SPACE(BASIS) \
-    template class PiecewiseLinearContinuousVectorSpace< BASIS, 3 >;
+    SIMPLE_VECTOR_SPACE_ITERATE_OVER_CODOMAIN_DIMS( \
+        INSTANTIATE_PIECEWISE_LINEAR_CONTINUOUS_VECTOR_SPACE_WITH_DIM, BASIS)
 FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_PIECEWISE_LINEAR_CONTINUOUS_VECTOR_SPACE);
 
 } // namespace Bempp
@@ -21,12 +21,12 @@
 #ifndef piecewise_linear_continuous_vector_space_hpp
 #define piecewise_linear_continuous_vector_space_hpp
 
+#include "lazy_shared_ptr.hpp"
 #include "piecewise_linear_vector_space.hpp"
 
 #include "grid/grid_segment.hpp"
 
 #include <memory>
-#include <tbb/mutex.h>
 
 namespace Bempp
 {
@@ -45,11 +45,13 @@ public:
     /** \brief Constructor.
      *
      *  Construct a space of piecewise linear, continuous vector functions with
-     *  \p codomainDim components defined on the grid \p grid.
+     *  \p codomainDim components defined on the grid \p grid. The DOFs are
+     *  numbered according to \p ordering.
      *
      *  An exception is thrown if \p grid is a null pointer.
      */
-    explicit PiecewiseLinearContinuousVectorSpace(const shared_ptr<const Grid>& grid);
+    explicit PiecewiseLinearContinuousVectorSpace(const shared_ptr<const Grid>& grid,
+                                                  DofOrdering ordering = INTERLEAVED_DOFS);
 
     /** \brief Constructor.
      *
@@ -67,7 +69,8 @@ public:
      */
     PiecewiseLinearContinuousVectorSpace(const shared_ptr<const Grid>& grid,
                                          const GridSegment& segment,
-                                         bool strictlyOnSegment = false);
+                                         bool strictlyOnSegment = false,
+                                         DofOrdering ordering = INTERLEAVED_DOFS);
 
     virtual ~PiecewiseLinearContinuousVectorSpace();
 
@@ -81,12 +84,31 @@ public:
 
     virtual bool spaceIsCompatible(const Space<BasisFunctionType>& other) const;
 
+    /** \brief Operator mapping functions from this space to the same
+     *  functions expressed in the basis of discontinuousSpace().
+     *
+     *  See continuousToDiscontinuousOperator(). The operator is built on
+     *  first use and cached. */
+    shared_ptr<const DofTransferOperator<BasisFunctionType> >
+    prolongationToDiscontinuousSpace() const;
+
+    /** \brief Operator mapping functions from discontinuousSpace() to this
+     *  space by averaging the coefficients attached to each vertex.
+     *
+     *  See discontinuousToContinuousOperator(). The operator is built on
+     *  first use and cached. */
+    shared_ptr<const DofTransferOperator<BasisFunctionType> >
+    restrictionFromDiscontinuousSpace() const;
+
 private:
     /** \cond PRIVATE */
+    const SimpleVectorSpaceBase<BasisFunctionType>& discontinuousVectorSpace() const;
+
     GridSegment m_segment;
     bool m_strictlyOnSegment;
-    mutable shared_ptr<Space<BasisFunctionType> > m_discontinuousSpace;
-    mutable tbb::mutex m_discontinuousSpaceMutex;
+    mutable LazySharedPtr<const Space<BasisFunctionType> > m_discontinuousSpace;
+    mutable LazySharedPtr<const DofTransferOperator<BasisFunctionType> > m_prolongation;
+    mutable LazySharedPtr<const DofTransferOperator<BasisFunctionType> > m_restriction;
     /** \endcond */
 };
 
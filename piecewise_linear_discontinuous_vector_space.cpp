@@ -26,15 +26,18 @@
 #include "fiber/explicit_instantiation.hpp"
 
 #include <boost/make_shared.hpp>
+#include <boost/ref.hpp>
 
 namespace Bempp
 {
 
 template <typename BasisFunctionType, int codomainDim>
 PiecewiseLinearDiscontinuousVectorSpace<BasisFunctionType, codomainDim>::PiecewiseLinearDiscontinuousVectorSpace(
-    const shared_ptr<const Grid>& grid) :
+    const shared_ptr<const Grid>& grid,
+    DofOrdering ordering) :
     PiecewiseLinearVectorSpace<BasisFunctionType, codomainDim>( 
-        boost::make_shared<PiecewiseLinearDiscontinuousScalarSpace<BasisFunctionType> >(grid)),
+        boost::make_shared<PiecewiseLinearDiscontinuousScalarSpace<BasisFunctionType> >(grid),
+        ordering),
     m_segment(GridSegment::wholeGrid(*grid)),
     m_strictlyOnSegment(false)
 {
@@ -44,10 +47,16 @@ template <typename BasisFunctionType, int codomainDim>
 PiecewiseLinearDiscontinuousVectorSpace<BasisFunctionType, codomainDim>::PiecewiseLinearDiscontinuousVectorSpace(
     const shared_ptr<const Grid>& grid,
     const GridSegment& segment,
-    bool strictlyOnSegment) :
+    bool strictlyOnSegment,
+    DofOrdering ordering) :
     PiecewiseLinearVectorSpace<BasisFunctionType, codomainDim>( 
         boost::make_shared<PiecewiseLinearDiscontinuousScalarSpace<BasisFunctionType> >(
-            grid, segment, strictlyOnSegment)),
+            grid, segment, strictlyOnSegment),
+        strictlyOnSegment ?
+            boost::make_shared<GridSegmentElementList>(boost::cref(*grid),
+                                                       boost::cref(segment)) :
+            shared_ptr<GridSegmentElementList>(),
+        ordering),
     m_segment(segment),
     m_strictlyOnSegment(strictlyOnSegment)
 {
@@ -90,11 +99,15 @@ PiecewiseLinearDiscontinuousVectorSpace<BasisFunctionType, codomainDim>::spaceIs
     const Space<BasisFunctionType>& other) const
 {
     return other.grid().get() == this->grid().get() && 
-        other.spaceIdentifier() == this->spaceIdentifier();
+        other.spaceIdentifier() == this->spaceIdentifier() &&
+        dofOrderingOf(other) == this->dofOrdering();
 }
 
+#define INSTANTIATE_PIECEWISE_LINEAR_DISCONTINUOUS_VECTOR_SPACE_WITH_DIM(BASIS, DIM) \
+    template class PiecewiseLinearDiscontinuousVectorSpace< BASIS, DIM >
 #define INSTANTIATE_PIECEWISE_LINEAR_DISCONTINUOUS_VECTOR_SPACE(BASIS) \
-    template class PiecewiseLinearDiscontinuousVectorSpace< BASIS, 3 >;
+    SIMPLE_VECTOR_SPACE_ITERATE_OVER_CODOMAIN_DIMS( \
+        INSTANTIATE_PIECEWISE_LINEAR_DISCONTINUOUS_VECTOR_SPACE_WITH_DIM, BASIS)
 FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_PIECEWISE_LINEAR_DISCONTINUOUS_VECTOR_SPACE);
 
 } // namespace Bempp
@@ -26,7 +26,6 @@
 #include "grid/grid_segment.hpp"
 
 #include <memory>
-#include <tbb/mutex.h>
 
 namespace Bempp
 {
@@ -45,11 +44,13 @@ public:
     /** \brief Constructor.
      *
      *  Construct a space of piecewise linear, discontinuous vector functions with
-     *  \p codomainDim components defined on the grid \p grid.
+     *  \p codomainDim components defined on the grid \p grid. The DOFs are
+     *  numbered according to \p ordering.
      *
      *  An exception is thrown if \p grid is a null pointer.
      */
-    explicit PiecewiseLinearDiscontinuousVectorSpace(const shared_ptr<const Grid>& grid);
+    explicit PiecewiseLinearDiscontinuousVectorSpace(const shared_ptr<const Grid>& grid,
+                                                     DofOrdering ordering = INTERLEAVED_DOFS);
 
     /** \brief Constructor.
      *
@@ -68,7 +69,8 @@ public:
      */
     PiecewiseLinearDiscontinuousVectorSpace(const shared_ptr<const Grid>& grid,
                                          const GridSegment& segment,
-                                         bool strictlyOnSegment = false);
+                                         bool strictlyOnSegment = false,
+                                         DofOrdering ordering = INTERLEAVED_DOFS);
 
     virtual shared_ptr<const Space<BasisFunctionType> > discontinuousSpace(
         const shared_ptr<const Space<BasisFunctionType> >& self) const;
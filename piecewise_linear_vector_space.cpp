@@ -23,18 +23,26 @@
 #include "simple_vector_shapeset.hpp"
 
 #include "space/piecewise_linear_scalar_space.hpp"
+#include "common/acc.hpp"
 #include "fiber/linear_scalar_shapeset.hpp"
 #include "fiber/explicit_instantiation.hpp"
+#include "grid/entity.hpp"
+#include "grid/entity_iterator.hpp"
+#include "grid/grid.hpp"
+#include "grid/grid_view.hpp"
 
 #include <boost/make_shared.hpp>
+#include <cassert>
+#include <memory>
 
 namespace Bempp
 {
 
 template <typename BasisFunctionType, int codomainDim>
 PiecewiseLinearVectorSpace<BasisFunctionType, codomainDim>::PiecewiseLinearVectorSpace(
-    const shared_ptr<Space<BasisFunctionType> >& scalarSpace) :
-    SimpleVectorSpace<BasisFunctionType, codomainDim>(scalarSpace),
+    const shared_ptr<Space<BasisFunctionType> >& scalarSpace,
+    DofOrdering ordering) :
+    SimpleVectorSpace<BasisFunctionType, codomainDim>(scalarSpace, ordering),
     m_lineShapeset(
         boost::make_shared<Fiber::SimpleVectorShapeset<BasisFunctionType, codomainDim> >(
             boost::make_shared<Fiber::LinearScalarShapeset<2, BasisFunctionType> >())),
@@ -45,29 +53,112 @@ PiecewiseLinearVectorSpace<BasisFunctionType, codomainDim>::PiecewiseLinearVecto
         boost::make_shared<Fiber::SimpleVectorShapeset<BasisFunctionType, codomainDim> >(
             boost::make_shared<Fiber::LinearScalarShapeset<4, BasisFunctionType> >()))
 {
+    initializeShapesetTable();
 }
 
 template <typename BasisFunctionType, int codomainDim>
-const Fiber::Shapeset<BasisFunctionType>& 
-PiecewiseLinearVectorSpace<BasisFunctionType, codomainDim>::shapeset(
-    const Entity<0>& element) const
+PiecewiseLinearVectorSpace<BasisFunctionType, codomainDim>::PiecewiseLinearVectorSpace(
+    const shared_ptr<Space<BasisFunctionType> >& scalarSpace,
+    const shared_ptr<const GridSegmentElementList>& elements,
+    DofOrdering ordering) :
+    SimpleVectorSpace<BasisFunctionType, codomainDim>(scalarSpace, elements, ordering),
+    m_lineShapeset(
+        boost::make_shared<Fiber::SimpleVectorShapeset<BasisFunctionType, codomainDim> >(
+            boost::make_shared<Fiber::LinearScalarShapeset<2, BasisFunctionType> >())),
+    m_triangleShapeset(
+        boost::make_shared<Fiber::SimpleVectorShapeset<BasisFunctionType, codomainDim> >(
+            boost::make_shared<Fiber::LinearScalarShapeset<3, BasisFunctionType> >())),
+    m_quadrilateralShapeset(
+        boost::make_shared<Fiber::SimpleVectorShapeset<BasisFunctionType, codomainDim> >(
+            boost::make_shared<Fiber::LinearScalarShapeset<4, BasisFunctionType> >()))
+{
+    initializeShapesetTable();
+}
+
+template <typename BasisFunctionType, int codomainDim>
+void PiecewiseLinearVectorSpace<BasisFunctionType, codomainDim>::initializeShapesetTable()
+{
+    const ElementDofTable<BasisFunctionType>& dofTable = this->elementDofTable();
+    m_elementShapesets.resize(dofTable.elementCount());
+
+    std::auto_ptr<GridView> view = this->grid()->leafView();
+    std::auto_ptr<EntityIterator<0> > it = view->entityIterator<0>();
+    for (; !it->finished(); it->next()) {
+        const Entity<0>& element = it->entity();
+        acc(m_elementShapesets, dofTable.elementIndex(element)) =
+            shapesetOfVariant(this->elementVariant(element));
+    }
+}
+
+template <typename BasisFunctionType, int codomainDim>
+const Fiber::Shapeset<BasisFunctionType>*
+PiecewiseLinearVectorSpace<BasisFunctionType, codomainDim>::shapesetOfVariant(
+    ElementVariant variant) const
 {
-    switch (this->elementVariant(element))
+    switch (variant)
     {
     case 3:
-        return *m_triangleShapeset;
+        return m_triangleShapeset.get();
     case 4:
-        return *m_quadrilateralShapeset;
+        return m_quadrilateralShapeset.get();
     case 2:
-        return *m_lineShapeset;
+        return m_lineShapeset.get();
     default:
+        return 0;
+    }
+}
+
+template <typename BasisFunctionType, int codomainDim>
+const Fiber::Shapeset<BasisFunctionType>& 
+PiecewiseLinearVectorSpace<BasisFunctionType, codomainDim>::shapeset(
+    const Entity<0>& element) const
+{
+    const Fiber::Shapeset<BasisFunctionType>& result =
+        shapeset(this->elementDofTable().elementIndex(element));
+    // The table is only updated by setElementVariant() of this space; see
+    // the class documentation
+    assert(&result == shapesetOfVariant(this->elementVariant(element)));
+    return result;
+}
+
+template <typename BasisFunctionType, int codomainDim>
+const Fiber::Shapeset<BasisFunctionType>& 
+PiecewiseLinearVectorSpace<BasisFunctionType, codomainDim>::shapeset(
+    size_t elementIndex) const
+{
+    const Fiber::Shapeset<BasisFunctionType>* result =
+        acc(m_elementShapesets, elementIndex);
+    if (!result)
         throw std::logic_error("PiecewiseLinearVectorSpace::shapeset(): "
                                "invalid element variant, this shouldn't happen!");
-    }
+    return *result;
+}
+
+template <typename BasisFunctionType, int codomainDim>
+const Fiber::Shapeset<BasisFunctionType>*
+PiecewiseLinearVectorSpace<BasisFunctionType, codomainDim>::scalarShapeset(
+    size_t elementIndex) const
+{
+    // All shapesets of the table are SimpleVectorShapesets
+    return &static_cast<const Fiber::SimpleVectorShapeset<BasisFunctionType, codomainDim>&>(
+        shapeset(elementIndex)).scalarShapeset();
+}
+
+template <typename BasisFunctionType, int codomainDim>
+void PiecewiseLinearVectorSpace<BasisFunctionType, codomainDim>::setElementVariant(
+    const Entity<0>& element, ElementVariant variant)
+{
+    SimpleVectorSpace<BasisFunctionType, codomainDim>::setElementVariant(
+        element, variant);
+    acc(m_elementShapesets, this->elementDofTable().elementIndex(element)) =
+        shapesetOfVariant(this->elementVariant(element));
 }
 
+#define INSTANTIATE_PIECEWISE_LINEAR_VECTOR_SPACE_WITH_DIM(BASIS, DIM) \
+    template class PiecewiseLinearVectorSpace< BASIS, DIM >
 #define INSTANTIATE_PIECEWISE_LINEAR_VECTOR_SPACE(BASIS) \
-    template class PiecewiseLinearVectorSpace< BASIS, 3 >;
+    SIMPLE_VECTOR_SPACE_ITERATE_OVER_CODOMAIN_DIMS( \
+        INSTANTIATE_PIECEWISE_LINEAR_VECTOR_SPACE_WITH_DIM, BASIS)
 FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_PIECEWISE_LINEAR_VECTOR_SPACE);
 
 } // namespace Bempp
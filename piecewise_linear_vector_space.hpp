@@ -23,27 +23,70 @@
 
 #include "simple_vector_space.hpp"
 
+#include <vector>
+
 namespace Bempp
 {
 
 class GridSegment;
 
+/** \brief Space of vector-valued piecewise linear functions built from a
+ *  scalar space.
+ *
+ *  The shapeset of each element is looked up once, at construction, and
+ *  stored in a table. setElementVariant() of this space updates the table,
+ *  but changing element variants directly through the scalar space passed to
+ *  the constructor does not: shapeset() then keeps returning the shapeset of
+ *  the old variant. In debug builds, shapeset(const Entity<0>&) asserts that
+ *  the table is up to date. */
 template <typename BasisFunctionType, int codomainDim>
 class PiecewiseLinearVectorSpace : public SimpleVectorSpace<BasisFunctionType, codomainDim>
 {
 public:
     typedef typename Space<BasisFunctionType>::CoordinateType CoordinateType;
 
-    explicit PiecewiseLinearVectorSpace(const shared_ptr<Space<BasisFunctionType> > &scalarSpace);
+    explicit PiecewiseLinearVectorSpace(const shared_ptr<Space<BasisFunctionType> > &scalarSpace,
+                                        DofOrdering ordering = INTERLEAVED_DOFS);
+
+    /** \brief Constructor.
+     *
+     *  Construct a space restricted to the elements listed in \p elements;
+     *  see SimpleVectorSpace. */
+    PiecewiseLinearVectorSpace(const shared_ptr<Space<BasisFunctionType> > &scalarSpace,
+                               const shared_ptr<const GridSegmentElementList>& elements,
+                               DofOrdering ordering = INTERLEAVED_DOFS);
 
+    /** \brief Return the shapeset attached to \p element.
+     *
+     *  The shapesets of all elements are stored in a table indexed by
+     *  element indices. */
     virtual const Fiber::Shapeset<BasisFunctionType>& shapeset(
         const Entity<0>& element) const;
 
+    /** \brief Return the shapeset attached to the element with leaf-view
+     *  index \p elementIndex.
+     *
+     *  Unlike shapeset(const Entity<0>&), this overload does not need to look
+     *  up the index of the element. */
+    const Fiber::Shapeset<BasisFunctionType>& shapeset(size_t elementIndex) const;
+
+    virtual const Fiber::Shapeset<BasisFunctionType>* scalarShapeset(
+        size_t elementIndex) const;
+
+    virtual void setElementVariant(const Entity<0>& element, ElementVariant variant);
+
 private:
     /** \cond PRIVATE */
+    void initializeShapesetTable();
+    const Fiber::Shapeset<BasisFunctionType>* shapesetOfVariant(
+        ElementVariant variant) const;
+
     shared_ptr<Fiber::Shapeset<BasisFunctionType> > m_lineShapeset;
     shared_ptr<Fiber::Shapeset<BasisFunctionType> > m_triangleShapeset;
     shared_ptr<Fiber::Shapeset<BasisFunctionType> > m_quadrilateralShapeset;
+    // Shapeset of each element, indexed by element indices; null for
+    // elements with invalid variants
+    std::vector<const Fiber::Shapeset<BasisFunctionType>*> m_elementShapesets;
     /** \endcond*/
 };
 
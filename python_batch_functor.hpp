@@ -0,0 +1,245 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// This header is included only by the SWIG modules. It must be included
+// after <numpy/arrayobject.h>.
+
+#ifndef python_batch_functor_hpp
+#define python_batch_functor_hpp
+
+#include "batch_function.hpp"
+
+#include "common/common.hpp"
+#include "common/scalar_traits.hpp"
+
+#include <Python.h>
+#include <armadillo>
+#include <complex>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace Bempp
+{
+
+/** \cond PRIVATE */
+template <typename T> struct NumpyTypeTraits;
+
+template <> struct NumpyTypeTraits<float>
+{ enum { TYPE = NPY_FLOAT }; };
+
+template <> struct NumpyTypeTraits<double>
+{ enum { TYPE = NPY_DOUBLE }; };
+
+template <> struct NumpyTypeTraits<std::complex<float> >
+{ enum { TYPE = NPY_CFLOAT }; };
+
+template <> struct NumpyTypeTraits<std::complex<double> >
+{ enum { TYPE = NPY_CDOUBLE }; };
+
+// Holds the global interpreter lock for the lifetime of the object
+class ScopedGilAcquisition
+{
+public:
+    ScopedGilAcquisition() : m_state(PyGILState_Ensure())
+    {}
+
+    ~ScopedGilAcquisition() {
+        PyGILState_Release(m_state);
+    }
+
+private:
+    PyGILState_STATE m_state;
+};
+
+// Releases the global interpreter lock held by the calling thread for the
+// lifetime of the object, so that other threads can call into Python
+class ScopedGilRelease
+{
+public:
+    ScopedGilRelease() : m_state(PyEval_SaveThread())
+    {}
+
+    ~ScopedGilRelease() {
+        PyEval_RestoreThread(m_state);
+    }
+
+private:
+    PyThreadState* m_state;
+};
+/** \endcond */
+
+/** \brief Functor calling a Python callable once per batch of points.
+ *
+ *  This class satisfies the requirements of the \p Functor parameter of
+ *  BatchFunction. The callable is invoked as <tt>callable(points,
+ *  normals)</tt>, where \p points and \p normals are NumPy arrays of shape
+ *  <tt>(argumentDimension, n)</tt> holding the global coordinates and the
+ *  normals at the \p n points of a batch (\p normals is None unless \p
+ *  dependsOnNormals is true). It must return an array-like object of shape
+ *  <tt>(resultDimension, n)</tt> whose columns are the function values.
+ *
+ *  evaluate() acquires the global interpreter lock, so it may be called
+ *  from any thread; the thread that starts a parallel loop evaluating the
+ *  functor must therefore release the lock first (see ScopedGilRelease).
+ *  Python exceptions raised by the callable and results of incorrect shape
+ *  are reported by std::runtime_error. */
+template <typename ValueType_>
+class PythonBatchFunctor
+{
+public:
+    typedef ValueType_ ValueType;
+    typedef typename ScalarTraits<ValueType>::RealType CoordinateType;
+
+    /** \brief Constructor.
+     *
+     *  Must be called with the global interpreter lock held. */
+    PythonBatchFunctor(PyObject* callable, int argumentDimension,
+                       int resultDimension, bool dependsOnNormals) :
+        m_callable(callable), m_argumentDimension(argumentDimension),
+        m_resultDimension(resultDimension), m_dependsOnNormals(dependsOnNormals)
+    {
+        if (!PyCallable_Check(callable))
+            throw std::invalid_argument("PythonBatchFunctor::"
+                                        "PythonBatchFunctor(): "
+                                        "callable is not callable");
+        Py_INCREF(m_callable);
+    }
+
+    PythonBatchFunctor(const PythonBatchFunctor& other) :
+        m_callable(other.m_callable),
+        m_argumentDimension(other.m_argumentDimension),
+        m_resultDimension(other.m_resultDimension),
+        m_dependsOnNormals(other.m_dependsOnNormals)
+    {
+        ScopedGilAcquisition gil;
+        Py_INCREF(m_callable);
+    }
+
+    ~PythonBatchFunctor() {
+        ScopedGilAcquisition gil;
+        Py_DECREF(m_callable);
+    }
+
+    int argumentDimension() const {
+        return m_argumentDimension;
+    }
+
+    int resultDimension() const {
+        return m_resultDimension;
+    }
+
+    bool dependsOnNormals() const {
+        return m_dependsOnNormals;
+    }
+
+    void evaluate(const arma::Mat<CoordinateType>& points,
+                  const arma::Mat<CoordinateType>& normals,
+                  arma::Mat<ValueType>& result) const {
+        ScopedGilAcquisition gil;
+        PyObject* pyPoints = toArray(points);
+        PyObject* pyNormals = 0;
+        if (m_dependsOnNormals)
+            pyNormals = toArray(normals);
+        else {
+            pyNormals = Py_None;
+            Py_INCREF(pyNormals);
+        }
+        PyObject* pyResult = 0;
+        if (pyPoints && pyNormals)
+            pyResult = PyObject_CallFunctionObjArgs(
+                m_callable, pyPoints, pyNormals, NULL);
+        Py_XDECREF(pyPoints);
+        Py_XDECREF(pyNormals);
+        if (!pyResult)
+            throwPythonError();
+
+        // Convert the result to a Fortran-ordered array of ValueType, i.e.
+        // to the memory layout of arma::Mat
+        PyArrayObject* array = reinterpret_cast<PyArrayObject*>(
+            PyArray_FROM_OTF(pyResult, NumpyTypeTraits<ValueType>::TYPE,
+                             NPY_ARRAY_F_CONTIGUOUS | NPY_ARRAY_ALIGNED |
+                             NPY_ARRAY_FORCECAST));
+        Py_DECREF(pyResult);
+        if (!array)
+            throwPythonError();
+        const npy_intp* dims = PyArray_DIMS(array);
+        if (PyArray_NDIM(array) != 2 || dims[0] != m_resultDimension ||
+                dims[1] != (npy_intp)points.n_cols) {
+            Py_DECREF(array);
+            throw std::runtime_error("PythonBatchFunctor::evaluate(): "
+                                     "callable must return an array of shape "
+                                     "(resultDimension, pointCount)");
+        }
+        result.set_size(m_resultDimension, points.n_cols);
+        std::memcpy(result.memptr(), PyArray_DATA(array),
+                    result.n_elem * sizeof(ValueType));
+        Py_DECREF(array);
+    }
+
+private:
+    /** \cond PRIVATE */
+    // Return a new Fortran-ordered array holding a copy of matrix; the
+    // callable may keep a reference to it
+    static PyObject* toArray(const arma::Mat<CoordinateType>& matrix) {
+        npy_intp dims[2] = { (npy_intp)matrix.n_rows, (npy_intp)matrix.n_cols };
+        PyObject* array = PyArray_New(
+            &PyArray_Type, 2, dims, NumpyTypeTraits<CoordinateType>::TYPE,
+            NULL, NULL, 0, NPY_ARRAY_F_CONTIGUOUS, NULL);
+        if (array)
+            std::memcpy(PyArray_DATA(reinterpret_cast<PyArrayObject*>(array)),
+                        matrix.memptr(), matrix.n_elem * sizeof(CoordinateType));
+        return array;
+    }
+
+    // Convert the pending Python exception to a C++ exception
+    static void throwPythonError() {
+        PyObject *type, *value, *traceback;
+        PyErr_Fetch(&type, &value, &traceback);
+        std::string message = "PythonBatchFunctor::evaluate(): "
+            "callable raised an exception";
+        PyObject* text = value ? PyObject_Str(value) : 0;
+        if (text) {
+#if PY_MAJOR_VERSION >= 3
+            const char* chars = PyUnicode_AsUTF8(text);
+#else
+            const char* chars = PyString_AsString(text);
+#endif
+            if (chars)
+                message += std::string(": ") + chars;
+            Py_DECREF(text);
+        }
+        PyErr_Clear();
+        Py_XDECREF(type);
+        Py_XDECREF(value);
+        Py_XDECREF(traceback);
+        throw std::runtime_error(message);
+    }
+
+    PyObject* m_callable;
+    int m_argumentDimension;
+    int m_resultDimension;
+    bool m_dependsOnNormals;
+    /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
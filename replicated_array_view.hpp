@@ -0,0 +1,169 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef replicated_array_view_hpp
+#define replicated_array_view_hpp
+
+#include "dof_ordering.hpp"
+
+#include "common/common.hpp"
+#include "common/shared_ptr.hpp"
+
+#include <armadillo>
+#include <vector>
+
+namespace Bempp
+{
+
+/** \brief Read-only view of an array each of whose elements is repeated a
+ *  fixed number of times.
+ *
+ *  With the interleaved ordering (default), the <tt>i</tt>th element of the
+ *  view is the <tt>(i / replicationCount)</tt>th element of the underlying
+ *  array; with the blocked ordering, it is the <tt>(i % n)</tt>th element,
+ *  \p n being the size of the underlying array. SimpleVectorSpace
+ *  uses this class to expose data attached to the DOFs of its scalar space
+ *  (positions, normals, bounding boxes etc.) as data attached to its own
+ *  DOFs, which share them component by component, without storing \p
+ *  replicationCount copies of each entry. */
+template <typename T>
+class ReplicatedArrayView
+{
+public:
+    typedef T value_type;
+
+    ReplicatedArrayView(const shared_ptr<const std::vector<T> >& data,
+                        int replicationCount,
+                        DofOrdering ordering = INTERLEAVED_DOFS) :
+        m_data(data), m_replicationCount(replicationCount), m_ordering(ordering)
+    {}
+
+    /** \brief Number of elements of the view. */
+    size_t size() const {
+        return m_data->size() * m_replicationCount;
+    }
+
+    /** \brief Element \p i of the view. */
+    const T& operator[](size_t i) const {
+        return (*m_data)[m_ordering == INTERLEAVED_DOFS ?
+                         i / m_replicationCount : i % m_data->size()];
+    }
+
+    /** \brief Number of times each element of the underlying array is
+     *  repeated. */
+    int replicationCount() const {
+        return m_replicationCount;
+    }
+
+    /** \brief Underlying array. */
+    const std::vector<T>& data() const {
+        return *m_data;
+    }
+
+    /** \brief Store all elements of the view in \p result. */
+    void copyTo(std::vector<T>& result) const {
+        const size_t dataSize = m_data->size();
+        const VectorDofNumbering numbering(m_ordering, m_replicationCount, dataSize);
+        result.resize(dataSize * m_replicationCount);
+        for (size_t i = 0; i < dataSize; ++i)
+            for (int j = 0; j < m_replicationCount; ++j)
+                result[numbering.vectorDof(i, j)] = (*m_data)[i];
+    }
+
+private:
+    /** \cond PRIVATE */
+    shared_ptr<const std::vector<T> > m_data;
+    int m_replicationCount;
+    DofOrdering m_ordering;
+    /** \endcond */
+};
+
+/** \brief Read-only view of a matrix each of whose columns is repeated a
+ *  fixed number of times.
+ *
+ *  The columns of the underlying matrix are repeated in the same way as the
+ *  elements of the array underlying a ReplicatedArrayView. */
+template <typename T>
+class ReplicatedColumnView
+{
+public:
+    ReplicatedColumnView(const shared_ptr<const arma::Mat<T> >& data,
+                         int replicationCount,
+                         DofOrdering ordering = INTERLEAVED_DOFS) :
+        m_data(data), m_replicationCount(replicationCount), m_ordering(ordering)
+    {}
+
+    /** \brief Number of rows of the view. */
+    size_t n_rows() const {
+        return m_data->n_rows;
+    }
+
+    /** \brief Number of columns of the view. */
+    size_t n_cols() const {
+        return m_data->n_cols * m_replicationCount;
+    }
+
+    /** \brief Element <tt>(row, col)</tt> of the view. */
+    const T& operator()(size_t row, size_t col) const {
+        return (*m_data)(row, dataColumn(col));
+    }
+
+    /** \brief Pointer to the (contiguous) column \p col of the view. */
+    const T* colptr(size_t col) const {
+        return m_data->colptr(dataColumn(col));
+    }
+
+    /** \brief Number of times each column of the underlying matrix is
+     *  repeated. */
+    int replicationCount() const {
+        return m_replicationCount;
+    }
+
+    /** \brief Underlying matrix. */
+    const arma::Mat<T>& data() const {
+        return *m_data;
+    }
+
+    /** \brief Store all columns of the view in \p result. */
+    void copyTo(arma::Mat<T>& result) const {
+        const VectorDofNumbering numbering(m_ordering, m_replicationCount,
+                                           m_data->n_cols);
+        result.set_size(m_data->n_rows, m_data->n_cols * m_replicationCount);
+        for (size_t col = 0; col < m_data->n_cols; ++col)
+            for (int j = 0; j < m_replicationCount; ++j)
+                result.col(numbering.vectorDof(col, j)) = m_data->col(col);
+    }
+
+private:
+    /** \cond PRIVATE */
+    size_t dataColumn(size_t col) const {
+        return m_ordering == INTERLEAVED_DOFS ?
+            col / m_replicationCount : col % m_data->n_cols;
+    }
+
+    shared_ptr<const arma::Mat<T> > m_data;
+    int m_replicationCount;
+    DofOrdering m_ordering;
+    /** \endcond */
+};
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,164 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+// Benchmark of PiecewiseLinearVectorSpace::shapeset(). The lookup in the
+// table of element shapesets is compared with the code it replaced, which
+// queried the variant of each element from the scalar space and selected
+// the shapeset in a switch. The program fails if the two disagree. Time it
+// in a release build: in debug builds, shapeset(const Entity<0>&) also
+// queries the element variant to check the table.
+
+#include "piecewise_linear_continuous_vector_space.hpp"
+#include "simple_vector_shapeset.hpp"
+
+#include "fiber/linear_scalar_shapeset.hpp"
+#include "grid/entity.hpp"
+#include "grid/entity_iterator.hpp"
+#include "grid/grid.hpp"
+#include "grid/grid_factory.hpp"
+#include "grid/grid_parameters.hpp"
+#include "grid/grid_view.hpp"
+
+#include <armadillo>
+#include <boost/make_shared.hpp>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <tbb/tick_count.h>
+#include <vector>
+
+namespace
+{
+
+using namespace Bempp;
+
+typedef PiecewiseLinearContinuousVectorSpace<double, 3> Space3;
+
+const int REPETITION_COUNT = 100;
+
+// Shapesets selected by the switch of the old implementation
+class VariantSwitch
+{
+public:
+    VariantSwitch() :
+        m_lineShapeset(
+            boost::make_shared<Fiber::LinearScalarShapeset<2, double> >()),
+        m_triangleShapeset(
+            boost::make_shared<Fiber::LinearScalarShapeset<3, double> >()),
+        m_quadrilateralShapeset(
+            boost::make_shared<Fiber::LinearScalarShapeset<4, double> >())
+    {}
+
+    const Fiber::Shapeset<double>& shapeset(const Space3& space,
+                                            const Entity<0>& element) const {
+        switch (space.elementVariant(element))
+        {
+        case 3:
+            return m_triangleShapeset;
+        case 4:
+            return m_quadrilateralShapeset;
+        case 2:
+            return m_lineShapeset;
+        default:
+            throw std::logic_error("VariantSwitch::shapeset(): "
+                                   "invalid element variant");
+        }
+    }
+
+private:
+    Fiber::SimpleVectorShapeset<double, 3> m_lineShapeset;
+    Fiber::SimpleVectorShapeset<double, 3> m_triangleShapeset;
+    Fiber::SimpleVectorShapeset<double, 3> m_quadrilateralShapeset;
+};
+
+} // namespace
+
+int main()
+{
+    GridParameters params;
+    params.topology = GridParameters::TRIANGULAR;
+    arma::Col<double> lowerLeft(2), upperRight(2);
+    lowerLeft.fill(0.);
+    upperRight.fill(1.);
+    arma::Col<unsigned int> elementCounts(2);
+    elementCounts.fill(100);
+    shared_ptr<Grid> grid = GridFactory::createStructuredGrid(
+        params, lowerLeft, upperRight, elementCounts);
+    const Space3 space(grid);
+    const VariantSwitch variantSwitch;
+
+    std::auto_ptr<GridView> view = grid->leafView();
+    std::vector<size_t> elementIndices;
+    bool ok = true;
+    {
+        std::auto_ptr<EntityIterator<0> > it = view->entityIterator<0>();
+        for (; !it->finished(); it->next()) {
+            const Entity<0>& element = it->entity();
+            const size_t index = space.elementDofTable().elementIndex(element);
+            elementIndices.push_back(index);
+            if (space.shapeset(element).size() !=
+                    variantSwitch.shapeset(space, element).size() ||
+                    &space.shapeset(element) != &space.shapeset(index))
+                ok = false;
+        }
+    }
+    if (!ok) {
+        std::cerr << "The shapeset table disagrees with the element variants"
+                  << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Sum of the shapeset sizes; printed so that the loops are not
+    // optimized away
+    size_t checksum = 0;
+
+    tbb::tick_count start = tbb::tick_count::now();
+    for (int r = 0; r < REPETITION_COUNT; ++r) {
+        std::auto_ptr<EntityIterator<0> > it = view->entityIterator<0>();
+        for (; !it->finished(); it->next())
+            checksum += variantSwitch.shapeset(space, it->entity()).size();
+    }
+    const double switchTime = (tbb::tick_count::now() - start).seconds();
+
+    start = tbb::tick_count::now();
+    for (int r = 0; r < REPETITION_COUNT; ++r) {
+        std::auto_ptr<EntityIterator<0> > it = view->entityIterator<0>();
+        for (; !it->finished(); it->next())
+            checksum += space.shapeset(it->entity()).size();
+    }
+    const double elementTime = (tbb::tick_count::now() - start).seconds();
+
+    start = tbb::tick_count::now();
+    for (int r = 0; r < REPETITION_COUNT; ++r)
+        for (size_t e = 0; e < elementIndices.size(); ++e)
+            checksum += space.shapeset(elementIndices[e]).size();
+    const double indexTime = (tbb::tick_count::now() - start).seconds();
+
+    const size_t lookupCount = REPETITION_COUNT * elementIndices.size();
+    std::cout << "Shapeset lookups: " << lookupCount
+              << " (checksum " << checksum << ")\n"
+              << "  variant switch (before):     " << switchTime << " s\n"
+              << "  table, shapeset(element):    " << elementTime << " s\n"
+              << "  table, shapeset(index):      " << indexTime << " s"
+              << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -21,16 +21,39 @@
 #ifndef simple_vector_function_value_functor_hpp
 #define simple_vector_function_value_functor_hpp
 
+#include "unrolled_loop.hpp"
+
 #include "common/common.hpp"
 
 #include "fiber/basis_data.hpp"
 #include "fiber/geometrical_data.hpp"
 #include "fiber/collection_of_3d_arrays.hpp"
+#include "fiber/collection_of_shapeset_transformations.hpp"
 #include "fiber/shape_transformation_functor_wrappers.hpp"
 
+#include <algorithm>
+
 namespace Fiber
 {
 
+/** \cond PRIVATE */
+template <typename ValueType>
+struct CopyVectorComponent
+{
+    CopyVectorComponent(const ConstBasisDataSlice<ValueType>& basisData_,
+                        _1dSliceOf3dArray<ValueType>& result_) :
+        basisData(basisData_), result(result_)
+    {}
+
+    void operator()(int component) const {
+        result(component) = basisData.values(component);
+    }
+
+    const ConstBasisDataSlice<ValueType>& basisData;
+    _1dSliceOf3dArray<ValueType>& result;
+};
+/** \endcond */
+
 template <typename CoordinateType_, int dim>
 class SimpleVectorFunctionValueElementaryFunctor
 {
@@ -51,8 +74,8 @@ public:
             _1dSliceOf3dArray<ValueType>& result) const {
         assert(basisData.componentCount() == argumentDimension());
         assert(result.extent(0) == resultDimension());
-        for (size_t i = 0; i < dim; ++i)
-            result(i) = basisData.values(i);
+        const CopyVectorComponent<ValueType> copy(basisData, result);
+        UnrolledLoop<dim>::run(copy);
     }
 };
 
@@ -69,6 +92,70 @@ public:
     typedef CoordinateType_ CoordinateType;
 };
 
+/** \brief Collection of shapeset transformations consisting of the single
+ *  transformation computing the values of vector functions with \p dim
+ *  components.
+ *
+ *  This class produces the same results as
+ *  DefaultCollectionOfShapesetTransformations<SimpleVectorFunctionValueFunctor<CoordinateType,
+ *  dim> >, but instead of invoking the functor once per function and point,
+ *  it transforms all functions at all points in one call. The values of the
+ *  basis functions and the transformed values share the layout
+ *  <tt>(component, function, point)</tt>, so the transformation reduces to
+ *  a single contiguous copy. */
+template <typename CoordinateType_, int dim>
+class SimpleVectorFunctionValueTransformations :
+        public CollectionOfShapesetTransformations<CoordinateType_>
+{
+    typedef CollectionOfShapesetTransformations<CoordinateType_> Base;
+public:
+    typedef typename Base::CoordinateType CoordinateType;
+    typedef typename Base::ComplexType ComplexType;
+
+    virtual int transformationCount() const {
+        return 1;
+    }
+
+    virtual int argumentDimension() const {
+        return dim;
+    }
+
+    virtual int resultDimension(int transformationIndex) const {
+        return dim;
+    }
+
+    virtual void addDependencies(size_t& basisDeps, size_t& geomDeps) const {
+        basisDeps |= VALUES;
+    }
+
+private:
+    template <typename ValueType>
+    void evaluateImpl(const BasisData<ValueType>& basisData,
+                      const GeometricalData<CoordinateType>& geomData,
+                      CollectionOf3dArrays<ValueType>& result) const {
+        assert(basisData.componentCount() == dim);
+        result.set_size(1);
+        _3dArray<ValueType>& values = result[0];
+        values.set_size(dim, basisData.functionCount(), basisData.pointCount());
+        std::copy(basisData.values.begin(), basisData.values.end(),
+                  values.begin());
+    }
+
+    virtual void evaluateImplRealBasis(
+            const BasisData<CoordinateType>& basisData,
+            const GeometricalData<CoordinateType>& geomData,
+            CollectionOf3dArrays<CoordinateType>& result) const {
+        evaluateImpl(basisData, geomData, result);
+    }
+
+    virtual void evaluateImplComplexBasis(
+            const BasisData<ComplexType>& basisData,
+            const GeometricalData<CoordinateType>& geomData,
+            CollectionOf3dArrays<ComplexType>& result) const {
+        evaluateImpl(basisData, geomData, result);
+    }
+};
+
 } // namespace Fiber
 
 #endif
@@ -21,14 +21,87 @@
 #ifndef simple_vector_shapeset_hpp
 #define simple_vector_shapeset_hpp
 
+#include "unrolled_loop.hpp"
+
 #include "fiber/basis.hpp"
 #include "fiber/basis_data.hpp"
 
 #include <algorithm>
+#include <tbb/atomic.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <vector>
 
 namespace Fiber
 {
 
+/** \cond PRIVATE */
+// Operations executed for each component by the unrolled loops in
+// SimpleVectorShapeset::evaluate()
+template <typename ValueType, int dim>
+struct ScatterVectorValue
+{
+    ScatterVectorValue(_3dArray<ValueType>& values_, size_t scalarDofIndex_,
+                       size_t pointIndex_, ValueType value_) :
+        values(values_), scalarDofIndex(scalarDofIndex_),
+        pointIndex(pointIndex_), value(value_)
+    {}
+
+    void operator()(int component) const {
+        values(component, scalarDofIndex * dim + component, pointIndex) = value;
+    }
+
+    _3dArray<ValueType>& values;
+    size_t scalarDofIndex;
+    size_t pointIndex;
+    ValueType value;
+};
+
+template <typename ValueType, int dim>
+struct ScatterVectorDerivative
+{
+    ScatterVectorDerivative(_4dArray<ValueType>& derivatives_,
+                            size_t scalarDimIndex_, size_t scalarDofIndex_,
+                            size_t pointIndex_, ValueType value_) :
+        derivatives(derivatives_), scalarDimIndex(scalarDimIndex_),
+        scalarDofIndex(scalarDofIndex_), pointIndex(pointIndex_), value(value_)
+    {}
+
+    void operator()(int component) const {
+        derivatives(component, scalarDimIndex,
+                    scalarDofIndex * dim + component, pointIndex) = value;
+    }
+
+    _4dArray<ValueType>& derivatives;
+    size_t scalarDimIndex;
+    size_t scalarDofIndex;
+    size_t pointIndex;
+    ValueType value;
+};
+/** \endcond */
+
+/** \brief Shapeset of vector functions with \p dim components, each having a
+ *  single non-zero component equal to a function of a scalar shapeset.
+ *
+ *  The function with index \p n has its non-zero component along the axis
+ *  <tt>n % dim</tt> (see component()) and this component is equal to the
+ *  function with index <tt>n / dim</tt> (see scalarDofIndex()) of the scalar
+ *  shapeset.
+ *
+ *  Besides the standard (dense) format produced by evaluate(), the
+ *  functions can be evaluated in the compact format with evaluateCompact(),
+ *  which stores only the values and derivatives of the non-zero components,
+ *  i.e. the data of the scalar shapeset. The compact format is used by the
+ *  ElementIntegrationEngine (i.e. by the integration of grid functions, the
+ *  projections and the mass matrices), which evaluates the scalar shapesets
+ *  directly. The assembly of boundary operators by BEM++ obtains the basis
+ *  data through evaluate(), so SimpleVectorFunctionValueFunctor, the
+ *  SimpleVectorFunctionValueTransformations and
+ *  SimpleVectorTestKernelTrialIntegral work on the dense format.
+ *
+ *  The results of evaluate() are not memoized: BEM++ passes its own
+ *  BasisData object to each call and keeps no reference to a shared
+ *  result, so a cache would only replace the scatter from the scalar data
+ *  by a copy of the same size. */
 template <typename ValueType, int dim>
 class SimpleVectorShapeset : public Basis<ValueType>
 {
@@ -37,7 +110,9 @@ public:
 
     SimpleVectorShapeset(const shared_ptr<Shapeset<ValueType> > &scalarShapeset) :
         m_scalarShapeset(scalarShapeset)
-    {}
+    {
+        m_allocationCount = 0;
+    }
 
     virtual int size() const {
         return m_scalarShapeset->size() * dim;
@@ -47,17 +122,85 @@ public:
         return m_scalarShapeset->order();
     }
 
+    /** \brief Scalar shapeset whose functions are copied to each component. */
+    const Shapeset<ValueType>& scalarShapeset() const {
+        return *m_scalarShapeset;
+    }
+
+    /** \brief Index of the non-zero component of the function with index \p
+     *  localDofIndex. */
+    static int component(LocalDofIndex localDofIndex) {
+        return localDofIndex % dim;
+    }
+
+    /** \brief Index of the scalar function equal to the non-zero component of
+     *  the function with index \p localDofIndex. */
+    static LocalDofIndex scalarDofIndex(LocalDofIndex localDofIndex) {
+        return localDofIndex / dim;
+    }
+
+    /** \brief Evaluate the functions in the compact format.
+     *
+     *  On output, <tt>scalarData.values(0, j, p)</tt> is the value of the
+     *  non-zero component of the function with index <tt>j * dim + c</tt>
+     *  (for any \p c) at point \p p, and similarly for
+     *  <tt>scalarData.derivatives</tt>. If \p localDofIndex is not \p
+     *  ALL_DOFS, \p scalarData has a single function, the non-zero component
+     *  of the function \p localDofIndex, which lies along the axis
+     *  <tt>component(localDofIndex)</tt>.
+     *
+     *  Compared to evaluate(), this reduces the amount of data written by a
+     *  factor of \p dim for values and \p dim squared for derivatives. Only
+     *  code calling this function directly benefits from it; see the
+     *  class documentation. */
+    void evaluateCompact(size_t what,
+                         const arma::Mat<CoordinateType>& points,
+                         LocalDofIndex localDofIndex,
+                         BasisData<ValueType>& scalarData) const {
+        const LocalDofIndex scalarLocalDofIndex =
+            localDofIndex == ALL_DOFS ? ALL_DOFS : scalarDofIndex(localDofIndex);
+        m_scalarShapeset->evaluate(what, points, scalarLocalDofIndex, scalarData);
+    }
+
+    /** \brief Number of times the storage of the scratch data of any thread
+     *  or of the arrays passed to evaluate() has been (re)allocated by
+     *  evaluate().
+     *
+     *  The scalar data needed by evaluate() are stored in buffers
+     *  private to each thread and reused across calls; the output arrays
+     *  are reallocated only when their size changes. Once each thread has
+     *  evaluated the functions at a given number of points, further
+     *  evaluations at the same number of points into the same BasisData
+     *  object should not change this counter.
+     *
+     *  Reallocations are detected by a change of the address of the array
+     *  storage, so a reallocation returning the freed block is not
+     *  counted. */
+    size_t allocationCount() const {
+        return m_allocationCount;
+    }
+
+    /** \brief Reset the counter returned by allocationCount() to zero. */
+    void resetAllocationCount() const {
+        m_allocationCount = 0;
+    }
+
+    /** \brief Evaluate the functions.
+     *
+     *  The values and derivatives are scattered directly from the scalar
+     *  shapeset into \p data. This function may be called concurrently from
+     *  several threads. */
     virtual void evaluate(size_t what,
                           const arma::Mat<CoordinateType>& points,
                           LocalDofIndex localDofIndex,
                           BasisData<ValueType>& data) const {
         const size_t pointCount = points.n_cols;
-        // TODO: perhaps cache this as thread-local storage to avoid frequent
-        // allocaltion/deallocation
-        BasisData<ValueType> scalarData;
-        const LocalDofIndex scalarLocalDofIndex = 
-            localDofIndex == ALL_DOFS ? ALL_DOFS : localDofIndex / 3;
-        m_scalarShapeset->evaluate(what, points, scalarLocalDofIndex, scalarData);
+        BasisData<ValueType>& scalarData = m_scalarData.local();
+        const ValueType* oldScalarValues = scalarData.values.begin();
+        const ValueType* oldScalarDerivatives = scalarData.derivatives.begin();
+        const ValueType* oldValues = data.values.begin();
+        const ValueType* oldDerivatives = data.derivatives.begin();
+        evaluateCompact(what, points, localDofIndex, scalarData);
         if (localDofIndex == ALL_DOFS)
         {
             if (what & VALUES)
@@ -68,10 +211,12 @@ public:
                 data.values.set_size(dim, scalarDofCount * dim, pointCount);
                 std::fill(data.values.begin(), data.values.end(), 0);
                 for (size_t pointIndex = 0; pointIndex < pointCount; ++pointIndex)
-                    for (size_t scalarDofIndex = 0; scalarDofIndex < scalarDofCount; ++scalarDofIndex)
-                        for (size_t component = 0; component < dim; ++component)
-                            data.values(component, scalarDofIndex * dim + component, pointIndex) = 
-                                scalarData.values(0, scalarDofIndex, pointIndex);
+                    for (size_t scalarDofIndex = 0; scalarDofIndex < scalarDofCount; ++scalarDofIndex) {
+                        const ScatterVectorValue<ValueType, dim> scatter(
+                            data.values, scalarDofIndex, pointIndex,
+                            scalarData.values(0, scalarDofIndex, pointIndex));
+                        UnrolledLoop<dim>::run(scatter);
+                    }
             }
             if (what & DERIVATIVES)
             {
@@ -84,17 +229,19 @@ public:
                 std::fill(data.derivatives.begin(), data.derivatives.end(), 0);
                 for (size_t pointIndex = 0; pointIndex < pointCount; ++pointIndex)
                     for (size_t scalarDofIndex = 0; scalarDofIndex < scalarDofCount; ++scalarDofIndex)
-                        for (size_t scalarDimIndex = 0; scalarDimIndex < scalarDimCount; ++scalarDimIndex)
-                            for (size_t component = 0; component < dim; ++component)
-                                data.derivatives(component, scalarDimIndex, 
-                                            scalarDofIndex * dim + component, pointIndex) = 
-                                    scalarData.derivatives(0, scalarDimIndex, 
-                                                           scalarDofIndex, pointIndex);
+                        for (size_t scalarDimIndex = 0; scalarDimIndex < scalarDimCount; ++scalarDimIndex) {
+                            const ScatterVectorDerivative<ValueType, dim> scatter(
+                                data.derivatives, scalarDimIndex, scalarDofIndex,
+                                pointIndex,
+                                scalarData.derivatives(0, scalarDimIndex,
+                                                       scalarDofIndex, pointIndex));
+                            UnrolledLoop<dim>::run(scatter);
+                        }
             }
         }
         else
         {
-            const size_t component = localDofIndex % dim;
+            const size_t component = this->component(localDofIndex);
             if (what & VALUES)
             {
                 assert(scalarData.values.extent(0) == 1);
@@ -120,10 +267,20 @@ public:
                             scalarData.derivatives(0, scalarDimIndex, 0, pointIndex);
             }
         }
+        const int allocationCount =
+            (scalarData.values.begin() != oldScalarValues) +
+            (scalarData.derivatives.begin() != oldScalarDerivatives) +
+            (data.values.begin() != oldValues) +
+            (data.derivatives.begin() != oldDerivatives);
+        if (allocationCount)
+            m_allocationCount += allocationCount;
     }
 
 private:
     shared_ptr<Shapeset<ValueType> > m_scalarShapeset;
+    // Per-thread scratch space for the output of the scalar shapeset
+    mutable tbb::enumerable_thread_specific<BasisData<ValueType> > m_scalarData;
+    mutable tbb::atomic<size_t> m_allocationCount;
 };
 
 } // namespace Fiber
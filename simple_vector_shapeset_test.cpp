@@ -0,0 +1,89 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+// Test of the reuse of storage by SimpleVectorShapeset::evaluate(): once the
+// functions have been evaluated at a given number of points, evaluating them
+// again at the same points into the same BasisData object must not allocate,
+// as reported by allocationCount(). Both the evaluation of all functions and
+// that of a single function are checked.
+
+#include "simple_vector_shapeset.hpp"
+
+#include "fiber/linear_scalar_shapeset.hpp"
+
+#include <armadillo>
+#include <boost/make_shared.hpp>
+#include <cstdlib>
+#include <iostream>
+
+namespace
+{
+
+using namespace Fiber;
+
+typedef SimpleVectorShapeset<double, 3> VectorShapeset;
+
+const size_t POINT_COUNT = 4;
+
+bool testRepeatedEvaluation(const VectorShapeset& shapeset,
+                            const arma::Mat<double>& points,
+                            LocalDofIndex localDofIndex, const char* label)
+{
+    BasisData<double> data;
+    shapeset.resetAllocationCount();
+    shapeset.evaluate(VALUES | DERIVATIVES, points, localDofIndex, data);
+    const size_t firstCount = shapeset.allocationCount();
+    bool ok = true;
+    // The first evaluation must have allocated the output arrays, otherwise
+    // the counter is not doing its job
+    if (firstCount == 0) {
+        std::cerr << label << ": first evaluation reported no allocation"
+                  << std::endl;
+        ok = false;
+    }
+    shapeset.evaluate(VALUES | DERIVATIVES, points, localDofIndex, data);
+    if (shapeset.allocationCount() != firstCount) {
+        std::cerr << label << ": second evaluation allocated "
+                  << shapeset.allocationCount() - firstCount
+                  << " time(s)" << std::endl;
+        ok = false;
+    }
+    return ok;
+}
+
+} // namespace
+
+int main()
+{
+    const VectorShapeset shapeset(
+        boost::make_shared<LinearScalarShapeset<3, double> >());
+
+    arma::Mat<double> points(2, POINT_COUNT);
+    for (size_t p = 0; p < POINT_COUNT; ++p) {
+        points(0, p) = 0.1 + 0.2 * p;
+        points(1, p) = 0.15;
+    }
+
+    bool ok = true;
+    ok = testRepeatedEvaluation(shapeset, points, ALL_DOFS, "All functions")
+        && ok;
+    ok = testRepeatedEvaluation(shapeset, points, 4, "Single function") && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -20,41 +20,130 @@
 
 #include "simple_vector_space.hpp"
 
+#include "dof_transfer_operator.hpp"
+#include "lazy_shared_ptr.hpp"
 #include "simple_vector_function_value_functor.hpp"
+#include "vector_dof_clustering.hpp"
 
 #include "common/acc.hpp"
 
 #include "fiber/explicit_instantiation.hpp"
-#include "fiber/default_collection_of_shapeset_transformations.hpp"
+
+#include <boost/make_shared.hpp>
+#include <boost/noncopyable.hpp>
+#include <sstream>
 
 namespace Bempp
 {
 
 /** \cond PRIVATE */
+// Component transfer operators built on first use. The DOFs of copies of a
+// space are identical, so the copies share the cache.
+template <typename BasisFunctionType, int componentCount>
+struct ComponentTransferCache : boost::noncopyable
+{
+    LazySharedPtr<const DofTransferOperator<BasisFunctionType> >
+    extractors[componentCount];
+    LazySharedPtr<const DofTransferOperator<BasisFunctionType> >
+    injectors[componentCount];
+};
+
+// Data attached to the DOFs of the scalar space, fetched on first use. The
+// views of a space and of its copies share these arrays.
+template <typename CoordinateType>
+struct ScalarDofDataCache : boost::noncopyable
+{
+    LazySharedPtr<const arma::Mat<CoordinateType> > interpolationPoints;
+    LazySharedPtr<const arma::Mat<CoordinateType> > interpolationNormals;
+    LazySharedPtr<const std::vector<BoundingBox<CoordinateType> > >
+    globalDofBoundingBoxes;
+    LazySharedPtr<const std::vector<BoundingBox<CoordinateType> > >
+    flatLocalDofBoundingBoxes;
+    LazySharedPtr<const std::vector<Point3D<CoordinateType> > > globalDofPositions;
+    LazySharedPtr<const std::vector<Point3D<CoordinateType> > > flatLocalDofPositions;
+    LazySharedPtr<const std::vector<Point3D<CoordinateType> > > globalDofNormals;
+    LazySharedPtr<const std::vector<Point3D<CoordinateType> > > flatLocalDofNormals;
+};
+
+// Return the array cached in cache, filling it with getData on first use
+template <typename BasisFunctionType, typename Data>
+shared_ptr<const Data> cachedScalarDofData(
+    LazySharedPtr<const Data>& cache,
+    const Space<BasisFunctionType>& scalarSpace,
+    void (Space<BasisFunctionType>::*getData)(Data&) const)
+{
+    shared_ptr<const Data> data = cache.get();
+    if (!data) {
+        typename LazySharedPtr<const Data>::Initializer initializer(cache);
+        data = initializer.value();
+        if (!data) {
+            shared_ptr<Data> newData = boost::make_shared<Data>();
+            (scalarSpace.*getData)(*newData);
+            data = initializer.publish(newData);
+        }
+    }
+    return data;
+}
+
 template <typename BasisFunctionType, int codomainDim>
 struct SimpleVectorSpace<BasisFunctionType, codomainDim>::Impl
 {
-    typedef Fiber::SimpleVectorFunctionValueFunctor<CoordinateType, codomainDim>
-    TransformationFunctor;
-
-    Impl() : transformations(TransformationFunctor())
+    Impl(DofOrdering ordering_) :
+        ordering(ordering_),
+        transfers(boost::make_shared<
+                  ComponentTransferCache<BasisFunctionType, codomainDim> >()),
+        scalarDofData(boost::make_shared<ScalarDofDataCache<CoordinateType> >())
     {}
 
-    Fiber::DefaultCollectionOfShapesetTransformations<TransformationFunctor>
+    Fiber::SimpleVectorFunctionValueTransformations<CoordinateType, codomainDim>
     transformations;
+    shared_ptr<const ElementDofTable<BasisFunctionType> > dofTable;
+    shared_ptr<const LocalDofTable<BasisFunctionType> > localDofTable;
+    shared_ptr<const GridSegmentElementList> elements;
+    DofOrdering ordering;
+    shared_ptr<ComponentTransferCache<BasisFunctionType, codomainDim> > transfers;
+    shared_ptr<ScalarDofDataCache<CoordinateType> > scalarDofData;
 };
 /** \endcond */
 
 template <typename BasisFunctionType, int codomainDim>
 SimpleVectorSpace<BasisFunctionType, codomainDim>::SimpleVectorSpace(
-    const shared_ptr<Space<BasisFunctionType> >& scalarSpace) :
-    Base(scalarSpace->grid()), m_scalarSpace(scalarSpace), m_impl(new Impl)
+    const shared_ptr<Space<BasisFunctionType> >& scalarSpace,
+    DofOrdering ordering) :
+    Base(scalarSpace->grid()), m_scalarSpace(scalarSpace), m_impl(new Impl(ordering))
+{
+    if (scalarSpace->codomainDimension() != 1)
+    {
+        throw std::invalid_argument("SimpleVectorSpace::SimpleVectorSpace(): "
+                                    "argument must be a scalar space");
+    }
+    m_impl->dofTable.reset(
+        new ElementDofTable<BasisFunctionType>(*scalarSpace, codomainDim,
+                                               ordering));
+    m_impl->localDofTable.reset(
+        new LocalDofTable<BasisFunctionType>(*scalarSpace, codomainDim,
+                                             ordering));
+}
+
+template <typename BasisFunctionType, int codomainDim>
+SimpleVectorSpace<BasisFunctionType, codomainDim>::SimpleVectorSpace(
+    const shared_ptr<Space<BasisFunctionType> >& scalarSpace,
+    const shared_ptr<const GridSegmentElementList>& elements,
+    DofOrdering ordering) :
+    Base(scalarSpace->grid()), m_scalarSpace(scalarSpace), m_impl(new Impl(ordering))
 {
     if (scalarSpace->codomainDimension() != 1)
     {
         throw std::invalid_argument("SimpleVectorSpace::SimpleVectorSpace(): "
                                     "argument must be a scalar space");
     }
+    m_impl->elements = elements;
+    m_impl->dofTable.reset(
+        new ElementDofTable<BasisFunctionType>(*scalarSpace, codomainDim,
+                                               ordering, m_impl->elements.get()));
+    m_impl->localDofTable.reset(
+        new LocalDofTable<BasisFunctionType>(*scalarSpace, codomainDim,
+                                             ordering));
 }
 
 template <typename BasisFunctionType, int codomainDim>
@@ -144,24 +233,28 @@ void SimpleVectorSpace<BasisFunctionType, codomainDim>::getGlobalDofs(
     std::vector<GlobalDofIndex>& dofs,
     std::vector<BasisFunctionType>& localDofWeights) const
 {
-    m_scalarSpace->getGlobalDofs(element, dofs, localDofWeights);
-    const size_t scalarDofCount = dofs.size();
-    dofs.resize(codomainDim * scalarDofCount);
-    for (ptrdiff_t i = scalarDofCount - 1; i >= 0; --i)
-    {
-        for (ptrdiff_t d = codomainDim - 1; d >= 0; --d)
-        {
-            acc(dofs, i * codomainDim + d) = acc(dofs, i) * codomainDim + d;
-        }
-    }
-    localDofWeights.resize(codomainDim * scalarDofCount);
-    for (ptrdiff_t i = scalarDofCount - 1; i >= 0; --i)
-    {
-        for (ptrdiff_t d = codomainDim - 1; d >= 0; --d)
-        {
-            acc(localDofWeights, i * codomainDim + d) = acc(localDofWeights, i);
-        }
-    }
+    const ElementDofTable<BasisFunctionType>& table = *m_impl->dofTable;
+    const size_t elementIndex = table.elementIndex(element);
+    const size_t dofCount = table.dofCount(elementIndex);
+    const GlobalDofIndex* elementDofs = table.dofs(elementIndex);
+    const BasisFunctionType* elementWeights = table.weights(elementIndex);
+    dofs.assign(elementDofs, elementDofs + dofCount);
+    localDofWeights.assign(elementWeights, elementWeights + dofCount);
+}
+
+template <typename BasisFunctionType, int codomainDim>
+ElementDofRange<BasisFunctionType>
+SimpleVectorSpace<BasisFunctionType, codomainDim>::globalDofsOfElements(
+    size_t beginElementIndex, size_t endElementIndex) const
+{
+    return m_impl->dofTable->elements(beginElementIndex, endElementIndex);
+}
+
+template <typename BasisFunctionType, int codomainDim>
+const ElementDofTable<BasisFunctionType>&
+SimpleVectorSpace<BasisFunctionType, codomainDim>::elementDofTable() const
+{
+    return *m_impl->dofTable;
 }
 
 template <typename BasisFunctionType, int codomainDim>
@@ -170,20 +263,18 @@ void SimpleVectorSpace<BasisFunctionType, codomainDim>::global2localDofs(
     std::vector<std::vector<LocalDof> >& localDofs,
     std::vector<std::vector<BasisFunctionType> >& localDofWeights) const
 {
-    const size_t globalDofCount = globalDofs.size();
-    // For efficiency (to avoid frequent reallocations), perhaps we
-    // should store this vector as a thread-local member variable?
-    std::vector<GlobalDofIndex> scalarGlobalDofs(globalDofCount);
-    for (size_t i = 0; i < globalDofCount; ++i)
-        acc(scalarGlobalDofs, i) = acc(globalDofs, i) / codomainDim;
-    m_scalarSpace->global2localDofs(scalarGlobalDofs, localDofs, localDofWeights);
-    for (size_t i = 0; i < globalDofCount; ++i)
-    {
-        const size_t component = acc(globalDofs, i) % codomainDim;
-        for (size_t j = 0; j < acc(localDofs, i).size(); ++j)
-            acc(acc(localDofs, i), j).dofIndex = 
-                acc(acc(localDofs, i), j).dofIndex * codomainDim + component;
-    }
+    m_impl->localDofTable->global2localDofs(globalDofs, localDofs, localDofWeights);
+}
+
+template <typename BasisFunctionType, int codomainDim>
+void SimpleVectorSpace<BasisFunctionType, codomainDim>::global2localDofs(
+    const GlobalDofIndex* globalDofs, size_t globalDofCount,
+    std::vector<size_t>& offsets,
+    std::vector<LocalDof>& localDofs,
+    std::vector<BasisFunctionType>& localDofWeights) const
+{
+    m_impl->localDofTable->global2localDofs(globalDofs, globalDofCount,
+                                            offsets, localDofs, localDofWeights);
 }
 
 template <typename BasisFunctionType, int codomainDim>
@@ -191,33 +282,26 @@ void SimpleVectorSpace<BasisFunctionType, codomainDim>::flatLocal2localDofs(
     const std::vector<FlatLocalDofIndex>& flatLocalDofs,
     std::vector<LocalDof>& localDofs) const
 {
-    const size_t flatLocalDofCount = flatLocalDofs.size();
-    // For efficiency (to avoid frequent reallocations), perhaps we
-    // should store this vector as a thread-local member variable?
-    std::vector<FlatLocalDofIndex> scalarFlatLocalDofs(flatLocalDofCount);
-    for (size_t i = 0; i < flatLocalDofCount; ++i)
-        acc(scalarFlatLocalDofs, i) = acc(flatLocalDofs, i) / codomainDim;
-    m_scalarSpace->flatLocal2localDofs(scalarFlatLocalDofs, localDofs);
-    for (size_t i = 0; i < flatLocalDofCount; ++i)
-    {
-        const size_t component = acc(flatLocalDofs, i) % codomainDim;
-        acc(localDofs, i).dofIndex =
-            acc(localDofs, i).dofIndex * codomainDim + component;
-    }
+    localDofs.resize(flatLocalDofs.size());
+    if (!flatLocalDofs.empty())
+        m_impl->localDofTable->flatLocal2localDofs(
+            &flatLocalDofs[0], flatLocalDofs.size(), &localDofs[0]);
+}
+
+template <typename BasisFunctionType, int codomainDim>
+void SimpleVectorSpace<BasisFunctionType, codomainDim>::flatLocal2localDofs(
+    const FlatLocalDofIndex* flatLocalDofs, size_t flatLocalDofCount,
+    LocalDof* localDofs) const
+{
+    m_impl->localDofTable->flatLocal2localDofs(
+        flatLocalDofs, flatLocalDofCount, localDofs);
 }
 
 template <typename BasisFunctionType, int codomainDim>
 void SimpleVectorSpace<BasisFunctionType, codomainDim>::getGlobalDofInterpolationPoints(
     arma::Mat<CoordinateType>& points) const 
 {
-    arma::Mat<CoordinateType> scalarSpacePoints;
-    m_scalarSpace->getGlobalDofInterpolationPoints(scalarSpacePoints);
-    points.set_size(scalarSpacePoints.n_rows, scalarSpacePoints.n_cols * codomainDim);
-    for (size_t pointIndex = 0; pointIndex < scalarSpacePoints.n_cols; ++pointIndex)
-        for (size_t component = 0; component < codomainDim; ++component)
-            for (size_t dim = 0; dim < scalarSpacePoints.n_rows; ++dim)
-                points(dim, pointIndex * codomainDim + component) = 
-                    scalarSpacePoints(dim, pointIndex);
+    globalDofInterpolationPointsView().copyTo(points);
 }
 
 template <typename BasisFunctionType, int codomainDim>
@@ -225,14 +309,7 @@ void
 SimpleVectorSpace<BasisFunctionType, codomainDim>::getNormalsAtGlobalDofInterpolationPoints(
     arma::Mat<CoordinateType>& normals) const 
 {
-    arma::Mat<CoordinateType> scalarSpaceNormals;
-    m_scalarSpace->getNormalsAtGlobalDofInterpolationPoints(scalarSpaceNormals);
-    normals.set_size(scalarSpaceNormals.n_rows, scalarSpaceNormals.n_cols * codomainDim);
-    for (size_t pointIndex = 0; pointIndex < scalarSpaceNormals.n_cols; ++pointIndex)
-        for (size_t component = 0; component < codomainDim; ++component)
-            for (size_t dim = 0; dim < scalarSpaceNormals.n_rows; ++dim)
-                normals(dim, pointIndex * codomainDim + component) = 
-                    scalarSpaceNormals(dim, pointIndex);
+    normalsAtGlobalDofInterpolationPointsView().copyTo(normals);
 }
 
 template <typename BasisFunctionType, int codomainDim>
@@ -241,89 +318,134 @@ SimpleVectorSpace<BasisFunctionType, codomainDim>::getGlobalDofInterpolationDire
     arma::Mat<CoordinateType>& directions) const 
 {
     const size_t scalarDofCount = m_scalarSpace->globalDofCount();
+    const VectorDofNumbering numbering(m_impl->ordering, codomainDim, scalarDofCount);
     directions.set_size(codomainDim, codomainDim * scalarDofCount);
     directions.fill(0);
     for (size_t dofIndex = 0; dofIndex < scalarDofCount; ++dofIndex)
         for (size_t dim = 0; dim < codomainDim; ++dim)
-            directions(dim, dofIndex * codomainDim + dim) = 1;
+            directions(dim, numbering.vectorDof(dofIndex, dim)) = 1;
 }
 
 template <typename BasisFunctionType, int codomainDim>
 void SimpleVectorSpace<BasisFunctionType, codomainDim>::getGlobalDofBoundingBoxes(
     std::vector<BoundingBox<CoordinateType> >& boundingBoxes) const 
 {
-    std::vector<BoundingBox<CoordinateType> > scalarDofBoundingBoxes;
-    m_scalarSpace->getGlobalDofBoundingBoxes(scalarDofBoundingBoxes);
-    const size_t scalarDofCount = scalarDofBoundingBoxes.size();
-    boundingBoxes.resize(scalarDofCount * codomainDim);
-    for (size_t dof = 0; dof < scalarDofCount; ++dof)
-        for (size_t component = 0; component < codomainDim; ++component)
-            acc(boundingBoxes, dof * codomainDim + component) = acc(scalarDofBoundingBoxes, dof);
+    globalDofBoundingBoxesView().copyTo(boundingBoxes);
 }
 
 template <typename BasisFunctionType, int codomainDim>
 void SimpleVectorSpace<BasisFunctionType, codomainDim>::getFlatLocalDofBoundingBoxes(
     std::vector<BoundingBox<CoordinateType> >& boundingBoxes) const 
 {
-    std::vector<BoundingBox<CoordinateType> > scalarDofBoundingBoxes;
-    m_scalarSpace->getFlatLocalDofBoundingBoxes(scalarDofBoundingBoxes);
-    const size_t scalarDofCount = scalarDofBoundingBoxes.size();
-    boundingBoxes.resize(scalarDofCount * codomainDim);
-    for (size_t dof = 0; dof < scalarDofCount; ++dof)
-        for (size_t component = 0; component < codomainDim; ++component)
-            acc(boundingBoxes, dof * codomainDim + component) = acc(scalarDofBoundingBoxes, dof);
+    flatLocalDofBoundingBoxesView().copyTo(boundingBoxes);
 }
 
 template <typename BasisFunctionType, int codomainDim>
 void SimpleVectorSpace<BasisFunctionType, codomainDim>::getGlobalDofPositions(
     std::vector<Point3D<CoordinateType> >& positions) const
 {
-    std::vector<Point3D<CoordinateType> > scalarDofPositions;
-    m_scalarSpace->getGlobalDofPositions(scalarDofPositions);
-    const size_t scalarDofCount = scalarDofPositions.size();
-    positions.resize(scalarDofCount * codomainDim);
-    for (size_t dof = 0; dof < scalarDofCount; ++dof)
-        for (size_t component = 0; component < codomainDim; ++component)
-            acc(positions, dof * codomainDim + component) = acc(scalarDofPositions, dof);
+    globalDofPositionsView().copyTo(positions);
 }
 
 template <typename BasisFunctionType, int codomainDim>
 void SimpleVectorSpace<BasisFunctionType, codomainDim>::getFlatLocalDofPositions(
     std::vector<Point3D<CoordinateType> >& positions) const 
 {
-    std::vector<Point3D<CoordinateType> > scalarDofPositions;
-    m_scalarSpace->getFlatLocalDofPositions(scalarDofPositions);
-    const size_t scalarDofCount = scalarDofPositions.size();
-    positions.resize(scalarDofCount * codomainDim);
-    for (size_t dof = 0; dof < scalarDofCount; ++dof)
-        for (size_t component = 0; component < codomainDim; ++component)
-            acc(positions, dof * codomainDim + component) = acc(scalarDofPositions, dof);
+    flatLocalDofPositionsView().copyTo(positions);
 }
 
 template <typename BasisFunctionType, int codomainDim>
 void SimpleVectorSpace<BasisFunctionType, codomainDim>::getGlobalDofNormals(
     std::vector<Point3D<CoordinateType> >& normals) const 
 {
-    std::vector<Point3D<CoordinateType> > scalarDofNormals;
-    m_scalarSpace->getGlobalDofNormals(scalarDofNormals);
-    const size_t scalarDofCount = scalarDofNormals.size();
-    normals.resize(scalarDofCount * codomainDim);
-    for (size_t dof = 0; dof < scalarDofCount; ++dof)
-        for (size_t component = 0; component < codomainDim; ++component)
-            acc(normals, dof * codomainDim + component) = acc(scalarDofNormals, dof);
+    globalDofNormalsView().copyTo(normals);
 }
 
 template <typename BasisFunctionType, int codomainDim>
 void SimpleVectorSpace<BasisFunctionType, codomainDim>::getFlatLocalDofNormals(
     std::vector<Point3D<CoordinateType> >& normals) const 
 {
-    std::vector<Point3D<CoordinateType> > scalarDofNormals;
-    m_scalarSpace->getFlatLocalDofNormals(scalarDofNormals);
-    const size_t scalarDofCount = scalarDofNormals.size();
-    normals.resize(scalarDofCount * codomainDim);
-    for (size_t dof = 0; dof < scalarDofCount; ++dof)
-        for (size_t component = 0; component < codomainDim; ++component)
-            acc(normals, dof * codomainDim + component) = acc(scalarDofNormals, dof);
+    flatLocalDofNormalsView().copyTo(normals);
+}
+
+template <typename BasisFunctionType, int codomainDim>
+ReplicatedColumnView<typename SimpleVectorSpace<BasisFunctionType, codomainDim>::CoordinateType>
+SimpleVectorSpace<BasisFunctionType, codomainDim>::globalDofInterpolationPointsView() const
+{
+    return ReplicatedColumnView<CoordinateType>(
+        cachedScalarDofData(m_impl->scalarDofData->interpolationPoints, *m_scalarSpace,
+                            &Space<BasisFunctionType>::getGlobalDofInterpolationPoints),
+        codomainDim, m_impl->ordering);
+}
+
+template <typename BasisFunctionType, int codomainDim>
+ReplicatedColumnView<typename SimpleVectorSpace<BasisFunctionType, codomainDim>::CoordinateType>
+SimpleVectorSpace<BasisFunctionType, codomainDim>::normalsAtGlobalDofInterpolationPointsView() const
+{
+    return ReplicatedColumnView<CoordinateType>(
+        cachedScalarDofData(m_impl->scalarDofData->interpolationNormals, *m_scalarSpace,
+                            &Space<BasisFunctionType>::getNormalsAtGlobalDofInterpolationPoints),
+        codomainDim, m_impl->ordering);
+}
+
+template <typename BasisFunctionType, int codomainDim>
+ReplicatedArrayView<BoundingBox<typename SimpleVectorSpace<BasisFunctionType, codomainDim>::CoordinateType> >
+SimpleVectorSpace<BasisFunctionType, codomainDim>::globalDofBoundingBoxesView() const
+{
+    return ReplicatedArrayView<BoundingBox<CoordinateType> >(
+        cachedScalarDofData(m_impl->scalarDofData->globalDofBoundingBoxes, *m_scalarSpace,
+                            &Space<BasisFunctionType>::getGlobalDofBoundingBoxes),
+        codomainDim, m_impl->ordering);
+}
+
+template <typename BasisFunctionType, int codomainDim>
+ReplicatedArrayView<BoundingBox<typename SimpleVectorSpace<BasisFunctionType, codomainDim>::CoordinateType> >
+SimpleVectorSpace<BasisFunctionType, codomainDim>::flatLocalDofBoundingBoxesView() const
+{
+    return ReplicatedArrayView<BoundingBox<CoordinateType> >(
+        cachedScalarDofData(m_impl->scalarDofData->flatLocalDofBoundingBoxes, *m_scalarSpace,
+                            &Space<BasisFunctionType>::getFlatLocalDofBoundingBoxes),
+        codomainDim, m_impl->ordering);
+}
+
+template <typename BasisFunctionType, int codomainDim>
+ReplicatedArrayView<Point3D<typename SimpleVectorSpace<BasisFunctionType, codomainDim>::CoordinateType> >
+SimpleVectorSpace<BasisFunctionType, codomainDim>::globalDofPositionsView() const
+{
+    return ReplicatedArrayView<Point3D<CoordinateType> >(
+        cachedScalarDofData(m_impl->scalarDofData->globalDofPositions, *m_scalarSpace,
+                            &Space<BasisFunctionType>::getGlobalDofPositions),
+        codomainDim, m_impl->ordering);
+}
+
+template <typename BasisFunctionType, int codomainDim>
+ReplicatedArrayView<Point3D<typename SimpleVectorSpace<BasisFunctionType, codomainDim>::CoordinateType> >
+SimpleVectorSpace<BasisFunctionType, codomainDim>::flatLocalDofPositionsView() const
+{
+    return ReplicatedArrayView<Point3D<CoordinateType> >(
+        cachedScalarDofData(m_impl->scalarDofData->flatLocalDofPositions, *m_scalarSpace,
+                            &Space<BasisFunctionType>::getFlatLocalDofPositions),
+        codomainDim, m_impl->ordering);
+}
+
+template <typename BasisFunctionType, int codomainDim>
+ReplicatedArrayView<Point3D<typename SimpleVectorSpace<BasisFunctionType, codomainDim>::CoordinateType> >
+SimpleVectorSpace<BasisFunctionType, codomainDim>::globalDofNormalsView() const
+{
+    return ReplicatedArrayView<Point3D<CoordinateType> >(
+        cachedScalarDofData(m_impl->scalarDofData->globalDofNormals, *m_scalarSpace,
+                            &Space<BasisFunctionType>::getGlobalDofNormals),
+        codomainDim, m_impl->ordering);
+}
+
+template <typename BasisFunctionType, int codomainDim>
+ReplicatedArrayView<Point3D<typename SimpleVectorSpace<BasisFunctionType, codomainDim>::CoordinateType> >
+SimpleVectorSpace<BasisFunctionType, codomainDim>::flatLocalDofNormalsView() const
+{
+    return ReplicatedArrayView<Point3D<CoordinateType> >(
+        cachedScalarDofData(m_impl->scalarDofData->flatLocalDofNormals, *m_scalarSpace,
+                            &Space<BasisFunctionType>::getFlatLocalDofNormals),
+        codomainDim, m_impl->ordering);
 }
 
 template <typename BasisFunctionType, int codomainDim>
@@ -331,11 +453,144 @@ void SimpleVectorSpace<BasisFunctionType, codomainDim>::dumpClusterIds(
     const char* fileName,
     const std::vector<unsigned int>& clusterIdsOfGlobalDofs) const
 {
-    throw std::runtime_error("SimpleVectorSpace::dumpClusterIds(): not implemented");
+    // The scalar space writes the files, labelling each point with the
+    // cluster of the given component of the DOF located there
+    std::vector<unsigned int> scalarClusterIds;
+    for (int d = 0; d < codomainDim; ++d) {
+        projectVectorClusterIds(clusterIdsOfGlobalDofs, codomainDim,
+                                scalarClusterIds, m_impl->ordering, d);
+        std::ostringstream componentFileName;
+        componentFileName << fileName << "_component" << d;
+        m_scalarSpace->dumpClusterIds(componentFileName.str().c_str(),
+                                      scalarClusterIds);
+    }
+}
+
+template <typename BasisFunctionType, int codomainDim>
+const Fiber::Shapeset<BasisFunctionType>*
+SimpleVectorSpace<BasisFunctionType, codomainDim>::scalarShapeset(
+    size_t elementIndex) const
+{
+    // The scalar space can only be queried by element
+    return 0;
+}
+
+template <typename BasisFunctionType, int codomainDim>
+DofOrdering SimpleVectorSpace<BasisFunctionType, codomainDim>::dofOrdering() const
+{
+    return m_impl->ordering;
+}
+
+template <typename BasisFunctionType, int codomainDim>
+shared_ptr<const GridSegmentElementList>
+SimpleVectorSpace<BasisFunctionType, codomainDim>::elementList() const
+{
+    return m_impl->elements;
+}
+
+template <typename BasisFunctionType, int codomainDim>
+shared_ptr<const DofTransferOperator<BasisFunctionType> >
+SimpleVectorSpace<BasisFunctionType, codomainDim>::componentExtractor(
+    int component) const
+{
+    if (component < 0 || component >= codomainDim)
+        throw std::invalid_argument("SimpleVectorSpace::componentExtractor(): "
+                                    "invalid component");
+    LazySharedPtr<const DofTransferOperator<BasisFunctionType> >& cache =
+        m_impl->transfers->extractors[component];
+    shared_ptr<const DofTransferOperator<BasisFunctionType> > extractor =
+        cache.get();
+    if (!extractor) {
+        typename LazySharedPtr<const DofTransferOperator<BasisFunctionType> >::
+                Initializer initializer(cache);
+        extractor = initializer.value();
+        if (!extractor)
+            extractor = initializer.publish(componentExtractionOperator(*this, component));
+    }
+    return extractor;
+}
+
+template <typename BasisFunctionType, int codomainDim>
+shared_ptr<const DofTransferOperator<BasisFunctionType> >
+SimpleVectorSpace<BasisFunctionType, codomainDim>::componentInjector(
+    int component) const
+{
+    if (component < 0 || component >= codomainDim)
+        throw std::invalid_argument("SimpleVectorSpace::componentInjector(): "
+                                    "invalid component");
+    LazySharedPtr<const DofTransferOperator<BasisFunctionType> >& cache =
+        m_impl->transfers->injectors[component];
+    shared_ptr<const DofTransferOperator<BasisFunctionType> > injector =
+        cache.get();
+    if (!injector) {
+        typename LazySharedPtr<const DofTransferOperator<BasisFunctionType> >::
+                Initializer initializer(cache);
+        injector = initializer.value();
+        if (!injector)
+            injector = initializer.publish(componentInjectionOperator(*this, component));
+    }
+    return injector;
+}
+
+template <typename BasisFunctionType, int codomainDim>
+VectorInterpolationData<typename SimpleVectorSpace<BasisFunctionType, codomainDim>::CoordinateType>
+SimpleVectorSpace<BasisFunctionType, codomainDim>::interpolationData(
+    bool withNormals) const
+{
+    shared_ptr<const arma::Mat<CoordinateType> > points =
+        cachedScalarDofData(m_impl->scalarDofData->interpolationPoints, *m_scalarSpace,
+                            &Space<BasisFunctionType>::getGlobalDofInterpolationPoints);
+    shared_ptr<const arma::Mat<CoordinateType> > normals;
+    if (withNormals)
+        normals = cachedScalarDofData(
+                    m_impl->scalarDofData->interpolationNormals, *m_scalarSpace,
+                    &Space<BasisFunctionType>::getNormalsAtGlobalDofInterpolationPoints);
+    else
+        normals = boost::make_shared<arma::Mat<CoordinateType> >();
+    return VectorInterpolationData<CoordinateType>(
+        points, normals, codomainDim, m_impl->ordering);
+}
+
+template <typename BasisFunctionType>
+shared_ptr<const Space<BasisFunctionType> > scalarSpaceOf(
+    const Space<BasisFunctionType>& space)
+{
+    if (const SimpleVectorSpaceBase<BasisFunctionType>* vectorSpace =
+            dynamic_cast<const SimpleVectorSpaceBase<BasisFunctionType>*>(&space))
+        return vectorSpace->scalarSpace();
+    return shared_ptr<const Space<BasisFunctionType> >();
+}
+
+template <typename BasisFunctionType>
+shared_ptr<const GridSegmentElementList> elementListOf(
+    const Space<BasisFunctionType>& space)
+{
+    if (const SimpleVectorSpaceBase<BasisFunctionType>* vectorSpace =
+            dynamic_cast<const SimpleVectorSpaceBase<BasisFunctionType>*>(&space))
+        return vectorSpace->elementList();
+    return shared_ptr<const GridSegmentElementList>();
+}
+
+template <typename BasisFunctionType>
+DofOrdering dofOrderingOf(const Space<BasisFunctionType>& space)
+{
+    if (const SimpleVectorSpaceBase<BasisFunctionType>* vectorSpace =
+            dynamic_cast<const SimpleVectorSpaceBase<BasisFunctionType>*>(&space))
+        return vectorSpace->dofOrdering();
+    return INTERLEAVED_DOFS;
 }
 
+#define INSTANTIATE_SIMPLE_VECTOR_SPACE_WITH_DIM(BASIS, DIM) \
+    template class SimpleVectorSpace< BASIS, DIM >
 #define INSTANTIATE_SIMPLE_VECTOR_SPACE(BASIS) \
-    template class SimpleVectorSpace< BASIS, 3 >;
+    SIMPLE_VECTOR_SPACE_ITERATE_OVER_CODOMAIN_DIMS( \
+        INSTANTIATE_SIMPLE_VECTOR_SPACE_WITH_DIM, BASIS); \
+    template shared_ptr<const Space< BASIS > > scalarSpaceOf( \
+        const Space< BASIS >& space); \
+    template shared_ptr<const GridSegmentElementList> elementListOf( \
+        const Space< BASIS >& space); \
+    template DofOrdering dofOrderingOf( \
+        const Space< BASIS >& space);
 FIBER_ITERATE_OVER_BASIS_TYPES(INSTANTIATE_SIMPLE_VECTOR_SPACE);
 
 } // namespace Bempp
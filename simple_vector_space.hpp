@@ -21,23 +21,143 @@
 #ifndef simple_vector_space_hpp
 #define simple_vector_space_hpp
 
+#include "dof_ordering.hpp"
+#include "element_dof_table.hpp"
+#include "grid_segment_element_list.hpp"
+#include "local_dof_table.hpp"
+#include "replicated_array_view.hpp"
+#include "vector_interpolation.hpp"
+
 #include "space/space.hpp"
 
+#include <boost/make_shared.hpp>
 #include <boost/scoped_ptr.hpp>
 
+/** \brief Invoke <tt>MACRO(BASIS, codomainDim)</tt> for each number of
+ *  components for which the vector spaces are instantiated. */
+#define SIMPLE_VECTOR_SPACE_ITERATE_OVER_CODOMAIN_DIMS(MACRO, BASIS) \
+    MACRO(BASIS, 2); \
+    MACRO(BASIS, 3); \
+    MACRO(BASIS, 6); \
+    MACRO(BASIS, 9)
+
 namespace Bempp
 {
 
-template <typename BasisFunctionType, int codomainDim>
-class SimpleVectorSpace : public Space<BasisFunctionType>
+template <typename BasisFunctionType> class DofTransferOperator;
+
+/** \brief Part of the interface of SimpleVectorSpace independent from the
+ *  number of components.
+ *
+ *  Code handling vector spaces with any number of components, such as
+ *  scalarSpaceOf(), casts a Space to this class. */
+template <typename BasisFunctionType>
+class SimpleVectorSpaceBase : public Space<BasisFunctionType>
 {
     typedef Space<BasisFunctionType> Base;
 public:
     typedef typename Base::CoordinateType CoordinateType;
+
+    explicit SimpleVectorSpaceBase(const shared_ptr<const Grid>& grid) :
+        Base(grid)
+    {}
+
+    SimpleVectorSpaceBase(const SimpleVectorSpaceBase& other) :
+        Base(other)
+    {}
+
+    virtual ~SimpleVectorSpaceBase()
+    {}
+
+    /** \brief Scalar space whose basis functions are copied to each vector
+     *  component. */
+    virtual shared_ptr<const Space<BasisFunctionType> > scalarSpace() const = 0;
+
+    /** \brief List of the elements carrying DOFs, or a null pointer if the
+     *  space is not restricted to a grid segment. */
+    virtual shared_ptr<const GridSegmentElementList> elementList() const = 0;
+
+    /** \brief Scalar shapeset attached to the element with leaf-view index
+     *  \p elementIndex, i.e. the shapeset of the non-zero components of the
+     *  basis functions attached to this element.
+     *
+     *  Returns a null pointer if the shapeset can only be obtained from the
+     *  element itself, through the shapeset() member of scalarSpace(). */
+    virtual const Fiber::Shapeset<BasisFunctionType>* scalarShapeset(
+            size_t elementIndex) const = 0;
+
+    /** \brief Numbering of the DOFs of this space. */
+    virtual DofOrdering dofOrdering() const = 0;
+
+    /** \brief Precomputed element-to-DOF table of this space. */
+    virtual const ElementDofTable<BasisFunctionType>& elementDofTable() const = 0;
+
+    using Base::global2localDofs;
+
+    /** \brief Map global DOFs to local DOFs, storing the result in flat
+     *  arrays owned by the caller.
+     *
+     *  See LocalDofTable::global2localDofs() for the output format. */
+    virtual void global2localDofs(
+            const GlobalDofIndex* globalDofs, size_t globalDofCount,
+            std::vector<size_t>& offsets,
+            std::vector<LocalDof>& localDofs,
+            std::vector<BasisFunctionType>& localDofWeights) const = 0;
+
+    /** \brief Operator extracting the coefficients of the component \p
+     *  component of functions from this space.
+     *
+     *  See componentExtractionOperator(). The operator is built on first use
+     *  and cached. */
+    virtual shared_ptr<const DofTransferOperator<BasisFunctionType> >
+    componentExtractor(int component) const = 0;
+
+    /** \brief Operator injecting functions from the scalar space into the
+     *  component \p component of this space.
+     *
+     *  See componentInjectionOperator(). The operator is built on first use
+     *  and cached. */
+    virtual shared_ptr<const DofTransferOperator<BasisFunctionType> >
+    componentInjector(int component) const = 0;
+
+    /** \brief Interpolation points, normals and directions of the DOFs.
+     *
+     *  Unlike getGlobalDofInterpolationPoints(),
+     *  getNormalsAtGlobalDofInterpolationPoints() and
+     *  getGlobalDofInterpolationDirections(), this function stores only the
+     *  data of the scalar space. If \p withNormals is \c false, the normals
+     *  are not computed. See also interpolateOnVectorSpace(). */
+    virtual VectorInterpolationData<CoordinateType> interpolationData(
+            bool withNormals = true) const = 0;
+};
+
+template <typename BasisFunctionType, int codomainDim>
+class SimpleVectorSpace : public SimpleVectorSpaceBase<BasisFunctionType>
+{
+    typedef SimpleVectorSpaceBase<BasisFunctionType> Base;
+public:
+    typedef typename Base::CoordinateType CoordinateType;
     typedef typename Base::CollectionOfShapesetTransformations
     CollectionOfShapesetTransformations;
 
-    explicit SimpleVectorSpace(const shared_ptr<Space<BasisFunctionType> > &scalarSpace);
+    /** \brief Constructor.
+     *
+     *  Construct a vector space whose basis functions are those of \p
+     *  scalarSpace copied to each of the \p codomainDim components. The DOFs
+     *  are numbered according to \p ordering. */
+    explicit SimpleVectorSpace(const shared_ptr<Space<BasisFunctionType> > &scalarSpace,
+                               DofOrdering ordering = INTERLEAVED_DOFS);
+
+    /** \brief Constructor.
+     *
+     *  Construct a vector space whose basis functions are supported only on
+     *  the elements listed in \p elements. \p scalarSpace must not attach
+     *  any DOFs to other elements. The element-to-DOF map is built by
+     *  visiting only the listed elements. If \p elements is a null pointer,
+     *  the space is not restricted. */
+    SimpleVectorSpace(const shared_ptr<Space<BasisFunctionType> > &scalarSpace,
+                      const shared_ptr<const GridSegmentElementList>& elements,
+                      DofOrdering ordering = INTERLEAVED_DOFS);
 
     SimpleVectorSpace(const SimpleVectorSpace& other);
 
@@ -67,21 +187,57 @@ public:
                                std::vector<GlobalDofIndex>& dofs,
                                std::vector<BasisFunctionType>& localDofWeights) const;
 
+    /** \brief Return the global DOFs of the elements with leaf-view indices
+     *  <tt>[beginElementIndex, endElementIndex)</tt>.
+     *
+     *  The returned range points into the precomputed element-to-DOF table of
+     *  this space; no memory is allocated. */
+    ElementDofRange<BasisFunctionType> globalDofsOfElements(
+            size_t beginElementIndex, size_t endElementIndex) const;
+
+    virtual const ElementDofTable<BasisFunctionType>& elementDofTable() const;
+
     virtual void global2localDofs(
             const std::vector<GlobalDofIndex>& globalDofs,
             std::vector<std::vector<LocalDof> >& localDofs,
             std::vector<std::vector<BasisFunctionType> >& localDofWeights) const;
 
+    /** \brief Map global DOFs to local DOFs, storing the result in flat
+     *  arrays owned by the caller.
+     *
+     *  See LocalDofTable::global2localDofs() for the output format. The
+     *  maps are precomputed, so no temporary storage is needed; if the
+     *  caller reuses the output vectors, the function does not allocate
+     *  memory. */
+    virtual void global2localDofs(
+            const GlobalDofIndex* globalDofs, size_t globalDofCount,
+            std::vector<size_t>& offsets,
+            std::vector<LocalDof>& localDofs,
+            std::vector<BasisFunctionType>& localDofWeights) const;
+
     virtual void flatLocal2localDofs(
             const std::vector<FlatLocalDofIndex>& flatLocalDofs,
             std::vector<LocalDof>& localDofs) const;
 
+    /** \brief Map the \p flatLocalDofCount flat local DOFs pointed to by \p
+     *  flatLocalDofs to local DOFs, stored in the caller-owned array \p
+     *  localDofs. No memory is allocated. */
+    void flatLocal2localDofs(
+            const FlatLocalDofIndex* flatLocalDofs, size_t flatLocalDofCount,
+            LocalDof* localDofs) const;
+
     virtual void getGlobalDofInterpolationPoints(
         arma::Mat<CoordinateType>& points) const;
 
     virtual void getNormalsAtGlobalDofInterpolationPoints(
         arma::Mat<CoordinateType>& normals) const;
 
+    /** \brief Return the interpolation directions of the DOFs as a dense
+     *  matrix.
+     *
+     *  The matrix has \p codomainDim times as many columns as the scalar
+     *  space has DOFs, and only one non-zero entry per column; prefer
+     *  interpolationData() for large spaces. */
     virtual void getGlobalDofInterpolationDirections(
         arma::Mat<CoordinateType>& directions) const;
 
@@ -103,14 +259,63 @@ public:
     virtual void getFlatLocalDofNormals(
         std::vector<Point3D<CoordinateType> >& normals) const;
 
+    /** \name Views of geometrical data attached to DOFs
+     *
+     *  These functions return the same data as the corresponding get...()
+     *  functions, but without storing \p codomainDim copies of each entry:
+     *  the returned views hold only the data of the scalar space and map the
+     *  index \p i to the scalar DOF it belongs to, as given by
+     *  dofNumbering(). The data of the scalar space are fetched on first use
+     *  and shared by all views, as well as by the get...() functions, which
+     *  only expand them.
+     *  @{ */
+    ReplicatedColumnView<CoordinateType> globalDofInterpolationPointsView() const;
+    ReplicatedColumnView<CoordinateType> normalsAtGlobalDofInterpolationPointsView() const;
+    ReplicatedArrayView<BoundingBox<CoordinateType> > globalDofBoundingBoxesView() const;
+    ReplicatedArrayView<BoundingBox<CoordinateType> > flatLocalDofBoundingBoxesView() const;
+    ReplicatedArrayView<Point3D<CoordinateType> > globalDofPositionsView() const;
+    ReplicatedArrayView<Point3D<CoordinateType> > flatLocalDofPositionsView() const;
+    ReplicatedArrayView<Point3D<CoordinateType> > globalDofNormalsView() const;
+    ReplicatedArrayView<Point3D<CoordinateType> > flatLocalDofNormalsView() const;
+    /** @} */
+
+    /** \brief Write the cluster ids of the DOFs to files, one per
+     *  component.
+     *
+     *  The files are written by the scalar space. The cluster ids of
+     *  component \c d are written to the file named \p fileName followed by
+     *  <tt>_component</tt>\c d, in which each point is labelled with the
+     *  cluster id of component \c d of the DOF located there. The components
+     *  of a DOF belong to different clusters if the cluster tree was built by
+     *  the H-matrix assembler on the vector space. */
     BEMPP_DEPRECATED virtual void dumpClusterIds(
             const char* fileName,
             const std::vector<unsigned int>& clusterIdsOfGlobalDofs) const;
 
-protected:
-    shared_ptr<Space<BasisFunctionType> > scalarSpace() { return m_scalarSpace; }
+    virtual shared_ptr<const Space<BasisFunctionType> > scalarSpace() const { return m_scalarSpace; }
+
+    virtual shared_ptr<const GridSegmentElementList> elementList() const;
+
+    virtual const Fiber::Shapeset<BasisFunctionType>* scalarShapeset(
+            size_t elementIndex) const;
+
+    virtual DofOrdering dofOrdering() const;
 
-    shared_ptr<const Space<BasisFunctionType> > scalarSpace() const { return m_scalarSpace; }
+    virtual shared_ptr<const DofTransferOperator<BasisFunctionType> >
+    componentExtractor(int component) const;
+
+    virtual shared_ptr<const DofTransferOperator<BasisFunctionType> >
+    componentInjector(int component) const;
+
+    virtual VectorInterpolationData<CoordinateType> interpolationData(
+            bool withNormals = true) const;
+
+    /** \brief Map between the DOFs of this space and those of the scalar
+     *  space. */
+    VectorDofNumbering dofNumbering() const {
+        return VectorDofNumbering(dofOrdering(), codomainDim,
+                                  m_scalarSpace->globalDofCount());
+    }
 
 private:
     /** \cond PRIVATE*/
@@ -121,6 +326,24 @@ private:
     /** \endcond */
 };
 
+/** \brief Return the scalar space underlying \p space if \p space is a
+ *  SimpleVectorSpace, or a null pointer otherwise. */
+template <typename BasisFunctionType>
+shared_ptr<const Space<BasisFunctionType> > scalarSpaceOf(
+        const Space<BasisFunctionType>& space);
+
+/** \brief Return the list of the elements carrying DOFs of \p space if \p
+ *  space is a SimpleVectorSpace restricted to a grid segment, or a null
+ *  pointer otherwise. */
+template <typename BasisFunctionType>
+shared_ptr<const GridSegmentElementList> elementListOf(
+        const Space<BasisFunctionType>& space);
+
+/** \brief Return the DOF ordering of \p space if \p space is a
+ *  SimpleVectorSpace, or INTERLEAVED_DOFS otherwise. */
+template <typename BasisFunctionType>
+DofOrdering dofOrderingOf(const Space<BasisFunctionType>& space);
+
 } // namespace Bempp
 
 #endif
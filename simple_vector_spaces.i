@@ -4,11 +4,106 @@
 #include <numpy/arrayobject.h>
 #include "piecewise_constant_vector_space.hpp"
 #include "piecewise_linear_continuous_vector_space.hpp"
+#include "kronecker_discrete_boundary_operator.hpp"
 #include "piecewise_linear_discontinuous_vector_space.hpp"
+#include "python_batch_functor.hpp"
+#include "vector_interpolation.hpp"
+
+#include "assembly/boundary_operator.hpp"
+#include "assembly/discrete_boundary_operator.hpp"
+#include "fiber/function.hpp"
+
+#include <stdexcept>
+#include <string>
 %}
 
 %include "bempp.swg"
 
+%init %{
+    import_array();
+%}
+
+%{
+namespace Bempp
+{
+
+    template <typename BasisFunctionType, int codomainDim>
+        boost::shared_ptr< Space< BasisFunctionType > >
+        makePiecewiseConstantVectorSpace(
+            const boost::shared_ptr<const Grid>& grid,
+            const GridSegment* segment,
+            DofOrdering ordering)
+    {
+        typedef PiecewiseConstantVectorSpace<BasisFunctionType, codomainDim> Type;
+        if (segment)
+            return boost::shared_ptr<Type>(new Type(grid, *segment, ordering));
+        else
+            return boost::shared_ptr<Type>(new Type(grid, ordering));
+    }
+
+    template <typename BasisFunctionType, int codomainDim>
+        boost::shared_ptr< Space< BasisFunctionType > >
+        makePiecewiseLinearContinuousVectorSpace(
+            const boost::shared_ptr<const Grid>& grid,
+            const GridSegment* segment,
+            bool strictlyOnSegment,
+            DofOrdering ordering)
+    {
+        typedef PiecewiseLinearContinuousVectorSpace<BasisFunctionType, codomainDim> Type;
+        if (segment)
+            return boost::shared_ptr<Type>(
+                new Type(grid, *segment, strictlyOnSegment, ordering));
+        else
+            return boost::shared_ptr<Type>(new Type(grid, ordering));
+    }
+
+    template <typename BasisFunctionType, int codomainDim>
+        boost::shared_ptr< Space< BasisFunctionType > >
+        makePiecewiseLinearDiscontinuousVectorSpace(
+            const boost::shared_ptr<const Grid>& grid,
+            const GridSegment* segment,
+            bool strictlyOnSegment,
+            DofOrdering ordering)
+    {
+        typedef PiecewiseLinearDiscontinuousVectorSpace<BasisFunctionType, codomainDim> Type;
+        if (segment)
+            return boost::shared_ptr<Type>(
+                new Type(grid, *segment, strictlyOnSegment, ordering));
+        else
+            return boost::shared_ptr<Type>(new Type(grid, ordering));
+    }
+
+    template <typename BasisFunctionType>
+        const SimpleVectorSpaceBase<BasisFunctionType>& vectorSpaceOf(
+            const Space<BasisFunctionType>& space, const char* function)
+    {
+        const SimpleVectorSpaceBase<BasisFunctionType>* vectorSpace =
+            dynamic_cast<const SimpleVectorSpaceBase<BasisFunctionType>*>(&space);
+        if (!vectorSpace)
+            throw std::invalid_argument(
+                std::string(function) + ": space must be a vector space "
+                "created by this module");
+        return *vectorSpace;
+    }
+
+    inline void throwUnsupportedCodomainDimension(const char* function)
+    {
+        throw std::invalid_argument(
+            std::string(function) + ": unsupported number of components "
+            "(supported: 2, 3, 6 and 9)");
+    }
+}
+%}
+
+namespace Bempp
+{
+    enum DofOrdering
+    {
+        INTERLEAVED_DOFS,
+        BLOCKED_DOFS
+    };
+}
+
 %inline %{
 namespace Bempp
 {
@@ -17,13 +112,22 @@ namespace Bempp
         boost::shared_ptr< Space< BasisFunctionType > >
         piecewiseConstantVectorSpace(
             const boost::shared_ptr<const Grid>& grid,
-            const GridSegment* segment = 0)
+            const GridSegment* segment = 0,
+            int codomainDim = 3,
+            DofOrdering ordering = INTERLEAVED_DOFS)
     {
-        typedef PiecewiseConstantVectorSpace<BasisFunctionType, 3> Type;
-        if (segment)
-            return boost::shared_ptr<Type>(new Type(grid, *segment));
-        else
-            return boost::shared_ptr<Type>(new Type(grid));
+        switch (codomainDim) {
+        case 2: return makePiecewiseConstantVectorSpace<BasisFunctionType, 2>(
+                    grid, segment, ordering);
+        case 3: return makePiecewiseConstantVectorSpace<BasisFunctionType, 3>(
+                    grid, segment, ordering);
+        case 6: return makePiecewiseConstantVectorSpace<BasisFunctionType, 6>(
+                    grid, segment, ordering);
+        case 9: return makePiecewiseConstantVectorSpace<BasisFunctionType, 9>(
+                    grid, segment, ordering);
+        }
+        throwUnsupportedCodomainDimension("piecewiseConstantVectorSpace()");
+        return boost::shared_ptr< Space< BasisFunctionType > >();
     }
 
     template <typename BasisFunctionType>
@@ -31,13 +135,22 @@ namespace Bempp
         piecewiseLinearContinuousVectorSpace(
             const boost::shared_ptr<const Grid>& grid,
             const GridSegment* segment = 0,
-            bool strictlyOnSegment = false)
+            bool strictlyOnSegment = false,
+            int codomainDim = 3,
+            DofOrdering ordering = INTERLEAVED_DOFS)
     {
-        typedef PiecewiseLinearContinuousVectorSpace<BasisFunctionType, 3> Type;
-        if (segment)
-            return boost::shared_ptr<Type>(new Type(grid, *segment, strictlyOnSegment));
-        else
-            return boost::shared_ptr<Type>(new Type(grid));
+        switch (codomainDim) {
+        case 2: return makePiecewiseLinearContinuousVectorSpace<BasisFunctionType, 2>(
+                    grid, segment, strictlyOnSegment, ordering);
+        case 3: return makePiecewiseLinearContinuousVectorSpace<BasisFunctionType, 3>(
+                    grid, segment, strictlyOnSegment, ordering);
+        case 6: return makePiecewiseLinearContinuousVectorSpace<BasisFunctionType, 6>(
+                    grid, segment, strictlyOnSegment, ordering);
+        case 9: return makePiecewiseLinearContinuousVectorSpace<BasisFunctionType, 9>(
+                    grid, segment, strictlyOnSegment, ordering);
+        }
+        throwUnsupportedCodomainDimension("piecewiseLinearContinuousVectorSpace()");
+        return boost::shared_ptr< Space< BasisFunctionType > >();
     }
 
     template <typename BasisFunctionType>
@@ -45,13 +158,22 @@ namespace Bempp
         piecewiseLinearDiscontinuousVectorSpace(
             const boost::shared_ptr<const Grid>& grid,
             const GridSegment* segment = 0,
-            bool strictlyOnSegment = false)
+            bool strictlyOnSegment = false,
+            int codomainDim = 3,
+            DofOrdering ordering = INTERLEAVED_DOFS)
     {
-        typedef PiecewiseLinearDiscontinuousVectorSpace<BasisFunctionType, 3> Type;
-        if (segment)
-            return boost::shared_ptr<Type>(new Type(grid, *segment, strictlyOnSegment));
-        else
-            return boost::shared_ptr<Type>(new Type(grid));
+        switch (codomainDim) {
+        case 2: return makePiecewiseLinearDiscontinuousVectorSpace<BasisFunctionType, 2>(
+                    grid, segment, strictlyOnSegment, ordering);
+        case 3: return makePiecewiseLinearDiscontinuousVectorSpace<BasisFunctionType, 3>(
+                    grid, segment, strictlyOnSegment, ordering);
+        case 6: return makePiecewiseLinearDiscontinuousVectorSpace<BasisFunctionType, 6>(
+                    grid, segment, strictlyOnSegment, ordering);
+        case 9: return makePiecewiseLinearDiscontinuousVectorSpace<BasisFunctionType, 9>(
+                    grid, segment, strictlyOnSegment, ordering);
+        }
+        throwUnsupportedCodomainDimension("piecewiseLinearDiscontinuousVectorSpace()");
+        return boost::shared_ptr< Space< BasisFunctionType > >();
     }
 }
 %}
@@ -63,3 +185,140 @@ namespace Bempp
 %template(createPiecewiseLinearContinuousVectorSpace) Bempp::piecewiseLinearContinuousVectorSpace<double>;
 %template(createPiecewiseLinearDiscontinuousVectorSpace) Bempp::piecewiseLinearDiscontinuousVectorSpace<double>;
 
+%inline %{
+namespace Bempp
+{
+template <typename BasisFunctionType, typename ResultType>
+void _interpolateOnVectorSpace(
+        const Space<BasisFunctionType>& space,
+        const Fiber::Function<ResultType>& function,
+        arma::Col<ResultType>& result)
+{
+    interpolateOnVectorSpace(
+        vectorSpaceOf(space, "interpolateOnVectorSpace()"), function, result);
+}
+
+// The callable is called from the worker threads, so the GIL is released
+// while the interpolation runs
+template <typename BasisFunctionType, typename ResultType>
+void _interpolateCallableOnVectorSpace(
+        const Space<BasisFunctionType>& space,
+        PyObject* callable,
+        bool dependsOnNormals,
+        arma::Col<ResultType>& result)
+{
+    const BatchFunction<PythonBatchFunctor<ResultType> > function(
+        PythonBatchFunctor<ResultType>(
+            callable, space.grid()->dimWorld(), space.codomainDimension(),
+            dependsOnNormals));
+    const SimpleVectorSpaceBase<BasisFunctionType>& vectorSpace =
+        vectorSpaceOf(space, "interpolateOnVectorSpace()");
+    ScopedGilRelease gilRelease;
+    interpolateOnVectorSpace(vectorSpace, function, result);
+}
+}
+%}
+
+namespace Bempp
+{
+
+%apply arma::Col<float>& ARGOUT_COL { arma::Col<float>& result };
+%apply arma::Col<double>& ARGOUT_COL { arma::Col<double>& result };
+%apply arma::Col<std::complex<float> >& ARGOUT_COL { arma::Col<std::complex<float> >& result };
+%apply arma::Col<std::complex<double> >& ARGOUT_COL { arma::Col<std::complex<double> >& result };
+
+BEMPP_INSTANTIATE_SYMBOL_TEMPLATED_ON_BASIS_AND_RESULT(_interpolateOnVectorSpace);
+BEMPP_INSTANTIATE_SYMBOL_TEMPLATED_ON_BASIS_AND_RESULT(_interpolateCallableOnVectorSpace);
+
+%clear arma::Col<float>& result;
+%clear arma::Col<double>& result;
+%clear arma::Col<std::complex<float> >& result;
+%clear arma::Col<std::complex<double> >& result;
+}
+
+%inline %{
+namespace Bempp
+{
+// The scalar operator passed to kroneckerWeakForm() must be defined on the
+// scalar spaces of the vector spaces
+template <typename BasisFunctionType>
+boost::shared_ptr<Space<BasisFunctionType> > scalarSpaceOfVectorSpace(
+        const Space<BasisFunctionType>& space)
+{
+    return boost::const_pointer_cast<Space<BasisFunctionType> >(
+        scalarSpaceOf(vectorSpaceOf(space, "scalarSpaceOfVectorSpace()")));
+}
+
+template <typename BasisFunctionType, typename ResultType>
+boost::shared_ptr<const DiscreteBoundaryOperator<ResultType> >
+_kroneckerWeakForm(
+        const BoundaryOperator<BasisFunctionType, ResultType>& scalarOperator,
+        const Space<BasisFunctionType>& domain,
+        const Space<BasisFunctionType>& dualToRange)
+{
+    return kroneckerWeakForm(scalarOperator, domain, dualToRange);
+}
+}
+%}
+
+namespace Bempp
+{
+BEMPP_INSTANTIATE_SYMBOL_TEMPLATED_ON_BASIS_AND_RESULT(_kroneckerWeakForm);
+}
+
+%template(scalarSpaceOfVectorSpace) Bempp::scalarSpaceOfVectorSpace<double>;
+
+%pythoncode %{
+    def interpolateOnVectorSpace(space, function, resultType=None,
+                                 dependsOnNormals=False):
+        """Interpolate function on the vector space space.
+
+        function is either a wrapped Fiber::Function object or a Python
+        callable. A callable is called once per chunk of interpolation
+        points as function(points, normals), where points and normals are
+        arrays of shape (worldDimension, n) with the coordinates of the n
+        points of the chunk and the normals at these points (normals is None
+        unless dependsOnNormals is True). It must return an array of shape
+        (codomainDimension, n) with the function values at these points.
+        resultType defaults to the basis function type of space."""
+        import bempp.lib
+        basisFunctionType = space.basisFunctionType()
+        if resultType is None:
+            resultType = basisFunctionType
+        if callable(function):
+            prefix = "_interpolateCallableOnVectorSpace_"
+            args = (space, function, dependsOnNormals)
+        else:
+            prefix = "_interpolateOnVectorSpace_"
+            args = (space, function)
+        fullName = (prefix +
+                    bempp.lib.checkType(basisFunctionType) + "_" +
+                    bempp.lib.checkType(resultType))
+        try:
+            func = globals()[fullName]
+        except KeyError:
+            raise TypeError("Function " + fullName + " does not exist.")
+        return func(*args)
+
+    def kroneckerWeakForm(scalarOperator, domain, dualToRange):
+        """Return the weak form of scalarOperator acting componentwise on
+        the vector spaces domain and dualToRange.
+
+        If domain and dualToRange are vector spaces created by this module
+        with the same number of components, and their scalar spaces are the
+        domain and the dual to range of scalarOperator (see
+        scalarSpaceOfVectorSpace), return the discrete
+        operator I (x) A, A being the weak form of scalarOperator. Only A
+        is stored; it is assembled on first use and shared with
+        scalarOperator. Otherwise return None."""
+        import bempp.lib
+        fullName = ("_kroneckerWeakForm_" +
+                    bempp.lib.checkType(scalarOperator.basisFunctionType()) +
+                    "_" +
+                    bempp.lib.checkType(scalarOperator.resultType()))
+        try:
+            func = globals()[fullName]
+        except KeyError:
+            raise TypeError("Function " + fullName + " does not exist.")
+        return func(scalarOperator, domain, dualToRange)
+%}
@@ -0,0 +1,218 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef simple_vector_test_kernel_trial_integral_hpp
+#define simple_vector_test_kernel_trial_integral_hpp
+
+#include "common/common.hpp"
+
+#include "fiber/collection_of_3d_arrays.hpp"
+#include "fiber/collection_of_4d_arrays.hpp"
+#include "fiber/geometrical_data.hpp"
+#include "fiber/scalar_traits.hpp"
+#include "fiber/test_kernel_trial_integral.hpp"
+
+#include <cassert>
+#include <stdexcept>
+#include <tbb/enumerable_thread_specific.h>
+#include <vector>
+
+namespace Fiber
+{
+
+/** \brief Integral <tt>\int\int phi(x)^T K(x, y) psi(y) dx dy</tt> of a
+ *  matrix-valued kernel between the functions of two SimpleVectorSpace
+ *  objects with \p dim components.
+ *
+ *  The kernel \p K is the first kernel of the collection; its values are
+ *  <tt>dim x dim</tt> matrices, whose off-diagonal entries couple different
+ *  components (as in tensor Green's functions or kernels of double-layer
+ *  type involving cross products). The test and trial functions are the
+ *  first transformations of their collections, which must be the plain
+ *  function values, e.g. SimpleVectorSpace::basisFunctionValue().
+ *
+ *  Each basis function of a SimpleVectorSpace has a single non-zero
+ *  component, the one with index <tt>f % dim</tt> for the local function \p
+ *  f. The integral of the test function \p f and the trial function \p g
+ *  therefore needs only the kernel entry <tt>K(f % dim, g % dim)</tt>, and
+ *  this class evaluates only that entry instead of the full contraction of
+ *  the two vectors with the kernel matrix, which would cost <tt>dim *
+ *  dim</tt> times as many operations.
+ *
+ *  An object of this class can be used wherever a TestKernelTrialIntegral
+ *  is expected, in particular to construct integral operators acting on
+ *  SimpleVectorSpace objects. */
+template <typename BasisFunctionType_, typename KernelType_,
+          typename ResultType_, int dim>
+class SimpleVectorTestKernelTrialIntegral :
+        public TestKernelTrialIntegral<BasisFunctionType_, KernelType_, ResultType_>
+{
+    typedef TestKernelTrialIntegral<BasisFunctionType_, KernelType_, ResultType_>
+    Base;
+public:
+    typedef BasisFunctionType_ BasisFunctionType;
+    typedef KernelType_ KernelType;
+    typedef ResultType_ ResultType;
+    typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+
+    virtual void addGeometricalDependencies(
+            size_t& testGeomDeps, size_t& trialGeomDeps) const {
+        testGeomDeps |= INTEGRATION_ELEMENTS;
+        trialGeomDeps |= INTEGRATION_ELEMENTS;
+    }
+
+    virtual void evaluateWithTensorQuadratureRule(
+            const GeometricalData<CoordinateType>& testGeomData,
+            const GeometricalData<CoordinateType>& trialGeomData,
+            const CollectionOf3dArrays<BasisFunctionType>& testValues,
+            const CollectionOf3dArrays<BasisFunctionType>& trialValues,
+            const CollectionOf4dArrays<KernelType>& kernelValues,
+            const std::vector<CoordinateType>& testQuadWeights,
+            const std::vector<CoordinateType>& trialQuadWeights,
+            arma::Mat<ResultType>& result) const {
+        const size_t testPointCount = testQuadWeights.size();
+        const size_t trialPointCount = trialQuadWeights.size();
+        const size_t testFunctionCount = testValues[0].extent(1);
+        const size_t trialFunctionCount = trialValues[0].extent(1);
+        const _4dArray<KernelType>& kernel = kernelValues[0];
+        checkDimensions(testValues[0].extent(0), trialValues[0].extent(0),
+                        kernel.extent(0), kernel.extent(1));
+        assert(testValues[0].extent(2) == testPointCount);
+        assert(trialValues[0].extent(2) == trialPointCount);
+        assert(kernel.extent(2) == testPointCount);
+        assert(kernel.extent(3) == trialPointCount);
+
+        // Non-zero components of the functions multiplied by the quadrature
+        // weights and integration elements
+        weightNonzeroComponents(testValues[0], testGeomData, testQuadWeights,
+                                m_weightedTestValues.local());
+        weightNonzeroComponents(trialValues[0], trialGeomData, trialQuadWeights,
+                                m_weightedTrialValues.local());
+        const arma::Mat<BasisFunctionType>& weightedTestValues =
+            m_weightedTestValues.local();
+        const arma::Mat<BasisFunctionType>& weightedTrialValues =
+            m_weightedTrialValues.local();
+
+        result.set_size(testFunctionCount, trialFunctionCount);
+        for (size_t trialIndex = 0; trialIndex < trialFunctionCount; ++trialIndex) {
+            const int trialComponent = trialIndex % dim;
+            for (size_t testIndex = 0; testIndex < testFunctionCount; ++testIndex) {
+                const int testComponent = testIndex % dim;
+                ResultType sum = 0.;
+                for (size_t trialPoint = 0; trialPoint < trialPointCount; ++trialPoint) {
+                    ResultType partialSum = 0.;
+                    for (size_t testPoint = 0; testPoint < testPointCount; ++testPoint)
+                        partialSum += weightedTestValues(testPoint, testIndex) *
+                            kernel(testComponent, trialComponent,
+                                   testPoint, trialPoint);
+                    sum += partialSum * weightedTrialValues(trialPoint, trialIndex);
+                }
+                result(testIndex, trialIndex) = sum;
+            }
+        }
+    }
+
+    virtual void evaluateWithNontensorQuadratureRule(
+            const GeometricalData<CoordinateType>& testGeomData,
+            const GeometricalData<CoordinateType>& trialGeomData,
+            const CollectionOf3dArrays<BasisFunctionType>& testValues,
+            const CollectionOf3dArrays<BasisFunctionType>& trialValues,
+            const CollectionOf3dArrays<KernelType>& kernelValues,
+            const std::vector<CoordinateType>& quadWeights,
+            arma::Mat<ResultType>& result) const {
+        const size_t pointCount = quadWeights.size();
+        const size_t testFunctionCount = testValues[0].extent(1);
+        const size_t trialFunctionCount = trialValues[0].extent(1);
+        const _3dArray<KernelType>& kernel = kernelValues[0];
+        checkDimensions(testValues[0].extent(0), trialValues[0].extent(0),
+                        kernel.extent(0), kernel.extent(1));
+        assert(testValues[0].extent(2) == pointCount);
+        assert(trialValues[0].extent(2) == pointCount);
+        assert(kernel.extent(2) == pointCount);
+
+        // The quadrature weights are applied together with the test
+        // integration elements; the trial integration elements are applied
+        // in the innermost loop
+        weightNonzeroComponents(testValues[0], testGeomData, quadWeights,
+                                m_weightedTestValues.local());
+        const arma::Mat<BasisFunctionType>& weightedTestValues =
+            m_weightedTestValues.local();
+
+        result.set_size(testFunctionCount, trialFunctionCount);
+        for (size_t trialIndex = 0; trialIndex < trialFunctionCount; ++trialIndex) {
+            const int trialComponent = trialIndex % dim;
+            for (size_t testIndex = 0; testIndex < testFunctionCount; ++testIndex) {
+                const int testComponent = testIndex % dim;
+                ResultType sum = 0.;
+                for (size_t point = 0; point < pointCount; ++point)
+                    sum += weightedTestValues(point, testIndex) *
+                        kernel(testComponent, trialComponent, point) *
+                        trialValues[0](trialComponent, trialIndex, point) *
+                        trialGeomData.integrationElements(point);
+                result(testIndex, trialIndex) = sum;
+            }
+        }
+    }
+
+private:
+    /** \cond PRIVATE */
+    static void checkDimensions(size_t testComponentCount,
+                                size_t trialComponentCount,
+                                size_t kernelRowCount,
+                                size_t kernelColumnCount) {
+        if (testComponentCount != dim || trialComponentCount != dim ||
+                kernelRowCount != dim || kernelColumnCount != dim)
+            throw std::invalid_argument(
+                "SimpleVectorTestKernelTrialIntegral::evaluate(): "
+                "test functions, trial functions and kernel must have "
+                "dim components");
+    }
+
+    // Store in column f of weightedValues the non-zero component of the fth
+    // function at each point multiplied by the quadrature weight and the
+    // integration element
+    static void weightNonzeroComponents(
+            const _3dArray<BasisFunctionType>& values,
+            const GeometricalData<CoordinateType>& geomData,
+            const std::vector<CoordinateType>& quadWeights,
+            arma::Mat<BasisFunctionType>& weightedValues) {
+        const size_t functionCount = values.extent(1);
+        const size_t pointCount = values.extent(2);
+        weightedValues.set_size(pointCount, functionCount);
+        for (size_t function = 0; function < functionCount; ++function) {
+            const int component = function % dim;
+            for (size_t point = 0; point < pointCount; ++point)
+                weightedValues(point, function) =
+                    values(component, function, point) *
+                    (quadWeights[point] * geomData.integrationElements(point));
+        }
+    }
+
+    // Scratch space reused by each thread
+    mutable tbb::enumerable_thread_specific<arma::Mat<BasisFunctionType> >
+    m_weightedTestValues;
+    mutable tbb::enumerable_thread_specific<arma::Mat<BasisFunctionType> >
+    m_weightedTrialValues;
+    /** \endcond */
+};
+
+} // namespace Fiber
+
+#endif
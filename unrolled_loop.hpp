@@ -0,0 +1,55 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef unrolled_loop_hpp
+#define unrolled_loop_hpp
+
+namespace Fiber
+{
+
+/** \brief Loop over the indices <tt>0, 1, ..., count - 1</tt> unrolled at
+ *  compile time.
+ *
+ *  run(op) calls <tt>op(i)</tt> for each index \p i in increasing order.
+ *  It is used for the short loops over the components of vector functions,
+ *  whose number is a template parameter. */
+template <int count>
+struct UnrolledLoop
+{
+    template <typename Op>
+    static void run(Op& op) {
+        UnrolledLoop<count - 1>::run(op);
+        op(count - 1);
+    }
+};
+
+/** \cond PRIVATE */
+template <>
+struct UnrolledLoop<0>
+{
+    template <typename Op>
+    static void run(Op& op) {
+    }
+};
+/** \endcond */
+
+} // namespace Fiber
+
+#endif
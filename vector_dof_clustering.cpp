@@ -0,0 +1,81 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "vector_dof_clustering.hpp"
+
+#include "common/acc.hpp"
+
+#include <stdexcept>
+
+namespace Bempp
+{
+
+void liftScalarDofPermutation(
+    const std::vector<unsigned int>& scalarPermutation,
+    int codomainDim,
+    std::vector<unsigned int>& vectorPermutation,
+    DofOrdering ordering)
+{
+    const size_t scalarDofCount = scalarPermutation.size();
+    const VectorDofNumbering numbering(ordering, codomainDim, scalarDofCount);
+    vectorPermutation.resize(scalarDofCount * codomainDim);
+    for (size_t i = 0; i < scalarDofCount; ++i)
+        for (int d = 0; d < codomainDim; ++d)
+            acc(vectorPermutation, i * codomainDim + d) =
+                numbering.vectorDof(acc(scalarPermutation, i), d);
+}
+
+void liftScalarClusterIds(
+    const std::vector<unsigned int>& scalarClusterIds,
+    int codomainDim,
+    std::vector<unsigned int>& vectorClusterIds,
+    DofOrdering ordering)
+{
+    const size_t scalarDofCount = scalarClusterIds.size();
+    const VectorDofNumbering numbering(ordering, codomainDim, scalarDofCount);
+    vectorClusterIds.resize(scalarDofCount * codomainDim);
+    for (size_t i = 0; i < scalarDofCount; ++i)
+        for (int d = 0; d < codomainDim; ++d)
+            acc(vectorClusterIds, numbering.vectorDof(i, d)) =
+                acc(scalarClusterIds, i);
+}
+
+void projectVectorClusterIds(
+    const std::vector<unsigned int>& vectorClusterIds,
+    int codomainDim,
+    std::vector<unsigned int>& scalarClusterIds,
+    DofOrdering ordering,
+    int component)
+{
+    if (vectorClusterIds.size() % codomainDim != 0)
+        throw std::invalid_argument("projectVectorClusterIds(): "
+                                    "incorrect number of cluster ids");
+    if (component < 0 || component >= codomainDim)
+        throw std::invalid_argument("projectVectorClusterIds(): "
+                                    "invalid component");
+    const size_t scalarDofCount = vectorClusterIds.size() / codomainDim;
+    const VectorDofNumbering numbering(ordering, codomainDim, scalarDofCount);
+    scalarClusterIds.resize(scalarDofCount);
+    for (size_t i = 0; i < scalarDofCount; ++i)
+        acc(scalarClusterIds, i) =
+            acc(vectorClusterIds, numbering.vectorDof(i, component));
+}
+
+} // namespace Bempp
@@ -0,0 +1,87 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef vector_dof_clustering_hpp
+#define vector_dof_clustering_hpp
+
+#include "dof_ordering.hpp"
+
+#include "common/common.hpp"
+
+#include <vector>
+
+namespace Bempp
+{
+
+/** \brief Lift a permutation of the DOFs of a scalar space to the
+ *  corresponding SimpleVectorSpace.
+ *
+ *  Cluster trees used in H-matrix assembly are usually described by a
+ *  permutation of the DOFs, each cluster owning a contiguous range of
+ *  permuted indices. Building the tree over the DOFs of a vector space
+ *  wastes levels on separating the \p codomainDim DOFs located at the same
+ *  point; it is cheaper to build it over the DOFs of the scalar space and
+ *  lift it with this function. On output, the components of each scalar DOF
+ *  occupy consecutive positions, whatever the numbering \p ordering of the
+ *  vector DOFs: <tt>vectorPermutation[i * codomainDim + d]</tt> is the index
+ *  of the component \p d of the scalar DOF <tt>scalarPermutation[i]</tt>. A
+ *  cluster owning the permuted scalar DOFs <tt>[begin, end)</tt> then owns
+ *  the permuted vector DOFs
+ *  <tt>[begin * codomainDim, end * codomainDim)</tt>.
+ *
+ *  \note The H-matrix assembler of BEM++ builds its cluster trees itself
+ *  and does not call this function; it is provided for code building cluster
+ *  trees outside the assembler. */
+void liftScalarDofPermutation(
+        const std::vector<unsigned int>& scalarPermutation,
+        int codomainDim,
+        std::vector<unsigned int>& vectorPermutation,
+        DofOrdering ordering = INTERLEAVED_DOFS);
+
+/** \brief Lift the cluster ids of the DOFs of a scalar space to the
+ *  corresponding SimpleVectorSpace.
+ *
+ *  All components of a scalar DOF are assigned the id of that DOF.
+ *
+ *  \note Like liftScalarDofPermutation(), this function is not called by
+ *  the H-matrix assembler of BEM++. */
+void liftScalarClusterIds(
+        const std::vector<unsigned int>& scalarClusterIds,
+        int codomainDim,
+        std::vector<unsigned int>& vectorClusterIds,
+        DofOrdering ordering = INTERLEAVED_DOFS);
+
+/** \brief Inverse of liftScalarClusterIds().
+ *
+ *  Each scalar DOF is assigned the id of its component \p component; if its
+ *  components belong to different clusters, the ids of the other components
+ *  are ignored. An exception is thrown if the size of \p vectorClusterIds is
+ *  not a multiple of \p codomainDim or if \p component is not in
+ *  <tt>[0, codomainDim)</tt>. */
+void projectVectorClusterIds(
+        const std::vector<unsigned int>& vectorClusterIds,
+        int codomainDim,
+        std::vector<unsigned int>& scalarClusterIds,
+        DofOrdering ordering = INTERLEAVED_DOFS,
+        int component = 0);
+
+} // namespace Bempp
+
+#endif
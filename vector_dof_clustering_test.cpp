@@ -0,0 +1,150 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+
+// Test of the functions mapping DOF permutations and cluster ids between a
+// scalar space and the corresponding vector space: lifting scalar cluster
+// ids and projecting them back must restore them for every component and
+// DOF ordering, and a lifted permutation must keep the components of each
+// scalar DOF together.
+
+#include "vector_dof_clustering.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace
+{
+
+using namespace Bempp;
+
+const int CODOMAIN_DIM = 3;
+const size_t SCALAR_DOF_COUNT = 5;
+const unsigned int SCALAR_PERMUTATION[SCALAR_DOF_COUNT] = { 3, 0, 4, 1, 2 };
+const unsigned int SCALAR_CLUSTER_IDS[SCALAR_DOF_COUNT] = { 0, 1, 1, 2, 0 };
+
+bool check(bool condition, const char* message, DofOrdering ordering)
+{
+    if (!condition)
+        std::cerr << message << " ("
+                  << (ordering == INTERLEAVED_DOFS ? "interleaved" : "blocked")
+                  << " DOFs)" << std::endl;
+    return condition;
+}
+
+bool testPermutation(DofOrdering ordering)
+{
+    const std::vector<unsigned int> scalarPermutation(
+        SCALAR_PERMUTATION, SCALAR_PERMUTATION + SCALAR_DOF_COUNT);
+    std::vector<unsigned int> vectorPermutation;
+    liftScalarDofPermutation(scalarPermutation, CODOMAIN_DIM,
+                             vectorPermutation, ordering);
+    if (!check(vectorPermutation.size() == SCALAR_DOF_COUNT * CODOMAIN_DIM,
+               "liftScalarDofPermutation(): wrong size", ordering))
+        return false;
+
+    // The lifted permutation is a permutation...
+    std::vector<unsigned int> sorted(vectorPermutation);
+    std::sort(sorted.begin(), sorted.end());
+    bool ok = true;
+    for (size_t i = 0; i < sorted.size(); ++i)
+        ok = ok && sorted[i] == i;
+    // ... that places the components of each permuted scalar DOF next to
+    // each other
+    const VectorDofNumbering numbering(ordering, CODOMAIN_DIM,
+                                       SCALAR_DOF_COUNT);
+    for (size_t i = 0; i < SCALAR_DOF_COUNT; ++i)
+        for (int d = 0; d < CODOMAIN_DIM; ++d) {
+            const unsigned int vectorDof =
+                vectorPermutation[i * CODOMAIN_DIM + d];
+            ok = ok && numbering.scalarDof(vectorDof) == scalarPermutation[i] &&
+                numbering.component(vectorDof) == d;
+        }
+    return check(ok, "liftScalarDofPermutation(): wrong permutation",
+                 ordering);
+}
+
+bool testClusterIds(DofOrdering ordering)
+{
+    const std::vector<unsigned int> scalarClusterIds(
+        SCALAR_CLUSTER_IDS, SCALAR_CLUSTER_IDS + SCALAR_DOF_COUNT);
+    std::vector<unsigned int> vectorClusterIds;
+    liftScalarClusterIds(scalarClusterIds, CODOMAIN_DIM, vectorClusterIds,
+                         ordering);
+    if (!check(vectorClusterIds.size() == SCALAR_DOF_COUNT * CODOMAIN_DIM,
+               "liftScalarClusterIds(): wrong size", ordering))
+        return false;
+
+    bool ok = true;
+    std::vector<unsigned int> projectedClusterIds;
+    for (int d = 0; d < CODOMAIN_DIM; ++d) {
+        projectVectorClusterIds(vectorClusterIds, CODOMAIN_DIM,
+                                projectedClusterIds, ordering, d);
+        ok = check(projectedClusterIds == scalarClusterIds,
+                   "projectVectorClusterIds(): lifted ids not restored",
+                   ordering) && ok;
+    }
+
+    // Give each component its own ids; projection must select those of the
+    // requested component
+    const VectorDofNumbering numbering(ordering, CODOMAIN_DIM,
+                                       SCALAR_DOF_COUNT);
+    for (size_t i = 0; i < SCALAR_DOF_COUNT; ++i)
+        for (int d = 0; d < CODOMAIN_DIM; ++d)
+            vectorClusterIds[numbering.vectorDof(i, d)] =
+                scalarClusterIds[i] + 10 * d;
+    for (int d = 0; d < CODOMAIN_DIM; ++d) {
+        projectVectorClusterIds(vectorClusterIds, CODOMAIN_DIM,
+                                projectedClusterIds, ordering, d);
+        bool componentOk = projectedClusterIds.size() == SCALAR_DOF_COUNT;
+        for (size_t i = 0; componentOk && i < SCALAR_DOF_COUNT; ++i)
+            componentOk = projectedClusterIds[i] == scalarClusterIds[i] + 10 * d;
+        ok = check(componentOk,
+                   "projectVectorClusterIds(): ids of a wrong component",
+                   ordering) && ok;
+    }
+
+    bool thrown = false;
+    try {
+        projectVectorClusterIds(vectorClusterIds, CODOMAIN_DIM,
+                                projectedClusterIds, ordering, CODOMAIN_DIM);
+    }
+    catch (std::invalid_argument&) {
+        thrown = true;
+    }
+    ok = check(thrown, "projectVectorClusterIds(): invalid component accepted",
+               ordering) && ok;
+    return ok;
+}
+
+} // namespace
+
+int main()
+{
+    bool ok = true;
+    ok = testPermutation(INTERLEAVED_DOFS) && ok;
+    ok = testPermutation(BLOCKED_DOFS) && ok;
+    ok = testClusterIds(INTERLEAVED_DOFS) && ok;
+    ok = testClusterIds(BLOCKED_DOFS) && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
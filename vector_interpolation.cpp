@@ -0,0 +1,161 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "vector_interpolation.hpp"
+
+#include "parallel_options.hpp"
+#include "simple_vector_space.hpp"
+
+#include "common/scalar_traits.hpp"
+#include "fiber/explicit_instantiation.hpp"
+#include "fiber/function.hpp"
+#include "fiber/geometrical_data.hpp"
+#include "fiber/parallelization_options.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_scheduler_init.h>
+
+namespace Bempp
+{
+
+namespace
+{
+
+// Number of scalar interpolation points passed to the function at a time
+const size_t INTERPOLATION_CHUNK_SIZE = 256;
+
+template <typename ResultType>
+struct InterpolationScratch
+{
+    typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+
+    Fiber::GeometricalData<CoordinateType> geomData;
+    arma::Mat<ResultType> values;
+};
+
+template <typename ResultType>
+class InterpolationLoopBody
+{
+public:
+    typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+    typedef tbb::enumerable_thread_specific<InterpolationScratch<ResultType> >
+    ScratchStorage;
+
+    InterpolationLoopBody(const VectorInterpolationData<CoordinateType>& data,
+                          const Fiber::Function<ResultType>& function,
+                          bool needsNormals,
+                          ScratchStorage& scratch,
+                          arma::Col<ResultType>& coefficients) :
+        m_data(data), m_function(function), m_needsNormals(needsNormals),
+        m_scratch(scratch), m_coefficients(coefficients)
+    {}
+
+    void operator() (const tbb::blocked_range<size_t>& r) const {
+        InterpolationScratch<ResultType>& scratch = m_scratch.local();
+        const VectorDofNumbering& numbering = m_data.numbering();
+        const int componentCount = numbering.componentCount();
+        for (size_t begin = r.begin(); begin < r.end();
+             begin += INTERPOLATION_CHUNK_SIZE) {
+            const size_t end = std::min(r.end(), begin + INTERPOLATION_CHUNK_SIZE);
+            scratch.geomData.globals =
+                m_data.scalarPoints().cols(begin, end - 1);
+            if (m_needsNormals)
+                scratch.geomData.normals =
+                    m_data.scalarNormals().cols(begin, end - 1);
+            m_function.evaluate(scratch.geomData, scratch.values);
+            for (size_t i = begin; i < end; ++i)
+                for (int c = 0; c < componentCount; ++c)
+                    m_coefficients(numbering.vectorDof(i, c)) =
+                        scratch.values(c, i - begin);
+        }
+    }
+
+private:
+    const VectorInterpolationData<CoordinateType>& m_data;
+    const Fiber::Function<ResultType>& m_function;
+    bool m_needsNormals;
+    ScratchStorage& m_scratch;
+    arma::Col<ResultType>& m_coefficients;
+};
+
+} // namespace
+
+template <typename BasisFunctionType, typename ResultType>
+void interpolateOnVectorSpace(
+    const SimpleVectorSpaceBase<BasisFunctionType>& space,
+    const Fiber::Function<ResultType>& function,
+    arma::Col<ResultType>& coefficients,
+    const Fiber::ParallelizationOptions& parallelOptions)
+{
+    typedef typename ScalarTraits<ResultType>::RealType CoordinateType;
+
+    if (function.codomainDimension() != space.codomainDimension())
+        throw std::invalid_argument(
+            "interpolateOnVectorSpace(): codomain dimensions of the function "
+            "and the space do not match");
+    size_t geomDeps = 0;
+    function.addGeometricalDependencies(geomDeps);
+    if (geomDeps & ~(Fiber::GLOBALS | Fiber::NORMALS))
+        throw std::invalid_argument(
+            "interpolateOnVectorSpace(): the function may depend only on "
+            "global coordinates and normals");
+
+    const VectorInterpolationData<CoordinateType> data =
+        space.interpolationData(geomDeps & Fiber::NORMALS);
+    coefficients.set_size(data.dofCount());
+
+    tbb::task_scheduler_init scheduler(maxThreadCountOf(parallelOptions));
+
+    typename InterpolationLoopBody<ResultType>::ScratchStorage scratch;
+    InterpolationLoopBody<ResultType> body(
+        data, function, geomDeps & Fiber::NORMALS, scratch, coefficients);
+    tbb::parallel_for(tbb::blocked_range<size_t>(
+                          0, data.numbering().scalarDofCount(),
+                          INTERPOLATION_CHUNK_SIZE),
+                      body);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void interpolateOnVectorSpace(
+    const SimpleVectorSpaceBase<BasisFunctionType>& space,
+    const Fiber::Function<ResultType>& function,
+    arma::Col<ResultType>& coefficients)
+{
+    interpolateOnVectorSpace(space, function, coefficients,
+                             Fiber::ParallelizationOptions());
+}
+
+#define INSTANTIATE_INTERPOLATE_ON_VECTOR_SPACE(BASIS, RESULT) \
+    template void interpolateOnVectorSpace( \
+        const SimpleVectorSpaceBase< BASIS >& space, \
+        const Fiber::Function< RESULT >& function, \
+        arma::Col< RESULT >& coefficients, \
+        const Fiber::ParallelizationOptions& parallelOptions); \
+    template void interpolateOnVectorSpace( \
+        const SimpleVectorSpaceBase< BASIS >& space, \
+        const Fiber::Function< RESULT >& function, \
+        arma::Col< RESULT >& coefficients)
+FIBER_ITERATE_OVER_BASIS_AND_RESULT_TYPES(INSTANTIATE_INTERPOLATE_ON_VECTOR_SPACE);
+
+} // namespace Bempp
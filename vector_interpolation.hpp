@@ -0,0 +1,129 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef vector_interpolation_hpp
+#define vector_interpolation_hpp
+
+#include "dof_ordering.hpp"
+
+#include "common/common.hpp"
+#include "common/shared_ptr.hpp"
+
+#include <armadillo>
+
+namespace Fiber
+{
+
+class ParallelizationOptions;
+template <typename ValueType> class Function;
+
+} // namespace Fiber
+
+namespace Bempp
+{
+
+template <typename BasisFunctionType> class SimpleVectorSpaceBase;
+
+/** \brief Interpolation points, normals and directions of the DOFs of a
+ *  SimpleVectorSpace, stored without replication.
+ *
+ *  The DOF \p n of a SimpleVectorSpace is interpolated at the interpolation
+ *  point of the scalar DOF <tt>numbering().scalarDof(n)</tt>, along the
+ *  unit vector of the axis <tt>numbering().component(n)</tt>.
+ *  Space::getGlobalDofInterpolationPoints() and related functions store
+ *  these data as dense matrices with one column per vector DOF, most of
+ *  whose entries are copies or zeros; this class stores only the points
+ *  and normals of the scalar space and represents the directions
+ *  implicitly. */
+template <typename CoordinateType>
+class VectorInterpolationData
+{
+public:
+    VectorInterpolationData(
+            const shared_ptr<const arma::Mat<CoordinateType> >& scalarPoints,
+            const shared_ptr<const arma::Mat<CoordinateType> >& scalarNormals,
+            int componentCount, DofOrdering ordering) :
+        m_scalarPoints(scalarPoints), m_scalarNormals(scalarNormals),
+        m_numbering(ordering, componentCount, scalarPoints->n_cols)
+    {}
+
+    /** \brief Interpolation points of the scalar DOFs (one per column). */
+    const arma::Mat<CoordinateType>& scalarPoints() const {
+        return *m_scalarPoints;
+    }
+
+    /** \brief Normals at the interpolation points of the scalar DOFs (one
+     *  per column). */
+    const arma::Mat<CoordinateType>& scalarNormals() const {
+        return *m_scalarNormals;
+    }
+
+    /** \brief Map between the vector DOFs and the scalar DOFs. */
+    const VectorDofNumbering& numbering() const {
+        return m_numbering;
+    }
+
+    /** \brief Number of vector DOFs. */
+    size_t dofCount() const {
+        return m_numbering.scalarDofCount() * m_numbering.componentCount();
+    }
+
+    /** \brief Index of the axis along which the DOF \p dof is
+     *  interpolated. */
+    int direction(size_t dof) const {
+        return m_numbering.component(dof);
+    }
+
+private:
+    /** \cond PRIVATE */
+    shared_ptr<const arma::Mat<CoordinateType> > m_scalarPoints;
+    shared_ptr<const arma::Mat<CoordinateType> > m_scalarNormals;
+    VectorDofNumbering m_numbering;
+    /** \endcond */
+};
+
+/** \brief Interpolate \p function on the SimpleVectorSpace \p space.
+ *
+ *  On output, the entry of \p coefficients corresponding to the component
+ *  \p c of the scalar DOF \p i is the <tt>c</tt>th component of \p function
+ *  at the interpolation point of \p i. \p function is evaluated once per
+ *  scalar interpolation point, in parallel, in chunks of consecutive
+ *  points; the replicated points, normals and directions are never formed.
+ *
+ *  \p function may depend only on the global coordinates of the points and
+ *  on the normals. An exception is thrown if its codomain dimension differs
+ *  from that of \p space. */
+template <typename BasisFunctionType, typename ResultType>
+void interpolateOnVectorSpace(
+        const SimpleVectorSpaceBase<BasisFunctionType>& space,
+        const Fiber::Function<ResultType>& function,
+        arma::Col<ResultType>& coefficients,
+        const Fiber::ParallelizationOptions& parallelOptions);
+
+/** \overload */
+template <typename BasisFunctionType, typename ResultType>
+void interpolateOnVectorSpace(
+        const SimpleVectorSpaceBase<BasisFunctionType>& space,
+        const Fiber::Function<ResultType>& function,
+        arma::Col<ResultType>& coefficients);
+
+} // namespace Bempp
+
+#endif
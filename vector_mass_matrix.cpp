@@ -0,0 +1,378 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "vector_mass_matrix.hpp"
+
+#include "csr_discrete_boundary_operator.hpp"
+#include "element_integration_engine.hpp"
+#include "kronecker_discrete_boundary_operator.hpp"
+#include "simple_vector_space.hpp"
+
+#include "common/acc.hpp"
+#include "fiber/explicit_instantiation.hpp"
+#include "fiber/parallelization_options.hpp"
+
+#include <algorithm>
+#include <boost/make_shared.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <list>
+#include <stdexcept>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_scheduler_init.h>
+#include <utility>
+
+namespace Bempp
+{
+
+namespace
+{
+    // Largest diagonal block inverted by inverseVectorMassMatrix()
+    const size_t MAX_BLOCK_SIZE = 64;
+    // Rows handled by a single task when sorting the mass matrix entries
+    const size_t ROW_GRAIN_SIZE = 256;
+
+    template <typename BasisFunctionType>
+    struct MassEntry
+    {
+        GlobalDofIndex row;
+        GlobalDofIndex col;
+        BasisFunctionType value;
+    };
+
+    // Collects the non-zero entries of the local mass matrices of all
+    // elements. Each consumer appends to a chunk of its own; joining
+    // consumers splices their lists of chunks without copying any entries.
+    template <typename BasisFunctionType>
+    class MassEntryConsumer
+    {
+    public:
+        typedef std::list<std::vector<MassEntry<BasisFunctionType> > > Chunks;
+
+        MassEntryConsumer() :
+            m_chunks(1)
+        {}
+
+        MassEntryConsumer(MassEntryConsumer& other, tbb::split) :
+            m_chunks(1)
+        {}
+
+        void addElement(size_t elementIndex,
+                        const std::vector<GlobalDofIndex>& globalDofs,
+                        const arma::Mat<BasisFunctionType>& localProducts)
+        {
+            std::vector<MassEntry<BasisFunctionType> >& entries =
+                m_chunks.front();
+            MassEntry<BasisFunctionType> entry;
+            for (size_t j = 0; j < globalDofs.size(); ++j)
+                for (size_t i = 0; i < globalDofs.size(); ++i)
+                    if (globalDofs[i] >= 0 && globalDofs[j] >= 0 &&
+                            localProducts(i, j) !=
+                            static_cast<BasisFunctionType>(0.)) {
+                        entry.row = globalDofs[i];
+                        entry.col = globalDofs[j];
+                        entry.value = localProducts(i, j);
+                        entries.push_back(entry);
+                    }
+        }
+
+        void join(MassEntryConsumer& other)
+        {
+            m_chunks.splice(m_chunks.end(), other.m_chunks);
+        }
+
+        const Chunks& chunks() const
+        {
+            return m_chunks;
+        }
+
+    private:
+        Chunks m_chunks;
+    };
+
+    template <typename ResultType>
+    bool columnLess(const std::pair<int, ResultType>& a,
+                    const std::pair<int, ResultType>& b)
+    {
+        return a.first < b.first;
+    }
+
+    // Sorts the entries of each row by column and sums duplicates in place,
+    // storing the number of distinct columns of the row
+    template <typename ResultType>
+    class MassRowSortLoopBody
+    {
+    public:
+        MassRowSortLoopBody(const std::vector<size_t>& rowOffsets,
+                            std::vector<std::pair<int, ResultType> >& rowEntries,
+                            std::vector<size_t>& rowLengths) :
+            m_rowOffsets(rowOffsets), m_rowEntries(rowEntries),
+            m_rowLengths(rowLengths)
+        {}
+
+        void operator() (const tbb::blocked_range<size_t>& r) const {
+            for (size_t row = r.begin(); row < r.end(); ++row) {
+                const size_t rowBegin = m_rowOffsets[row];
+                const size_t rowEnd = m_rowOffsets[row + 1];
+                std::sort(m_rowEntries.begin() + rowBegin,
+                          m_rowEntries.begin() + rowEnd,
+                          columnLess<ResultType>);
+                size_t last = rowBegin;
+                for (size_t k = rowBegin + 1; k < rowEnd; ++k)
+                    if (m_rowEntries[k].first == m_rowEntries[last].first)
+                        m_rowEntries[last].second += m_rowEntries[k].second;
+                    else
+                        m_rowEntries[++last] = m_rowEntries[k];
+                m_rowLengths[row] = (rowEnd > rowBegin) ? last + 1 - rowBegin : 0;
+            }
+        }
+
+    private:
+        const std::vector<size_t>& m_rowOffsets;
+        std::vector<std::pair<int, ResultType> >& m_rowEntries;
+        std::vector<size_t>& m_rowLengths;
+    };
+
+    // Copies the distinct entries of each row to the CSR arrays
+    template <typename ResultType>
+    class MassRowCompactionLoopBody
+    {
+    public:
+        MassRowCompactionLoopBody(
+                const std::vector<size_t>& entryOffsets,
+                const std::vector<std::pair<int, ResultType> >& rowEntries,
+                const std::vector<size_t>& rowOffsets,
+                std::vector<int>& columnIndices,
+                std::vector<ResultType>& values) :
+            m_entryOffsets(entryOffsets), m_rowEntries(rowEntries),
+            m_rowOffsets(rowOffsets), m_columnIndices(columnIndices),
+            m_values(values)
+        {}
+
+        void operator() (const tbb::blocked_range<size_t>& r) const {
+            for (size_t row = r.begin(); row < r.end(); ++row) {
+                const size_t source = m_entryOffsets[row];
+                for (size_t k = m_rowOffsets[row]; k < m_rowOffsets[row + 1]; ++k) {
+                    const std::pair<int, ResultType>& entry =
+                        m_rowEntries[source + k - m_rowOffsets[row]];
+                    m_columnIndices[k] = entry.first;
+                    m_values[k] = entry.second;
+                }
+            }
+        }
+
+    private:
+        const std::vector<size_t>& m_entryOffsets;
+        const std::vector<std::pair<int, ResultType> >& m_rowEntries;
+        const std::vector<size_t>& m_rowOffsets;
+        std::vector<int>& m_columnIndices;
+        std::vector<ResultType>& m_values;
+    };
+
+    template <typename ResultType>
+    shared_ptr<const CsrDiscreteBoundaryOperator<ResultType> >
+    invertBlockDiagonal(const CsrDiscreteBoundaryOperator<ResultType>& matrix)
+    {
+        const size_t n = matrix.rowCount();
+        const std::vector<size_t>& offsets = matrix.rowOffsets();
+        const std::vector<int>& columns = matrix.columnIndices();
+        const std::vector<ResultType>& values = matrix.values();
+
+        // The diagonal blocks are the connected components of the graph of
+        // the (symmetric) matrix
+        std::vector<int> blockOf(n, -1);
+        std::vector<int> blockRows;
+        std::vector<size_t> blockOffsets(1, 0);
+        for (size_t seed = 0; seed < n; ++seed) {
+            if (blockOf[seed] >= 0)
+                continue;
+            const int block = blockOffsets.size() - 1;
+            const size_t begin = blockRows.size();
+            blockOf[seed] = block;
+            blockRows.push_back(seed);
+            for (size_t k = begin; k < blockRows.size(); ++k) {
+                const int row = blockRows[k];
+                for (size_t l = offsets[row]; l < offsets[row + 1]; ++l)
+                    if (blockOf[columns[l]] < 0) {
+                        blockOf[columns[l]] = block;
+                        blockRows.push_back(columns[l]);
+                    }
+                if (blockRows.size() - begin > MAX_BLOCK_SIZE)
+                    throw std::invalid_argument(
+                        "inverseVectorMassMatrix(): the mass matrix is not "
+                        "block-diagonal with small blocks");
+            }
+            std::sort(blockRows.begin() + begin, blockRows.end());
+            blockOffsets.push_back(blockRows.size());
+        }
+
+        std::vector<size_t> inverseOffsets(n + 1, 0);
+        for (size_t row = 0; row < n; ++row) {
+            const int block = blockOf[row];
+            inverseOffsets[row + 1] = inverseOffsets[row] +
+                blockOffsets[block + 1] - blockOffsets[block];
+        }
+        std::vector<int> inverseColumns(inverseOffsets[n]);
+        std::vector<ResultType> inverseValues(inverseOffsets[n]);
+        arma::Mat<ResultType> dense, inverse;
+        for (size_t block = 0; block + 1 < blockOffsets.size(); ++block) {
+            const int* rows = &blockRows[blockOffsets[block]];
+            const size_t size = blockOffsets[block + 1] - blockOffsets[block];
+            dense.zeros(size, size);
+            for (size_t i = 0; i < size; ++i)
+                for (size_t l = offsets[rows[i]]; l < offsets[rows[i] + 1]; ++l)
+                    dense(i, std::lower_bound(rows, rows + size, columns[l]) -
+                          rows) = values[l];
+            if (!arma::inv(inverse, dense))
+                throw std::runtime_error(
+                    "inverseVectorMassMatrix(): the mass matrix is singular");
+            for (size_t i = 0; i < size; ++i)
+                for (size_t j = 0; j < size; ++j) {
+                    inverseColumns[inverseOffsets[rows[i]] + j] = rows[j];
+                    inverseValues[inverseOffsets[rows[i]] + j] = inverse(i, j);
+                }
+        }
+        return boost::make_shared<CsrDiscreteBoundaryOperator<ResultType> >(
+            n, n, inverseOffsets, inverseColumns, inverseValues);
+    }
+} // namespace
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const CsrDiscreteBoundaryOperator<ResultType> >
+scalarMassMatrix(
+    const SimpleVectorSpaceBase<BasisFunctionType>& space,
+    const Fiber::ParallelizationOptions& parallelOptions)
+{
+    typedef ElementIntegrationEngine<BasisFunctionType> Engine;
+
+    const shared_ptr<const Space<BasisFunctionType> > scalarSpace =
+        space.scalarSpace();
+    const shared_ptr<const GridSegmentElementList> elements =
+        space.elementList();
+    const boost::scoped_ptr<Engine> engine(elements ?
+        new Engine(*scalarSpace, elements, parallelOptions) :
+        new Engine(*scalarSpace, parallelOptions));
+    typedef typename MassEntryConsumer<BasisFunctionType>::Chunks Chunks;
+    MassEntryConsumer<BasisFunctionType> consumer;
+    engine->integrateProducts(consumer, parallelOptions);
+    const Chunks& chunks = consumer.chunks();
+
+    // Distribute the entries to rows (counting sort)
+    const size_t dofCount = scalarSpace->globalDofCount();
+    std::vector<size_t> entryOffsets(dofCount + 1, 0);
+    for (typename Chunks::const_iterator chunk = chunks.begin();
+         chunk != chunks.end(); ++chunk)
+        for (size_t e = 0; e < chunk->size(); ++e)
+            ++acc(entryOffsets, acc(*chunk, e).row + 1);
+    for (size_t row = 0; row < dofCount; ++row)
+        entryOffsets[row + 1] += entryOffsets[row];
+    std::vector<std::pair<int, ResultType> > rowEntries(entryOffsets[dofCount]);
+    std::vector<size_t> next(entryOffsets.begin(), entryOffsets.end() - 1);
+    for (typename Chunks::const_iterator chunk = chunks.begin();
+         chunk != chunks.end(); ++chunk)
+        for (size_t e = 0; e < chunk->size(); ++e) {
+            const MassEntry<BasisFunctionType>& entry = (*chunk)[e];
+            rowEntries[next[entry.row]++] =
+                std::make_pair(entry.col, ResultType(entry.value));
+        }
+
+    // Sort each row by column, summing duplicates, and compress the rows
+    tbb::task_scheduler_init scheduler(maxThreadCountOf(parallelOptions));
+    std::vector<size_t> rowLengths(dofCount);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, dofCount, ROW_GRAIN_SIZE),
+                      MassRowSortLoopBody<ResultType>(
+                          entryOffsets, rowEntries, rowLengths));
+    std::vector<size_t> rowOffsets(dofCount + 1);
+    rowOffsets[0] = 0;
+    for (size_t row = 0; row < dofCount; ++row)
+        rowOffsets[row + 1] = rowOffsets[row] + rowLengths[row];
+    std::vector<int> columnIndices(rowOffsets[dofCount]);
+    std::vector<ResultType> values(rowOffsets[dofCount]);
+    tbb::parallel_for(tbb::blocked_range<size_t>(0, dofCount, ROW_GRAIN_SIZE),
+                      MassRowCompactionLoopBody<ResultType>(
+                          entryOffsets, rowEntries, rowOffsets,
+                          columnIndices, values));
+    return boost::make_shared<CsrDiscreteBoundaryOperator<ResultType> >(
+        dofCount, dofCount, rowOffsets, columnIndices, values);
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType> >
+vectorMassMatrix(
+    const SimpleVectorSpaceBase<BasisFunctionType>& space,
+    const Fiber::ParallelizationOptions& parallelOptions)
+{
+    return boost::make_shared<KroneckerDiscreteBoundaryOperator<ResultType> >(
+        scalarMassMatrix<BasisFunctionType, ResultType>(space, parallelOptions),
+        space.codomainDimension(), space.dofOrdering(), space.dofOrdering());
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType> >
+vectorMassMatrix(
+    const SimpleVectorSpaceBase<BasisFunctionType>& space)
+{
+    return vectorMassMatrix<BasisFunctionType, ResultType>(
+        space, Fiber::ParallelizationOptions());
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType> >
+inverseVectorMassMatrix(
+    const SimpleVectorSpaceBase<BasisFunctionType>& space,
+    const Fiber::ParallelizationOptions& parallelOptions)
+{
+    return boost::make_shared<KroneckerDiscreteBoundaryOperator<ResultType> >(
+        invertBlockDiagonal(*scalarMassMatrix<BasisFunctionType, ResultType>(
+                                space, parallelOptions)),
+        space.codomainDimension(), space.dofOrdering(), space.dofOrdering());
+}
+
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType> >
+inverseVectorMassMatrix(
+    const SimpleVectorSpaceBase<BasisFunctionType>& space)
+{
+    return inverseVectorMassMatrix<BasisFunctionType, ResultType>(
+        space, Fiber::ParallelizationOptions());
+}
+
+#define INSTANTIATE_VECTOR_MASS_MATRIX(BASIS, RESULT) \
+    template shared_ptr<const CsrDiscreteBoundaryOperator< RESULT > > \
+    scalarMassMatrix< BASIS, RESULT >( \
+        const SimpleVectorSpaceBase< BASIS >& space, \
+        const Fiber::ParallelizationOptions& parallelOptions); \
+    template shared_ptr<const DiscreteBoundaryOperator< RESULT > > \
+    vectorMassMatrix< BASIS, RESULT >( \
+        const SimpleVectorSpaceBase< BASIS >& space, \
+        const Fiber::ParallelizationOptions& parallelOptions); \
+    template shared_ptr<const DiscreteBoundaryOperator< RESULT > > \
+    vectorMassMatrix< BASIS, RESULT >( \
+        const SimpleVectorSpaceBase< BASIS >& space); \
+    template shared_ptr<const DiscreteBoundaryOperator< RESULT > > \
+    inverseVectorMassMatrix< BASIS, RESULT >( \
+        const SimpleVectorSpaceBase< BASIS >& space, \
+        const Fiber::ParallelizationOptions& parallelOptions); \
+    template shared_ptr<const DiscreteBoundaryOperator< RESULT > > \
+    inverseVectorMassMatrix< BASIS, RESULT >( \
+        const SimpleVectorSpaceBase< BASIS >& space)
+FIBER_ITERATE_OVER_BASIS_AND_RESULT_TYPES(INSTANTIATE_VECTOR_MASS_MATRIX);
+
+} // namespace Bempp
@@ -0,0 +1,103 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef vector_mass_matrix_hpp
+#define vector_mass_matrix_hpp
+
+#include "common/common.hpp"
+#include "common/shared_ptr.hpp"
+
+namespace Fiber
+{
+
+class ParallelizationOptions;
+
+} // namespace Fiber
+
+namespace Bempp
+{
+
+template <typename ValueType> class CsrDiscreteBoundaryOperator;
+template <typename ValueType> class DiscreteBoundaryOperator;
+template <typename BasisFunctionType> class SimpleVectorSpaceBase;
+
+/** \brief Assemble the mass matrix of the scalar space underlying the
+ *  SimpleVectorSpace \p space.
+ *
+ *  Only the elements carrying DOFs of \p space are taken into account. The
+ *  local mass matrices are evaluated in parallel with at most as many
+ *  threads as allowed by \p parallelOptions and summed into a matrix in
+ *  the CSR format. */
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const CsrDiscreteBoundaryOperator<ResultType> >
+scalarMassMatrix(
+        const SimpleVectorSpaceBase<BasisFunctionType>& space,
+        const Fiber::ParallelizationOptions& parallelOptions);
+
+/** \brief Assemble the mass matrix of the SimpleVectorSpace \p space.
+ *
+ *  Basis functions oriented along different axes are orthogonal, so the
+ *  mass matrix is equal to <tt>I (x) M</tt>, with \p M the mass matrix of
+ *  the scalar space (see scalarMassMatrix()). Only \p M is assembled and
+ *  stored; the returned operator is a KroneckerDiscreteBoundaryOperator
+ *  numbering its rows and columns as the DOFs of \p space. It is equal to
+ *  the weak form of the identity operator on \p space, but cheaper to
+ *  assemble. */
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType> >
+vectorMassMatrix(
+        const SimpleVectorSpaceBase<BasisFunctionType>& space,
+        const Fiber::ParallelizationOptions& parallelOptions);
+
+/** \overload */
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType> >
+vectorMassMatrix(
+        const SimpleVectorSpaceBase<BasisFunctionType>& space);
+
+/** \brief Return the inverse of the mass matrix of the SimpleVectorSpace \p
+ *  space.
+ *
+ *  The DOFs of discontinuous spaces, such as PiecewiseConstantVectorSpace
+ *  and PiecewiseLinearDiscontinuousVectorSpace, are attached to single
+ *  elements, so the scalar mass matrix is block-diagonal, with one small
+ *  block per element. This function inverts each block directly and
+ *  returns <tt>I (x) M^-1</tt>, whose application costs O(N) operations;
+ *  no iterative solve is needed to compute L2 projections or to apply a
+ *  mass-matrix preconditioner.
+ *
+ *  An exception is thrown if the scalar mass matrix has a diagonal block
+ *  larger than a few tens of rows (e.g. for continuous spaces) or a
+ *  singular block. */
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType> >
+inverseVectorMassMatrix(
+        const SimpleVectorSpaceBase<BasisFunctionType>& space,
+        const Fiber::ParallelizationOptions& parallelOptions);
+
+/** \overload */
+template <typename BasisFunctionType, typename ResultType>
+shared_ptr<const DiscreteBoundaryOperator<ResultType> >
+inverseVectorMassMatrix(
+        const SimpleVectorSpaceBase<BasisFunctionType>& space);
+
+} // namespace Bempp
+
+#endif
@@ -0,0 +1,166 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#include "vector_projection.hpp"
+
+#include "element_integration_engine.hpp"
+#include "simple_vector_space.hpp"
+
+#include "fiber/explicit_instantiation.hpp"
+#include "fiber/function.hpp"
+#include "fiber/parallelization_options.hpp"
+
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/task_scheduler_init.h>
+#include <vector>
+
+namespace Bempp
+{
+
+namespace
+{
+    // Stores the local projections of each element in the slots of its DOFs
+    // in the element-to-DOF table. Each element is visited by a single
+    // thread, so all consumers write to the same array.
+    template <typename BasisFunctionType, typename ResultType>
+    class ProjectionConsumer
+    {
+    public:
+        ProjectionConsumer(const ElementDofTable<BasisFunctionType>& table,
+                           std::vector<ResultType>& localProjections) :
+            m_table(table), m_localProjections(localProjections)
+        {}
+
+        ProjectionConsumer(ProjectionConsumer& other, tbb::split) :
+            m_table(other.m_table), m_localProjections(other.m_localProjections)
+        {}
+
+        void addElement(size_t elementIndex,
+                        const std::vector<GlobalDofIndex>& globalDofs,
+                        const arma::Col<ResultType>& localProjections)
+        {
+            const size_t offset = m_table.offset(elementIndex);
+            for (size_t i = 0; i < globalDofs.size(); ++i)
+                m_localProjections[offset + i] = localProjections(i);
+        }
+
+        void join(ProjectionConsumer& other)
+        {
+        }
+
+    private:
+        const ElementDofTable<BasisFunctionType>& m_table;
+        std::vector<ResultType>& m_localProjections;
+    };
+
+    // Sums the local projections attached to each global DOF
+    template <typename BasisFunctionType, typename ResultType>
+    class ProjectionGatherLoopBody
+    {
+    public:
+        ProjectionGatherLoopBody(
+                const SimpleVectorSpaceBase<BasisFunctionType>& space,
+                const std::vector<ResultType>& localProjections,
+                arma::Col<ResultType>& projections) :
+            m_space(space), m_table(space.elementDofTable()),
+            m_localProjections(localProjections), m_projections(projections)
+        {}
+
+        void operator() (const tbb::blocked_range<size_t>& r) const {
+            std::vector<GlobalDofIndex> globalDofs(r.size());
+            for (size_t i = 0; i < r.size(); ++i)
+                globalDofs[i] = r.begin() + i;
+            std::vector<size_t> offsets;
+            std::vector<LocalDof> localDofs;
+            std::vector<BasisFunctionType> weights;
+            // The local projections already include the local DOF weights
+            m_space.global2localDofs(&globalDofs[0], globalDofs.size(),
+                                     offsets, localDofs, weights);
+            for (size_t i = 0; i < r.size(); ++i) {
+                ResultType sum = 0.;
+                for (size_t k = offsets[i]; k < offsets[i + 1]; ++k)
+                    sum += m_localProjections[
+                            m_table.offset(localDofs[k].entityIndex) +
+                            localDofs[k].dofIndex];
+                m_projections(r.begin() + i) = sum;
+            }
+        }
+
+    private:
+        const SimpleVectorSpaceBase<BasisFunctionType>& m_space;
+        const ElementDofTable<BasisFunctionType>& m_table;
+        const std::vector<ResultType>& m_localProjections;
+        arma::Col<ResultType>& m_projections;
+    };
+
+    // Global DOFs handled by a single task of the gather pass
+    const size_t GATHER_GRAIN_SIZE = 1024;
+} // namespace
+
+template <typename BasisFunctionType, typename ResultType>
+void projectOnVectorSpace(
+    const SimpleVectorSpaceBase<BasisFunctionType>& space,
+    const Fiber::Function<ResultType>& function,
+    arma::Col<ResultType>& projections,
+    const Fiber::ParallelizationOptions& parallelOptions)
+{
+    // The elements are integrated first, each storing its local projections
+    // in its own slots; the projections onto the global DOFs are then
+    // gathered, in parallel over DOFs. No thread needs a vector covering all
+    // DOFs.
+    const ElementDofTable<BasisFunctionType>& table = space.elementDofTable();
+    std::vector<ResultType> localProjections(table.entryCount());
+    ElementIntegrationEngine<BasisFunctionType> engine(space, parallelOptions);
+    ProjectionConsumer<BasisFunctionType, ResultType> consumer(
+        table, localProjections);
+    engine.project(function, consumer, parallelOptions);
+
+    projections.set_size(space.globalDofCount());
+    tbb::task_scheduler_init scheduler(maxThreadCountOf(parallelOptions));
+    tbb::parallel_for(tbb::blocked_range<size_t>(
+                          0, space.globalDofCount(), GATHER_GRAIN_SIZE),
+                      ProjectionGatherLoopBody<BasisFunctionType, ResultType>(
+                          space, localProjections, projections));
+}
+
+template <typename BasisFunctionType, typename ResultType>
+void projectOnVectorSpace(
+    const SimpleVectorSpaceBase<BasisFunctionType>& space,
+    const Fiber::Function<ResultType>& function,
+    arma::Col<ResultType>& projections)
+{
+    projectOnVectorSpace(space, function, projections,
+                         Fiber::ParallelizationOptions());
+}
+
+#define INSTANTIATE_PROJECT_ON_VECTOR_SPACE(BASIS, RESULT) \
+    template void projectOnVectorSpace( \
+        const SimpleVectorSpaceBase< BASIS >& space, \
+        const Fiber::Function< RESULT >& function, \
+        arma::Col< RESULT >& projections, \
+        const Fiber::ParallelizationOptions& parallelOptions); \
+    template void projectOnVectorSpace( \
+        const SimpleVectorSpaceBase< BASIS >& space, \
+        const Fiber::Function< RESULT >& function, \
+        arma::Col< RESULT >& projections)
+FIBER_ITERATE_OVER_BASIS_AND_RESULT_TYPES(INSTANTIATE_PROJECT_ON_VECTOR_SPACE);
+
+} // namespace Bempp
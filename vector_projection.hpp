@@ -0,0 +1,73 @@
+// Copyright (C) 2011-2012 by the BEM++ Authors
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#ifndef vector_projection_hpp
+#define vector_projection_hpp
+
+#include "common/common.hpp"
+
+#include <armadillo>
+
+namespace Fiber
+{
+
+class ParallelizationOptions;
+template <typename ValueType> class Function;
+
+} // namespace Fiber
+
+namespace Bempp
+{
+
+template <typename BasisFunctionType> class SimpleVectorSpaceBase;
+
+/** \brief Project \p function on the SimpleVectorSpace \p space.
+ *
+ *  On output, the <tt>i</tt>th entry of \p projections is the integral over
+ *  the grid of the scalar product of \p function and the <tt>i</tt>th basis
+ *  function of \p space; these are the projections from which a GridFunction
+ *  on \p space can be constructed (with \p space as the dual space).
+ *
+ *  The elements are processed in parallel, in batches of elements sharing a
+ *  shapeset. \p function is evaluated once per batch, at the quadrature
+ *  points of all its elements, and the projections onto all components are
+ *  obtained from the values of the scalar basis functions by a single
+ *  matrix product per element.
+ *
+ *  \p function may depend only on the global coordinates of the points and
+ *  on the normals. An exception is thrown if its codomain dimension differs
+ *  from that of \p space. */
+template <typename BasisFunctionType, typename ResultType>
+void projectOnVectorSpace(
+        const SimpleVectorSpaceBase<BasisFunctionType>& space,
+        const Fiber::Function<ResultType>& function,
+        arma::Col<ResultType>& projections,
+        const Fiber::ParallelizationOptions& parallelOptions);
+
+/** \overload */
+template <typename BasisFunctionType, typename ResultType>
+void projectOnVectorSpace(
+        const SimpleVectorSpaceBase<BasisFunctionType>& space,
+        const Fiber::Function<ResultType>& function,
+        arma::Col<ResultType>& projections);
+
+} // namespace Bempp
+
+#endif